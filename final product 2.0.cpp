@@ -1,271 +1,20 @@
-#include <iostream>
-#include <string>
-#include <vector>
-#include <ctime> // For handling dates
-#include <fstream> // For file handling
-#include <limits> // For numeric limits
-#include <algorithm>
-using namespace std;
-// Define structure for maintenance tasks
-struct MaintenanceTask {
-    string description;
-    tm dueDate;
-    bool completed;
-
-    MaintenanceTask(string desc, tm due) : description(desc), dueDate(due), completed(false) {}
-};
-
-// Define structure for vehicle
-struct Vehicle {
-    string licensePlate;
-    string brand;
-    string color;
-    bool available;
-    string condition;
-    vector<MaintenanceTask> maintenanceSchedule; // Move maintenance schedule here
-
-    Vehicle(string lp, string b, string c, bool av, string cond)
-        : licensePlate(lp), brand(b), color(c), available(av), condition(cond) {}
-};
-
-// Base class for car
-class Car {
-protected:
-    string carType;
-    vector<MaintenanceTask> maintenanceSchedule; // Maintenance schedule for each vehicle
-public:
-    Car(string carType) : carType(carType) {}
-    virtual double dailyRentalRate() const = 0; // Pure virtual function for daily rental rate
-    virtual ~Car() {} // Virtual destructor for proper cleanup
-    string getcarType() const { return carType; }
-
-    
-    void addMaintenanceTask(const string& description, const tm& dueDate) {
-        maintenanceSchedule.push_back(MaintenanceTask(description, dueDate));
-    }
-
-    // Method to remove a maintenance task from the schedule based on description
-    void removeMaintenanceTask(const string& description) {
-        auto it = std::find_if(maintenanceSchedule.begin(), maintenanceSchedule.end(), [&](const MaintenanceTask& task) {
-            return task.description == description;
-        });
-        if (it != maintenanceSchedule.end()) {
-            maintenanceSchedule.erase(it);
-            cout << "Maintenance task with description '" << description << "' removed successfully." << endl;
-        } else {
-            cout << "Maintenance task with description '" << description << "' not found." << endl;
-        }
-    }
-
-
-    
-};
+#include "rental_core.h"
 
-// Derived classes for 4-seater and 7-seater cars
-class Car4Seater : public Car {
-public:
-    Car4Seater() : Car("4-seater") {}
-    double dailyRentalRate() const override {
-        return 1000;
-    }
-};
-class Car7Seater : public Car {
-public:
-    Car7Seater() : Car("7-seater") {}
-    double dailyRentalRate() const override {
-        return 2000;
-    }
-};
+using namespace std;
 
 // Function to read a date from the input
-tm EnterDate(const string& prompt) {
-    tm date = {};
+Date EnterDate(const string& prompt) {
+    int day = 0, month = 0, year = 0;
     cout << prompt;
     cout << " (dd mm yyyy): ";
-    cin >> date.tm_mday >> date.tm_mon >> date.tm_year;
-    date.tm_mon--; // tm_mon is 0-based in struct tm
-    date.tm_year -= 1900; // tm_year is year since 1900 in struct tm
-    return date;
+    cin >> day >> month >> year;
+    return Date::fromYMD(year, month, day);
 }
 
-// Base class to represent a customer
-class Customer {
-protected:
-    string Name;
-    string Address;
-    string PhoneNumber;
-    string Brand;
-    string Reason;
-    Car* carType; // Pointer to Car
-    tm RentalDate;
-    tm ReturnDate;
-    Vehicle* car;
-public:
-        
-    // Constructor to initialize customer details
-    Customer(string Name, string Address, string PhoneNumber, string Brand,string Reason, Car* carType, tm RentalDate, tm ReturnDate, Vehicle* car) {
-        this->Name = Name;
-        this->Address = Address;
-        this->PhoneNumber = PhoneNumber;
-        this->Brand = Brand;
-        this->Reason = Reason;
-        this->carType = carType;
-        this->RentalDate = RentalDate;
-        this->ReturnDate = ReturnDate;
-        this->car = car;
-        this->car->available = false;
-    }
-
-    // Public member functions to access member variables
-    string getName() const { return Name; }
-    string getAddress() const { return Address; }
-    string getPhoneNumber() const { return PhoneNumber; }
-    string getBrand() const { return Brand; }
-    string getReason() const { return Reason; }
-    Car* getVehicle() const { return carType; }
-    tm getRentalDate() const { return RentalDate; }
-    tm getReturnDate() const { return ReturnDate; }
-
-     // Setter methods
-    void setName(const string& name) { Name = name; }
-    void setAddress(const string& address) { Address = address; }
-    void setPhoneNumber(const string& phoneNumber) { PhoneNumber = phoneNumber; }
-    void setReason(const string& reason) { Reason = reason; }
-    void setReturnDate(const tm& returnDate) { ReturnDate = returnDate; }
-
-    // Method to display customer information
-    virtual void GetCustomerInfo() const {
-        cout << "Name: " << Name << endl;
-        cout << "Address: " << Address << endl;
-        cout << "Phone number: " << PhoneNumber << endl;
-        cout << "Brand: " << Brand << endl;
-        cout << "Reason for renting: " << Reason << endl;
-        cout << "Car type: " << carType->getcarType() << endl;
-        cout << "License plate: " << car->licensePlate << endl;
-        cout << "Rental Date: " << RentalDate.tm_mday << "/" << RentalDate.tm_mon + 1 << "/" << RentalDate.tm_year + 1900 << endl;
-        cout << "Return Date: " << ReturnDate.tm_mday << "/" << ReturnDate.tm_mon + 1 << "/" << ReturnDate.tm_year + 1900 << endl;
-        cout << "Number of rental days: " << RentalDays() << endl;
-        cout << "Total rental cost: $" << calculateRentalCost() << endl;
-    }
-
-    // Method to calculate the number of rental days
-    int RentalDays() const {
-        time_t tRental = mktime(const_cast<tm*>(&RentalDate));
-        time_t tReturn = mktime(const_cast<tm*>(&ReturnDate));
-        double seconds = difftime(tReturn, tRental);
-        return seconds / (60 * 60 * 24); // Convert seconds to days
-    }
-
-    void extendRentalPeriod(const tm& newReturnDate) {
-        setReturnDate(newReturnDate);
-        cout << "Rental period extended successfully." << endl;
-    }
-
-    // Method to calculate the rental cost
-    virtual double calculateRentalCost() const {
-        return RentalDays() * carType->dailyRentalRate();
-    }
-
-    virtual ~Customer() {
-        car->available = true;
-        delete carType;
-    } // Virtual destructor for proper cleanup
-
-    void changeCustomerInfo(const string& newName, const string& newAddress, const string& newPhoneNumber, const string& newReason) {
-        setName(newName);
-        setAddress(newAddress);
-        setPhoneNumber(newPhoneNumber);
-        setReason(newReason);
-        cout << "Customer information updated successfully." << endl;
-    }
-};
-
-// Derived class to represent a VIP customer
-class CustomerVIP : public Customer {
-private:
-    double discountRate; // Discount rate for VIP customers
-public:
-    CustomerVIP(string Name, string Address, string PhoneNumber, string Brand,string Reason, Car* carType, tm RentalDate, tm ReturnDate, Vehicle* car, double discountRate)
-        : Customer(Name, Address, PhoneNumber, Brand,Reason, carType, RentalDate, ReturnDate, car), discountRate(discountRate) {}
-
-    // Overridden method to display VIP customer information
-    void GetCustomerInfo() const override {
-        Customer::GetCustomerInfo();
-        cout << "Customer type: VIP" << endl;
-        cout << "Discount rate: " << discountRate * 100 << "%" << endl;
-        cout << "Total rental cost after discount: $" << calculateRentalCost() << endl;
-    }
-
-    // Overridden method to calculate the rental cost with discount
-    double calculateRentalCost() const override {
-        return Customer::calculateRentalCost() * (1 - discountRate);
-    }
-
-    // Method to calculate the original rental cost before discount
-    double calculateBaseRentalCost() const {
-        return Customer::calculateRentalCost();
-    }
-};
-
-// Function to print a bill with beautiful borders
-void printBill(const Customer* cus) {
-    cout << "-----------------------------------------" << endl;
-    cout << "|                 BILL                  |" << endl;
-    cout << "-----------------------------------------" << endl;
-    cus->GetCustomerInfo();
-
-    double originalCost = cus->calculateRentalCost();
-    double discountedCost = originalCost;
-
-    const CustomerVIP* vipCustomer = dynamic_cast<const CustomerVIP*>(cus);
-    if (vipCustomer) {
-        originalCost = vipCustomer->calculateBaseRentalCost();
-        discountedCost = vipCustomer->calculateRentalCost();
-        cout << "Total rental cost (before discount): $" << originalCost << endl;
-        cout << "Total rental cost afther discount: $" << discountedCost << endl;
-    } else {
-        cout << "Total rental cost: $" << originalCost << endl;
-    }
-
-    cout << "-----------------------------------------" << endl;
-    char damage;
-    cout << "Did the customer cause any damage to the car? (y/n)? ";
-    cin >> damage;
-    double insuranceCost = 0;
-    if (damage == 'y' || damage == 'Y') {
-        char tier;
-        cout << "Enter the extent of the damage (A/B/C): ";
-        cin >> tier;
-        switch (tier) {
-            case 'A': case 'a':
-                insuranceCost = 500;
-                break;
-            case 'B': case 'b':
-                insuranceCost = 200;
-                break;
-            case 'C': case 'c':
-                insuranceCost = 100;
-                break;
-            default:
-                cout << "Invalid extent, insurance fee not applicable" << endl;
-                insuranceCost = 0;
-                break;
-        }
-    }
-    double totalCost = discountedCost + insuranceCost;
-    cout << "Insurance fee: $" << insuranceCost << endl;
-    cout << "Total amount: $" << totalCost << endl;
-    cout << "-----------------------------------------" << endl;
-}
 bool checkPassword() {
     string correctPassword;
-    ifstream file("D:\\pb\\pass.txt"); // Mở tập tin chứa mật khẩu
-    if (file.is_open()) {
-        getline(file, correctPassword); // Đọc mật khẩu từ tập tin
-        file.close(); // Đóng tập tin sau khi đọc xong
-    } else {
-        cerr << "Cannot open the file pass.txt\n";
-        return false; // Trả về false nếu không thể mở tập tin
+    if (!readStoredPassword(correctPassword)) {
+        return false;
     }
 
     string enteredPassword;
@@ -280,53 +29,107 @@ bool checkPassword() {
     return enteredPassword == correctPassword;
 }
 
-// Function to initialize the vehicle list
-void initializeCar(vector<Vehicle>& VehicleList) {
-    VehicleList.push_back(Vehicle("4S1234", "Toyota", "Red", true, "Good"));
-    VehicleList.push_back(Vehicle("4S5678", "Honda", "Blue", true, "Good"));
-    VehicleList.push_back(Vehicle("7S2345", "Ford", "Black", true, "Good"));
-    VehicleList.push_back(Vehicle("7S6789", "Chevrolet", "White", true, "Good"));
-}
+struct PageCursor {
+    size_t position = 0; // listing position where the next page starts
+    size_t page = 0;     // pages shown so far
+    size_t pages = 0;    // pages holding rows that match the filter
+};
 
-// Function to find a vehicle by license plate
-Vehicle* findCar(const vector<Vehicle>& VehicleList, const string& licensePlate) {
-    for (auto& xe : VehicleList) {
-        if (xe.licensePlate == licensePlate && xe.available) {
-            return const_cast<Vehicle*>(&xe);
+// Shows matchingRows rows REPORT_PAGE_SIZE at a time; renderPage(report,
+// cursor) renders the rows of the next page and advances cursor.position
+template <typename RenderPage>
+void showPages(size_t matchingRows, RenderPage renderPage) {
+    PageCursor cursor;
+    cursor.pages = (matchingRows + REPORT_PAGE_SIZE - 1) / REPORT_PAGE_SIZE;
+    while (cursor.page < cursor.pages) {
+        {
+            ReportWriter report(cout);
+            report << "Page " << cursor.page + 1 << " of " << cursor.pages << '\n';
+            renderPage(report, cursor);
+            cursor.page++;
+        } // flushed before the prompt
+        if (cursor.page == cursor.pages) {
+            break;
+        }
+        string answer;
+        cout << "Press Enter for the next page, or q to stop: ";
+        if (!getline(cin, answer) || answer == "q" || answer == "Q") {
+            break;
         }
     }
-    return nullptr;
 }
 
-void DisplayCarList(const vector<Vehicle>& VehicleList) {
+void DisplayCarList(const FleetRegistry& VehicleList) {
+    string search;
+    cout << "Search cars, e.g. \"toyota red 7-seater\", adding \"rented\" or \"all\" for more than available cars (Enter for all available): ";
+    getline(cin, search);
+    FleetQuery query = parseFleetQuery(VehicleList, search);
+    RoaringBitmap matches = searchFleet(VehicleList, query);
+
     cout << "-----------------------------------------" << endl;
-    cout << "|          AVAILABLE CAR LIST           |" << endl;
+    if (query.availability == Availability::Available) {
+        cout << "|          AVAILABLE CAR LIST           |" << endl;
+    } else if (query.availability == Availability::Rented) {
+        cout << "|            RENTED CAR LIST            |" << endl;
+    } else {
+        cout << "|               CAR LIST                |" << endl;
+    }
     cout << "-----------------------------------------" << endl;
-    for (const auto& xe : VehicleList) {
-        cout << "license plate number: " << xe.licensePlate << endl;
-        cout << "Brand: " << xe.brand << endl;
-        cout << "Color: " << xe.color << endl;
-        cout << "Availability: " << (xe.available ? "Available" : "Rented") << endl;
-        cout << "Condition: " << xe.condition << endl;
-        cout << "-----------------------------------------" << endl;
+    if (matches.empty()) {
+        cout << "No matching car." << endl;
+        return;
     }
+    showPages(matches.cardinality(), [&](ReportWriter& report, PageCursor& cursor) {
+        size_t shown = 0;
+        cursor.position = matches.visitFrom(cursor.position, [&](uint32_t slot) {
+            writeVehicle(report, VehicleList.at(slot));
+            return ++shown < REPORT_PAGE_SIZE;
+        });
+    });
 }
 
-void addCarMaintenance(vector<Vehicle>& VehicleList) {
+void displayCustomerList(const ContractStore& CustomerList) {
+    if (CustomerList.empty()) {
+        cout << "Customer list is empty!" << endl;
+        return;
+    }
+    string filter;
+    cout << "Filter by name, phone or plate (Enter for all): ";
+    getline(cin, filter);
+    auto matches = [&](const Customer* cus) {
+        return matchesFilter(filter, cus->getName(), cus->getPhoneNumber(), cus->getCar()->licensePlate());
+    };
+    size_t rows = 0;
+    CustomerList.forEach([&](const ContractId&, const Customer* cus) {
+        rows += matches(cus) ? 1 : 0;
+    });
+    if (rows == 0) {
+        cout << "No matching customer." << endl;
+        return;
+    }
+
+    cout << "Customer list:" << endl;
+    cout << "-----------------------------------------" << endl;
+    showPages(rows, [&](ReportWriter& report, PageCursor& cursor) {
+        size_t shown = 0;
+        cursor.position = CustomerList.visitFrom(cursor.position, [&](const ContractId& id, const Customer* cus) {
+            if (!matches(cus)) {
+                return true;
+            }
+            report << "Customer ID " << formatContractId(id) << ":\n";
+            cus->writeInfo(report);
+            report << "-----------------------------------------\n";
+            return ++shown < REPORT_PAGE_SIZE;
+        });
+    });
+}
+
+void addCarMaintenance(FleetRegistry& VehicleList, Journal& journal) {
     string licenseplate;
     cout << "Enter the license plate number of the car needing maintenance: ";
     cin >> licenseplate;
-    Vehicle* car = nullptr;
 
-    // Find the vehicle with the specified license plate
-    for (auto& v : VehicleList) {
-        if (v.licensePlate == licenseplate) {
-            car = &v;
-            break;
-        }
-    }
-
-    if (car == nullptr) {
+    if (VehicleList.find(licenseplate) == nullptr) {
         cout << "Car does not exist or is currently rented" << endl;
         return;
     }
@@ -335,63 +138,105 @@ void addCarMaintenance(vector<Vehicle>& VehicleList) {
     string description;
     cin.ignore();
     getline(cin, description);
-    tm dueDate = EnterDate("Enter maintenance date");
+    Date dueDate = EnterDate("Enter maintenance date");
+
+    // Add maintenance task to the fleet's maintenance schedule
+    string error;
+    MaintenanceTaskId id;
+    if (!scheduleMaintenance(VehicleList, licenseplate, description, dueDate, id, error)) {
+        cout << error << endl;
+        return;
+    }
+    cout << "Maintenance " << formatTaskId(id) << " has been added for the car " << licenseplate << endl;
+    if (!journaled(journal, journal.logScheduleMaintenance(id, licenseplate, description, dueDate), error)) {
+        cout << "Warning: " << error << endl;
+    }
+}
+
+// Journals a change of customer details before making it, so a change the
+// journal could not take is not made
+void changeCustomerField(Journal& journal, Customer* cus, const ContractId& id, CustomerField field, const string& value, const string& label) {
+    if (!journal.logChangeInfo(id, field, value)) {
+        cout << label << " was left as it was: " << journal.error() << endl;
+        return;
+    }
+    applyCustomerField(cus, field, value);
+    cout << label << " changed successfully." << endl;
+}
 
-    // Add maintenance task to the vehicle's maintenance schedule
-    car->maintenanceSchedule.push_back(MaintenanceTask(description, dueDate));
-    cout << "Maintenance has been added for the car " << licenseplate << endl;
+// Asks for a task of the car, by ID or (as before IDs) by description
+bool EnterMaintenanceTask(const FleetRegistry& VehicleList, const string& licenseplate, const string& prompt, MaintenanceTaskId& id) {
+    cout << prompt;
+    string text;
+    cin.ignore(); // Clear the input buffer
+    getline(cin, text);
+    const MaintenanceTask* task = parseTaskId(text, id) ? VehicleList.maintenance().get(id) : nullptr;
+    if (task && task->vehicle->licensePlate() == licenseplate) {
+        return true;
+    }
+    string error;
+    if (!findMaintenanceByDescription(VehicleList, licenseplate, text, id, error)) {
+        cout << error << endl;
+        return false;
+    }
+    return true;
 }
 
-void deleteCarMaintenance(vector<Vehicle>& VehicleList) {
+void deleteCarMaintenance(FleetRegistry& VehicleList, Journal& journal) {
     string licenseplate;
     cout << "Enter the license plate number of the car needing maintenance deletion: ";
     cin >> licenseplate;
-    Vehicle* car = nullptr;
 
-    // Find the vehicle with the specified license plate
-    for (auto& v : VehicleList) {
-        if (v.licensePlate == licenseplate) {
-            car = &v;
-            break;
-        }
+    if (VehicleList.find(licenseplate) == nullptr) {
+        cout << "The car does not exist or is currently being rented." << endl;
+        return;
     }
 
-    if (car == nullptr) {
-        cout << "The car does not exist or is currently being rented." << endl;
+    MaintenanceTaskId id;
+    if (!EnterMaintenanceTask(VehicleList, licenseplate, "Enter the task ID or description to be deleted: ", id)) {
         return;
     }
+    string error;
+    if (!cancelMaintenance(VehicleList, id, error)) {
+        cout << error << endl;
+        return;
+    }
+    cout << "Maintenance task " << formatTaskId(id) << " removed successfully." << endl;
+    if (!journaled(journal, journal.logCancelMaintenance(id), error)) {
+        cout << "Warning: " << error << endl;
+    }
+}
 
-    cout << "Enter the maintenance description to be deleted: ";
-    string description;
-    cin.ignore(); // Clear the input buffer
-    getline(cin, description);
+void completeCarMaintenance(FleetRegistry& VehicleList, Journal& journal) {
+    string licenseplate;
+    cout << "Enter the license plate number of the serviced car: ";
+    cin >> licenseplate;
 
-    // Find and remove the maintenance task from the vehicle's maintenance schedule
-    auto it = std::find_if(car->maintenanceSchedule.begin(), car->maintenanceSchedule.end(), [&](const MaintenanceTask& task) {
-        return task.description == description;
-    });
+    if (VehicleList.find(licenseplate) == nullptr) {
+        cout << "The car does not exist." << endl;
+        return;
+    }
 
-    if (it != car->maintenanceSchedule.end()) {
-        car->maintenanceSchedule.erase(it);
-        cout << "Maintenance task with description '" << description << "' removed successfully." << endl;
-    } else {
-        cout << "Maintenance task with description '" << description << "' not found." << endl;
+    MaintenanceTaskId id;
+    if (!EnterMaintenanceTask(VehicleList, licenseplate, "Enter the task ID or description that was completed: ", id)) {
+        return;
+    }
+    string error;
+    if (!completeMaintenance(VehicleList, id, error)) {
+        cout << error << endl;
+        return;
+    }
+    cout << "Maintenance task " << formatTaskId(id) << " marked as completed." << endl;
+    if (!journaled(journal, journal.logCompleteMaintenance(id), error)) {
+        cout << "Warning: " << error << endl;
     }
 }
 
-void displayCarMaintenance(const vector<Vehicle>& VehicleList) {
+void displayCarMaintenance(const FleetRegistry& VehicleList) {
     string licenseplate;
     cout << "Enter the license plate number to display the maintenance schedule: ";
     cin >> licenseplate;
-    Vehicle* car = nullptr;
-
-    // Find the vehicle with the specified license plate
-    for (const auto& v : VehicleList) {
-        if (v.licensePlate == licenseplate) {
-            car = const_cast<Vehicle*>(&v);
-            break;
-        }
-    }
+    const Vehicle* car = VehicleList.find(licenseplate);
 
     if (car == nullptr) {
         cout << "The car does not exist." << endl;
@@ -401,63 +246,185 @@ void displayCarMaintenance(const vector<Vehicle>& VehicleList) {
     cout << "-----------------------------------------" << endl;
     cout << "|       MAINTENANCE SCHEDULE OF THE CAR          |" << endl;
     cout << "-----------------------------------------" << endl;
-    if (car->maintenanceSchedule.empty()) {
+    if (car->maintenanceTasks.empty()) {
         cout << "There is no maintenance scheduled for this car." << endl;
     } else {
-        for (const auto& task : car->maintenanceSchedule) {
-            cout << "Description: " << task.description << endl;
-            cout << "Due Date: " << task.dueDate.tm_mday << "/" << task.dueDate.tm_mon + 1 << "/" << task.dueDate.tm_year + 1900 << endl;
-            cout << "Status: " << (task.completed ? "Completed" : "Pending") << endl;
-            cout << "-----------------------------------------" << endl;
+        ReportWriter report(cout);
+        for (const MaintenanceTaskId& id : car->maintenanceTasks) {
+            writeMaintenanceTask(report, id, *VehicleList.maintenance().get(id));
         }
     }
 }
 
-void saveDeletedCustomerInfo(const Customer* customer, const string& filePath) {
-    ofstream file(filePath, ios::app);
-    if (file.is_open()) {
-
-        file << "===================================================================CAR RENTAL AGREEMENT============================================================================"<<endl;
-        file << "|                                                                   RENTER INFORMATION                                                                            |"<<endl;
-        file << "| Name: " << customer->getName() <<"                                                                                                                              |"<< endl;
-        file << "| Address: " << customer->getAddress() <<"                                                                                                                        |"<< endl;
-        file << "| Phone Number: " << customer->getPhoneNumber() <<"                                                                                                               |"<< endl;
-        file << "| Desired Brand: " << customer->getBrand() <<"                                                                                                                    |"<< endl;
-        file << "| Vehicle Type: " << customer->getVehicle()->getcarType()<<"                                                                                                      |"<< endl;
-        file << "| Rental Date: " << customer->getRentalDate().tm_mday << "/" << customer->getRentalDate().tm_mon + 1 << "/" << customer->getRentalDate().tm_year + 1900 <<"       |"<< endl;
-        file << "| Return Date: " << customer->getReturnDate().tm_mday << "/" << customer->getReturnDate().tm_mon + 1 << "/" << customer->getReturnDate().tm_year + 1900 <<"       |"<< endl;
-        file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-        file << "|                                                                    OWNER INFORMATION     "<<"                                                                   |"<< endl;
-        file << "| Name: Nguyen Hoang Bach"<<"                                                                                                                                     |"<< endl;
-        file << "| Address: 54 Nguyen Luong Bang"<<"                                                                                                                               |"<< endl;
-        file << "| Phone Number: 555-1234"<<"                                                                                                                                      |"<< endl;
-        file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-        file << "|                                                                          TERMS                                                                                  |"<<endl;
-        file << "| Terms A,B,C,D,etc"<<"                                                                                                                                           |"<< endl;
-        file << "| By signing contract,"<<"                                                                                                                                        |"<< endl;
-        file << "| both parties confirm their understanding and acceptance of these terms and conditions."<<"                                                                      |"<< endl;
-        file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-
-        double originalCost = customer->calculateRentalCost();
-        double discountedCost = originalCost;
-
-        const CustomerVIP* vipCustomer = dynamic_cast<const CustomerVIP*>(customer);
-        if (vipCustomer) {
-            originalCost = vipCustomer->calculateBaseRentalCost();
-            discountedCost = vipCustomer->calculateRentalCost();
-        }
+// Pending maintenance across the fleet due within the next few days
+void displayMaintenanceDue(const FleetRegistry& VehicleList) {
+    Date from = EnterDate("Enter the start date");
+    int days;
+    cout << "Enter the number of days to look ahead: ";
+    cin >> days;
+    if (!cin || days < 0) {
+        cin.clear();
+        cout << "Invalid number of days!" << endl;
+        return;
+    }
+    Date to(from.days + days);
+    vector<MaintenanceTaskId> due = VehicleList.maintenance().dueBetween(from, to);
+
+    ReportWriter report(cout);
+    report << "Maintenance due from " << from << " to " << to << ": " << static_cast<unsigned long>(due.size()) << " task(s)\n";
+    report << "-----------------------------------------\n";
+    for (const MaintenanceTaskId& id : due) {
+        writeMaintenanceTask(report, id, *VehicleList.maintenance().get(id));
+    }
+}
 
-        file << "Total Rental Cost: $" << discountedCost << endl;
-        file << "-----------------------------------------" << endl;
-        file.close();
-    } else {
-        cout << "Unable to open file to save deleted customer information." << endl;
-    }pas
+// Non-interactive modes take the password from PBL_PASSWORD instead of a
+// prompt. Prints the mode's usage and returns false when the arguments are
+// incomplete or the password is missing or wrong.
+bool checkPasswordFromEnv(bool argumentsOk, const char* program, const string& usage) {
+    string correctPassword;
+    const char* enteredPassword = getenv("PBL_PASSWORD");
+    if (!argumentsOk || !readStoredPassword(correctPassword) || !enteredPassword || correctPassword != enteredPassword) {
+        cout << "Usage: PBL_PASSWORD=<password> " << program << " " << usage << endl;
+        return false;
+    }
+    return true;
 }
 
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--client") {
+#ifndef _WIN32
+        return runClient(argc > 2 ? argv[2] : SERVER_SOCKET_PATH);
+#else
+        cout << "Server mode needs Unix domain sockets and epoll; it is not available on Windows." << endl;
+        return 1;
+#endif
+    }
+    if (argc > 1 && string(argv[1]) == "--history") {
+        if (!checkPasswordFromEnv(argc >= 4, argv[0], "--history revenue <year> | plate <license plate>")) {
+            return 1;
+        }
+        return runHistoryQuery(argv[2], argv[3]) ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        if (!checkPasswordFromEnv(argc >= 3, argv[0], "--batch <command file> [more command files, run concurrently]")) {
+            return 1;
+        }
+        vector<unique_ptr<ifstream>> inputs;
+        for (int i = 2; i < argc; ++i) {
+            inputs.emplace_back(new ifstream(argv[i]));
+            if (!inputs.back()->is_open()) {
+                cout << "Cannot open the command file " << argv[i] << endl;
+                return 1;
+            }
+        }
+        ios::sync_with_stdio(false);
+        // Customers release their cars when destroyed, so the fleet must outlive them
+        FleetRegistry VehicleList;
+        ContractStore CustomerList;
+        Journal journal;
+        if (!restoreState(VehicleList, CustomerList, journal)) {
+            return 1;
+        }
+        int archiveFlushMs;
+        ArchiveDurability archiveDurability = archiveDurabilityFromEnv(archiveFlushMs);
+        ArchiveWriter archive(ARCHIVE_PATH, archiveDurability, archiveFlushMs, HISTORY_PATH, HISTORY_TAIL_PATH);
+        journal.setSyncEvery(BATCH_SYNC_EVERY);
+        ReservationEngine engine(VehicleList, CustomerList, &journal, &archive);
+        size_t failed = 0;
+        if (inputs.size() == 1) {
+            failed = runBatch(*inputs[0], engine, VehicleList, CustomerList, journal, cout);
+        } else {
+            vector<ostringstream> reports(inputs.size());
+            vector<size_t> failures(inputs.size());
+            vector<thread> terminals;
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                terminals.emplace_back([&, i] { failures[i] = runBatch(*inputs[i], engine, VehicleList, CustomerList, journal, reports[i]); });
+            }
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                terminals[i].join();
+                cout << argv[i + 2] << ":\n" << reports[i].str();
+                failed += failures[i];
+            }
+        }
+        if (!compactJournal(journal, VehicleList, CustomerList)) {
+            cout << "Unable to write snapshot file." << endl;
+        }
+        archive.close();
+        ReportWriter report(cout);
+        writeOperationStats(report);
+        return failed == 0 ? 0 : 2;
+    }
+
+    if (argc > 1 && string(argv[1]) == "--import") {
+        if (!checkPasswordFromEnv(argc >= 3, argv[0], "--import <inventory CSV> [parsing threads]")) {
+            return 1;
+        }
+        FleetRegistry VehicleList;
+        ContractStore CustomerList;
+        Journal journal;
+        if (!restoreState(VehicleList, CustomerList, journal)) {
+            return 1;
+        }
+        size_t threads = argc > 3 ? strtoul(argv[3], nullptr, 10) : max(thread::hardware_concurrency(), 1u);
+        FleetImportResult result;
+        {
+            ReportWriter report(cout);
+            if (!importFleetCsv(argv[2], &VehicleList, threads, report, result)) {
+                report << "Cannot open the inventory file " << argv[2] << '\n';
+                return 1;
+            }
+            report << "Imported " << static_cast<unsigned long long>(result.vehicles) << " vehicles and "
+                   << static_cast<unsigned long long>(result.tasks) << " maintenance tasks from "
+                   << static_cast<unsigned long long>(result.rows) << " rows (" << static_cast<unsigned long long>(result.rejected)
+                   << " rejected) in " << result.seconds << " s with " << static_cast<unsigned long>(max<size_t>(threads, 1))
+                   << " parsing threads\n";
+        }
+        // Vehicles are not journaled, so the import is kept by a fresh snapshot
+        if (!compactJournal(journal, VehicleList, CustomerList)) {
+            cout << "Unable to write snapshot file." << endl;
+            return 1;
+        }
+        return result.rejected == 0 ? 0 : 2;
+    }
+
+    if (argc > 1 && string(argv[1]) == "--serve") {
+#ifndef _WIN32
+        if (!checkPasswordFromEnv(true, argv[0], "--serve [socket path]")) {
+            return 1;
+        }
+        FleetRegistry VehicleList;
+        ContractStore CustomerList;
+        Journal journal;
+        if (!restoreState(VehicleList, CustomerList, journal)) {
+            return 1;
+        }
+        int archiveFlushMs;
+        ArchiveDurability archiveDurability = archiveDurabilityFromEnv(archiveFlushMs);
+        ArchiveWriter archive(ARCHIVE_PATH, archiveDurability, archiveFlushMs, HISTORY_PATH, HISTORY_TAIL_PATH);
+        // The server syncs once per loop round itself, before answering
+        journal.setSyncEvery(BATCH_SYNC_EVERY);
+        ReservationEngine engine(VehicleList, CustomerList, &journal, &archive);
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+        string socketPath = argc > 2 ? argv[2] : SERVER_SOCKET_PATH;
+        cout << "Serving on " << socketPath << "; stop with Ctrl+C" << endl;
+        bool ok = runServer(socketPath, engine, VehicleList, CustomerList, &journal);
+        if (!compactJournal(journal, VehicleList, CustomerList)) {
+            cout << "Unable to write snapshot file." << endl;
+            ok = false;
+        }
+        archive.close();
+        ReportWriter report(cout);
+        writeOperationStats(report);
+        return ok ? 0 : 1;
+#else
+        cout << "Server mode needs Unix domain sockets and epoll; it is not available on Windows." << endl;
+        return 1;
+#endif
+    }
 
-int main() {
-   
     int attempts = 0;
     bool isAuthenticated = false;
     while (attempts < 3 && !isAuthenticated) {
@@ -491,9 +458,18 @@ int main() {
         return 0;
     }
 
-    vector<Customer*> CustomerList; // Use vector to manage the list of customers
-    vector<Vehicle> VehicleList; // List of vehicles
-    initializeCar(VehicleList); // Initialize vehicle list
+    FleetRegistry VehicleList; // List of vehicles, indexed by license plate
+    ContractStore CustomerList; // Active contracts by customer ID; must not outlive the fleet
+
+    // Restore the fleet and active rentals from the last snapshot and journal
+    Journal journal;
+    if (!restoreState(VehicleList, CustomerList, journal)) {
+        return 1;
+    }
+    // Checked-out contracts are archived in the background; drained on exit
+    int archiveFlushMs;
+    ArchiveDurability archiveDurability = archiveDurabilityFromEnv(archiveFlushMs);
+    ArchiveWriter archive(ARCHIVE_PATH, archiveDurability, archiveFlushMs, HISTORY_PATH, HISTORY_TAIL_PATH);
 
     // Menu options
     cout << "-----------------------------------------" << endl;
@@ -509,19 +485,38 @@ int main() {
     cout << "|  8. Display car maintanance list       |" << endl;
     cout << "|  9. Extend rental period               |" << endl; 
     cout << "| 10. Change customer information        |" << endl;  
+    cout << "| 11. Save snapshot                      |" << endl;
+    cout << "| 12. Bill all active contracts          |" << endl;
+    cout << "| 13. Find customer by phone             |" << endl;
+    cout << "| 14. Find customer by ID                |" << endl;
+    cout << "| 15. Rental history                     |" << endl;
+    cout << "| 16. Complete car maintenance           |" << endl;
+    cout << "| 17. Maintenance due soon               |" << endl;
+    cout << "| 18. Operation statistics               |" << endl;
+    cout << "| 19. Revenue cube                       |" << endl;
+    cout << "| 20. Memory footprint                   |" << endl;
+    cout << "| 21. Pricing rules                      |" << endl;
     cout << "|  0. Exit                               |" << endl;
     cout << "-----------------------------------------" << endl;
 
+    // Commands are timed without the time spent waiting for the operator
+    streambuf* terminal = cin.rdbuf();
+    InputWaitBuffer timedInput(terminal);
+    cin.rdbuf(&timedInput);
+
     int Choice;
     do {
         cout << "Enter your choice: ";
         cin >> Choice;
         cin.ignore(); // Clear the newline character from the input buffer
+        unique_ptr<OperationTimer> timer;
+        if (Choice >= 1 && Choice <= static_cast<int>(STAT_MENU_COMMANDS)) {
+            timer.reset(new OperationTimer(static_cast<StatOperation>(STAT_MENU_ADD_CUSTOMER + Choice - 1)));
+        }
         switch (Choice) {
 
             case 1: {
                 string Name, Address, PhoneNumber, Brand,Reason, carType4o7, licensePLate;
-                Car* carType;
                 Vehicle* car;
                 cout << "Enter customer name: ";
                 getline(cin, Name);
@@ -533,35 +528,62 @@ int main() {
                 getline(cin, Brand);
                 cout << "Enter reason for renting: ";
                 getline(cin, Reason);
-                cout << "Enter car type (4-seater/7-seater): ";
+                cout << "Enter car type (" << carTypes().namesForPrompt() << "): ";
                 getline(cin, carType4o7);
-                cout << "Enter lisence plate number: ";
+                cout << "Enter license plate (empty for any car of that type and brand free on the rental dates): ";
                 getline(cin, licensePLate);
-                car = findCar(VehicleList, licensePLate);
+                car = licensePLate.empty() ? nullptr : findCar(VehicleList, licensePLate);
 
-                if (!car) {
+                if (!car && !licensePLate.empty()) {
                     cout << "The car is not available or invalid license plate number!" << endl;
                     break;
                 }
-                if (carType4o7 == "4-seater") {
-                    carType = new Car4Seater();
-                } else if (carType4o7 == "7-seater") {
-                    carType = new Car7Seater();
-                } else {
+                if (!isKnownCarType(carType4o7)) {
                     cout << "Invalid car type!" << endl;
                     break;
                 }
+                if (licensePLate.empty()) {
+                    CarTypeId type = CAR_4_SEATER;
+                    carTypes().find(carType4o7, type);
+                    cout << VehicleList.countAvailable(type, Brand) << " " << carType4o7 << " car(s)" << (Brand.empty() ? "" : " of brand " + Brand)
+                         << " without bookings; others are checked against the rental dates" << endl;
+                }
 
-                tm RentalDate = EnterDate("Enter rental date");
-                tm ReturnDate = EnterDate("Enter return date");
-
-                CustomerList.push_back(new Customer(Name, Address, PhoneNumber, Brand,Reason, carType, RentalDate, ReturnDate, car));
+                Date RentalDate = EnterDate("Enter rental date");
+                Date ReturnDate = EnterDate("Enter return date");
+
+                BookingRequest req;
+                req.name = Name;
+                req.address = Address;
+                req.phoneNumber = PhoneNumber;
+                req.brand = Brand;
+                req.reason = Reason;
+                req.carType = carType4o7;
+                req.licensePlate = licensePLate;
+                req.rentalDate = RentalDate;
+                req.returnDate = ReturnDate;
+                string error;
+                ContractId id;
+                Customer* booked = bookCustomer(VehicleList, CustomerList, req, id, error);
+                if (!booked) {
+                    cout << error << endl;
+                    break;
+                }
+                if (req.licensePlate.empty()) {
+                    req.licensePlate = booked->getCar()->licensePlate();
+                    cout << "Assigned car: " << req.licensePlate << endl;
+                }
+                if (!journal.logAddCustomer(id, req, booked->getQuotedCents())) {
+                    removeCustomer(CustomerList, id);
+                    cout << "The booking was not made: " << journal.error() << endl;
+                    break;
+                }
+                cout << "Customer ID: " << formatContractId(id) << endl;
                 break;
             }
 
             case 2: {
                 string Name, Address, PhoneNumber, Brand,Reason,  carType4o7, licensePLate;
-                Car* carType;
                 Vehicle* car;
                 double discountRate;
                 cout << "Enter customer name: ";
@@ -574,63 +596,87 @@ int main() {
                 getline(cin, Brand);
                 cout << "Enter reason for renting: ";
                 getline(cin, Reason);
-                cout << "Enter car type (4-seater/7-seater): ";
+                cout << "Enter car type (" << carTypes().namesForPrompt() << "): ";
                 getline(cin, carType4o7);
-                cout << "Enter license plate: ";
+                cout << "Enter license plate (empty for any car of that type and brand free on the rental dates): ";
                 getline(cin, licensePLate);
-                car = findCar(VehicleList, licensePLate);
-                if (!car) {
+                car = licensePLate.empty() ? nullptr : findCar(VehicleList, licensePLate);
+                if (!car && !licensePLate.empty()) {
                     cout << "The car is not available or invalid license plate number!" << endl;
                     break;
                 }
-                if (carType4o7 == "4-seater") {
-                    carType = new Car4Seater();
-                } else if (carType4o7 == "7-seater") {
-                    carType = new Car7Seater();
-                } else {
+                if (!isKnownCarType(carType4o7)) {
                     cout << "Invalid car type!" << endl;
                     break;
                 }
+                if (licensePLate.empty()) {
+                    CarTypeId type = CAR_4_SEATER;
+                    carTypes().find(carType4o7, type);
+                    cout << VehicleList.countAvailable(type, Brand) << " " << carType4o7 << " car(s)" << (Brand.empty() ? "" : " of brand " + Brand)
+                         << " without bookings; others are checked against the rental dates" << endl;
+                }
 
-                tm RentalDate = EnterDate("Enter rental date");
-                tm ReturnDate = EnterDate("Enter return date");
+                Date RentalDate = EnterDate("Enter rental date");
+                Date ReturnDate = EnterDate("Enter return date");
                 cout << "Enter the discount rate for VIP customers (e.g., 0.1 for 10%): ";
                 cin >> discountRate;
                 cin.ignore();
 
-                CustomerList.push_back(new CustomerVIP(Name, Address, PhoneNumber, Brand, Reason, carType, RentalDate, ReturnDate, car, discountRate));
+                BookingRequest req;
+                req.name = Name;
+                req.address = Address;
+                req.phoneNumber = PhoneNumber;
+                req.brand = Brand;
+                req.reason = Reason;
+                req.carType = carType4o7;
+                req.licensePlate = licensePLate;
+                req.rentalDate = RentalDate;
+                req.returnDate = ReturnDate;
+                req.vip = true;
+                req.discountRate = discountRate;
+                string error;
+                ContractId id;
+                Customer* booked = bookCustomer(VehicleList, CustomerList, req, id, error);
+                if (!booked) {
+                    cout << error << endl;
+                    break;
+                }
+                if (req.licensePlate.empty()) {
+                    req.licensePlate = booked->getCar()->licensePlate();
+                    cout << "Assigned car: " << req.licensePlate << endl;
+                }
+                if (!journal.logAddCustomer(id, req, booked->getQuotedCents())) {
+                    removeCustomer(CustomerList, id);
+                    cout << "The booking was not made: " << journal.error() << endl;
+                    break;
+                }
+                cout << "Customer ID: " << formatContractId(id) << endl;
                 break;
             }
 
             case 3: {
-                int Position;
-                cout << "Enter the position of the customer you want to delete: ";
-                cin >> Position;
-                if (Position >= 1 && Position <= CustomerList.size()) {
-                    printBill(CustomerList[Position - 1]);
-                    saveDeletedCustomerInfo(CustomerList[Position - 1], "D:\\pb\\savedcustomer.txt");
-                    delete CustomerList[Position - 1];
-                    CustomerList.erase(CustomerList.begin() + (Position - 1));
+                string idText;
+                ContractId id;
+                cout << "Enter the ID of the customer you want to delete: ";
+                cin >> idText;
+                Customer* cus = findContract(idText, CustomerList, id);
+                if (cus) {
+                    double damageFee = printBill(cus);
+                    if (!journal.logDeleteCustomer(id, damageFee)) {
+                        cout << "The contract was not ended." << endl;
+                        break;
+                    }
+                    saveDeletedCustomerInfo(cus, archive, damageFee);
+                    checkOutCustomer(CustomerList, id, damageFee);
                     cout << "Delete successfully" << endl;
                 } else {
-                    cout << "Invalid position" << endl;
+                    cout << "Invalid customer ID" << endl;
                 }
                 break;
             }
 
             case 4: {
-                if (CustomerList.empty()) {
-                    cout << "Customer list is empty!" << endl;
-                } else {
-                    cout << "Customer list:" << endl;
-                        cout << "-----------------------------------------" << endl;
-                    for (int i = 0; i < CustomerList.size(); ++i) {
-                        cout << "Customer number " << i + 1 << ":" << endl;
-                        CustomerList[i]->GetCustomerInfo();
-                        cout << "-----------------------------------------" << endl;
-
-                    }
-                }
+                displayCustomerList(CustomerList);
                 break;
             }
 
@@ -640,12 +686,12 @@ int main() {
             }
 
             case 6: {
-                addCarMaintenance(VehicleList);
+                addCarMaintenance(VehicleList, journal);
                 break;
             }
 
             case 7: {
-                deleteCarMaintenance(VehicleList);
+                deleteCarMaintenance(VehicleList, journal);
                 break;
             }
 
@@ -655,24 +701,33 @@ int main() {
             }
 
             case 9: { // Extend rental period
-            int position;
-            cout << "Enter the position of the customer you want to extend the rental period for: ";
-            cin >> position;
-            if (position >= 1 && position <= CustomerList.size()) {
-                tm newReturnDate = EnterDate("Enter new return date");
-                CustomerList[position - 1]->extendRentalPeriod(newReturnDate);
+            string idText;
+            ContractId id;
+            cout << "Enter the ID of the customer you want to extend the rental period for: ";
+            cin >> idText;
+            Customer* cus = findContract(idText, CustomerList, id);
+            if (cus) {
+                Date newReturnDate = EnterDate("Enter new return date");
+                Date oldReturnDate = cus->getReturnDate();
+                int64_t oldQuote = cus->getQuotedCents();
+                if (cus->extendRentalPeriod(newReturnDate) && !journal.logExtendRental(id, newReturnDate, cus->getQuotedCents())) {
+                    cus->setReturnDate(oldReturnDate, oldQuote);
+                    cout << "The rental period was left as it was: " << journal.error() << endl;
+                }
             } else {
-                cout << "Invalid position!" << endl;
+                cout << "Invalid customer ID!" << endl;
             }
             break;
             }
 
             case 10: { // Change customer information
-            int position;
-            cout << "Enter the position of the customer you want to change the information for: ";
-            cin >> position;
+            string idText;
+            ContractId id;
+            cout << "Enter the ID of the customer you want to change the information for: ";
+            cin >> idText;
             cin.ignore(); // Clear the input buffer
-                if (position >= 1 && position <= CustomerList.size()) {
+            Customer* cus = findContract(idText, CustomerList, id);
+                if (cus) {
                     cout << "What information do you want to change?" << endl;
                     cout << "1. Name" << endl;
                     cout << "2. Address" << endl;
@@ -687,32 +742,28 @@ int main() {
                             string newName;
                             cout << "Enter new name: ";
                             getline(cin, newName);
-                            CustomerList[position - 1]->setName(newName);
-                            cout << "Name changed successfully." << endl;
+                            changeCustomerField(journal, cus, id, FIELD_NAME, newName, "Name");
                             break;
                         }
                         case 2: { // Change address
                             string newAddress;
                             cout << "Enter new address: ";
                             getline(cin, newAddress);
-                            CustomerList[position - 1]->setAddress(newAddress);
-                            cout << "Address changed successfully." << endl;
+                            changeCustomerField(journal, cus, id, FIELD_ADDRESS, newAddress, "Address");
                             break;
                         }
                         case 3: { // Change phone number
                             string newPhoneNumber;
                             cout << "Enter new phone number: ";
                             getline(cin, newPhoneNumber);
-                            CustomerList[position - 1]->setPhoneNumber(newPhoneNumber);
-                            cout << "Phone number changed successfully." << endl;
+                            changeCustomerField(journal, cus, id, FIELD_PHONE, newPhoneNumber, "Phone number");
                             break;
                         }
                         case 4: { // Change reason for renting
                             string newReason;
                             cout << "Enter new reason for renting: ";
                             getline(cin, newReason);
-                            CustomerList[position - 1]->setReason(newReason);
-                            cout << "Reason for renting changed successfully." << endl;
+                            changeCustomerField(journal, cus, id, FIELD_REASON, newReason, "Reason for renting");
                             break;
             }
                         default:
@@ -720,23 +771,160 @@ int main() {
                             break;
                     }
                 } else {
-                    cout << "Invalid position!" << endl;
+                    cout << "Invalid customer ID!" << endl;
+                }
+                break;
+            }
+            case 11: { // Save fleet and active rentals
+                if (compactJournal(journal, VehicleList, CustomerList)) {
+                    cout << "Snapshot saved to " << SNAPSHOT_PATH << endl;
+                } else {
+                    cout << "Unable to write snapshot file." << endl;
+                }
+                break;
+            }
+            case 12: { // End-of-day billing run over every active contract
+                BillingColumns columns = collectBillingColumns(CustomerList);
+                vector<double> bills;
+                computeBills(columns, bills);
+                double total = 0;
+                for (double bill : bills) {
+                    total += bill;
+                }
+                cout << "Active contracts: " << bills.size() << endl;
+                cout << "Total rental cost: $" << total << endl;
+                break;
+            }
+            case 13: { // Exact phone match, or the first matches of a prefix
+                string phone;
+                cout << "Enter phone number or its first digits: ";
+                getline(cin, phone);
+                size_t found = 0;
+                ReportWriter report(cout);
+                CustomerList.forEachWithPhone(phone, [&](const ContractId& id, const Customer* cus) {
+                    report << "Customer ID " << formatContractId(id) << ":\n";
+                    cus->writeInfo(report);
+                    report << "-----------------------------------------\n";
+                    found++;
+                });
+                if (found == 0 && !phone.empty()) {
+                    CustomerList.forEachWithPhonePrefix(phone, PHONE_PREFIX_MATCHES, [&](const ContractId& id, const Customer* cus) {
+                        report << "Customer ID " << formatContractId(id) << ": " << cus->getName() << ", " << cus->getPhoneNumber() << '\n';
+                        found++;
+                    });
+                }
+                if (found == 0) {
+                    report << "No customer with that phone number.\n";
+                }
+                break;
+            }
+            case 14: {
+                string idText;
+                ContractId id;
+                cout << "Enter customer ID: ";
+                getline(cin, idText);
+                Customer* cus = findContract(idText, CustomerList, id);
+                if (cus) {
+                    cus->GetCustomerInfo();
+                } else {
+                    cout << "Invalid customer ID!" << endl;
                 }
                 break;
             }
-            case 0:
-                cout << "Exit the program, wish you a good day" << endl;
+            case 15: {
+                // Contracts closed in the last few moments may still be queued for the archive
+                int query;
+                cout << "1. Revenue by month and car type" << endl;
+                cout << "2. Rentals of a car" << endl;
+                cout << "Enter your choice: ";
+                cin >> query;
+                cin.ignore();
+                if (query == 1) {
+                    string year;
+                    cout << "Enter year: ";
+                    getline(cin, year);
+                    runHistoryQuery("revenue", year);
+                } else if (query == 2) {
+                    string plate;
+                    cout << "Enter license plate: ";
+                    getline(cin, plate);
+                    runHistoryQuery("plate", plate);
+                } else {
+                    cout << "Invalid choice!" << endl;
+                }
+                break;
+            }
+            case 16:
+                completeCarMaintenance(VehicleList, journal);
+                break;
+            case 17:
+                displayMaintenanceDue(VehicleList);
+                break;
+            case 18: {
+                ReportWriter report(cout);
+                writeOperationStats(report);
                 break;
+            }
+            case 19: {
+                string levels;
+                unsigned dimensions;
+                cout << "Group by any of brand, type, class, month (Enter for the total), or \"check\" to verify: ";
+                getline(cin, levels);
+                ReportWriter report(cout);
+                if (lowerCase(levels) == "check") {
+                    checkRevenueCube(CustomerList, report);
+                } else if (parseCubeDimensions(levels, dimensions)) {
+                    writeRevenueCube(report, CustomerList.revenueCube(), dimensions);
+                } else {
+                    report << "Unknown grouping; use brand, type, class or month\n";
+                }
+                break;
+            }
+            case 20: {
+                ReportWriter report(cout);
+                writeMemoryFootprint(report, VehicleList, CustomerList);
+                break;
+            }
+            case 21: {
+                {
+                    ReportWriter report(cout);
+                    writePricingRules(report);
+                }
+                string command, error;
+                vector<string> fields;
+                cout << "Enter add|<rule> or delete|<rule number> (Enter to leave the rules as they are): ";
+                getline(cin, command);
+                if (command.empty()) {
+                    break;
+                }
+                splitFields("rule|" + command, fields);
+                size_t recomputed;
+                if (runPricingRuleCommand(fields, recomputed, error)) {
+                    cout << "Pricing rules changed, " << recomputed << " day prices recomputed. Open contracts keep their price." << endl;
+                } else {
+                    cout << error << endl;
+                }
+                break;
+            }
+            case 0: {
+                if (!compactJournal(journal, VehicleList, CustomerList)) {
+                    cout << "Unable to write snapshot file." << endl;
+                }
+                archive.close(); // so the last archive writes are counted
+                ReportWriter report(cout);
+                writeOperationStats(report);
+                report << "Exit the program, wish you a good day\n";
+                break;
+            }
             default:
                 cout << "Invalid choice!" << endl;
                 break;
         }
+        if (journal.needsCompaction() && !compactJournal(journal, VehicleList, CustomerList)) {
+            cout << "Unable to write snapshot file." << endl;
+        }
     } while (Choice != 0);
 
-    // Clean up dynamically allocated memory
-    for (Customer* cus : CustomerList) {
-        delete cus;
-    }
-
+    cin.rdbuf(terminal);
     return 0;
 }
@@ -0,0 +1,1772 @@
+// Benchmark suite. With no arguments it runs the micro-benchmarks on a
+// synthetic fleet; the --bench-* and --stress-* modes run the larger
+// scenario benchmarks.
+#include "rental_core.h"
+#include <new>
+
+using namespace std;
+
+// Heap allocations made by the process. Counted by the replaced global
+// operator new, so benchmarks can report allocations per operation.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // GCC cannot pair the replaced operators once inlined
+#endif
+atomic<uint64_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Random mix of terminal operations: half bookings, a quarter extensions and
+// a quarter returns of the terminal's own contracts. anyCarPercent of the
+// bookings leave the plate empty and take any Toyota 4-seater free for
+// their dates.
+struct ReservationWorkload {
+    struct Held {
+        ContractId id;
+        Date rentalDate;
+    };
+
+    ReservationEngine& engine;
+    const vector<string>& plates;
+    int32_t firstDay;
+    uint64_t seed;
+    vector<Held> held;
+    unsigned anyCarPercent = 0;
+    size_t booked = 0, ended = 0, extended = 0, refused = 0, anyCar = 0;
+
+    ReservationWorkload(ReservationEngine& engine, const vector<string>& plates, int32_t firstDay, uint64_t seed)
+        : engine(engine), plates(plates), firstDay(firstDay), seed(seed) {}
+
+    uint32_t next() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(seed >> 33);
+    }
+
+    void run(size_t operations) {
+        BookingRequest req;
+        req.name = "Terminal customer";
+        req.address = "54 Nguyen Luong Bang";
+        req.brand = "Toyota";
+        req.reason = "Trip";
+        req.carType = "4-seater";
+        string error;
+        for (size_t i = 0; i < operations; ++i) {
+            uint32_t op = next() % 4;
+            if (op < 2 || held.empty()) {
+                bool any = next() % 100 < anyCarPercent;
+                req.licensePlate = any ? "" : plates[next() % plates.size()];
+                req.phoneNumber = "09" + to_string(10000000 + next() % 90000000);
+                req.rentalDate = Date(firstDay + static_cast<int32_t>(next() % 365));
+                req.returnDate = Date(req.rentalDate.days + 1 + static_cast<int32_t>(next() % 14));
+                ContractId id;
+                if (engine.book(req, id, error)) {
+                    held.push_back(Held{id, req.rentalDate});
+                    booked++;
+                    anyCar += any ? 1 : 0;
+                } else {
+                    refused++;
+                }
+                continue;
+            }
+            size_t pick = next() % held.size();
+            if (op == 2) {
+                Date newReturnDate(held[pick].rentalDate.days + 1 + static_cast<int32_t>(next() % 21));
+                if (engine.extend(held[pick].id, newReturnDate, error)) {
+                    extended++;
+                } else {
+                    refused++;
+                }
+            } else {
+                if (engine.end(held[pick].id, error)) {
+                    ended++;
+                } else {
+                    refused++;
+                }
+                held[pick] = held.back();
+                held.pop_back();
+            }
+        }
+    }
+};
+
+void addStressFleet(FleetRegistry& fleet, vector<string>& plates, size_t cars) {
+    fleet.reserve(cars);
+    for (size_t i = 0; i < cars; ++i) {
+        plates.push_back("RS" + to_string(100000 + i));
+        fleet.addVehicle(Vehicle(plates.back(), "Toyota", "Red", "Good"));
+    }
+}
+
+// Books, extends and returns on a small fleet from many threads at once, a
+// quarter of the bookings without a plate, then checks that no car is
+// double-booked, that every calendar matches its contracts and that the
+// journal replays to exactly the same contracts, on the same cars
+bool runReservationStress(size_t threads, size_t operations) {
+    const size_t cars = 32; // few cars, so terminals keep colliding
+    int32_t firstDay = Date::fromYMD(2025, 1, 1).days;
+    string journalPath = "stress_journal.wal";
+    remove(journalPath.c_str());
+
+    FleetRegistry fleet;
+    vector<string> plates;
+    addStressFleet(fleet, plates, cars);
+    ContractStore contracts;
+    Journal journal;
+    if (!journal.open(journalPath, 1, 0)) {
+        cout << "Cannot create " << journalPath << endl;
+        return false;
+    }
+    journal.setSyncEvery(1 << 20);
+    ReservationEngine engine(fleet, contracts, &journal);
+
+    vector<unique_ptr<ReservationWorkload>> terminals;
+    for (size_t t = 0; t < threads; ++t) {
+        terminals.emplace_back(new ReservationWorkload(engine, plates, firstDay, t + 1));
+        terminals.back()->anyCarPercent = 25;
+    }
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] { terminals[t]->run(operations); });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    journal.sync();
+
+    size_t booked = 0, ended = 0, extended = 0, refused = 0, anyCar = 0;
+    for (const auto& terminal : terminals) {
+        booked += terminal->booked;
+        ended += terminal->ended;
+        extended += terminal->extended;
+        refused += terminal->refused;
+        anyCar += terminal->anyCar;
+    }
+    cout << threads << " threads, " << threads * operations << " operations in " << seconds << " s: " << booked << " booked ("
+         << anyCar << " without a plate), " << extended << " extended, " << ended << " returned, " << refused << " refused" << endl;
+
+    bool ok = true;
+    if (contracts.size() != booked - ended) {
+        cout << "FAILED: " << contracts.size() << " contracts left, expected " << booked - ended << endl;
+        ok = false;
+    }
+    unordered_map<const Vehicle*, vector<pair<int32_t, int32_t>>> periods;
+    contracts.forEach([&](const ContractId&, const Customer* cus) {
+        periods[cus->getCar()].emplace_back(cus->getRentalDate().days, cus->getReturnDate().days);
+    });
+    size_t doubleBooked = 0, calendarMismatch = 0;
+    fleet.forEach([&](const Vehicle& car) {
+        vector<pair<int32_t, int32_t>>& own = periods[&car];
+        sort(own.begin(), own.end());
+        for (size_t i = 1; i < own.size(); ++i) {
+            if (own[i].first < own[i - 1].second) {
+                doubleBooked++;
+            }
+        }
+        if (car.reservations.size() != own.size() || car.isAvailable() != own.empty()) {
+            calendarMismatch++;
+        }
+    });
+    if (doubleBooked > 0 || calendarMismatch > 0) {
+        cout << "FAILED: " << doubleBooked << " overlapping bookings, " << calendarMismatch << " calendars out of step" << endl;
+        ok = false;
+    }
+
+    ostringstream cubeReport;
+    ReportWriter cubeWriter(cubeReport);
+    if (!checkRevenueCube(contracts, cubeWriter)) {
+        cubeWriter.flush();
+        cout << "FAILED: " << cubeReport.str();
+        ok = false;
+    }
+
+    FleetRegistry replayedFleet;
+    vector<string> replayedPlates;
+    addStressFleet(replayedFleet, replayedPlates, cars);
+    ContractStore replayed;
+    ReplayResult replay = replayJournal(journalPath, 0, replayedFleet, replayed);
+    size_t different = 0;
+    contracts.forEach([&](const ContractId& id, const Customer* cus) {
+        const Customer* copy = replayed.get(id);
+        if (!copy || copy->getCar()->licensePlate() != cus->getCar()->licensePlate() || copy->getRentalDate() != cus->getRentalDate()
+            || copy->getReturnDate() != cus->getReturnDate()) {
+            different++;
+        }
+    });
+    if (replay.rejected > 0 || replayed.size() != contracts.size() || different > 0) {
+        cout << "FAILED: journal replay rejected " << replay.rejected << " records and differs on " << different << " contracts" << endl;
+        ok = false;
+    }
+    remove(journalPath.c_str());
+    cout << (ok ? "OK: no double booking, calendars, revenue cube and journal consistent" : "Stress test FAILED") << endl;
+    return ok;
+}
+
+// One line per thread count; journalPath is "" for no journal
+void runReservationCurve(size_t cars, int32_t firstDay, size_t operations, const string& journalPath) {
+    double baseline = 0;
+    for (size_t threads = 1; threads <= 32; threads *= 2) {
+        FleetRegistry fleet;
+        vector<string> plates;
+        addStressFleet(fleet, plates, cars);
+        ContractStore contracts;
+        contracts.reserve(threads * operations / 2);
+        Journal journal;
+        if (!journalPath.empty()) {
+            remove(journalPath.c_str());
+            if (!journal.open(journalPath, 1, 0)) {
+                cout << "Cannot create " << journalPath << endl;
+                return;
+            }
+        }
+        ReservationEngine engine(fleet, contracts, journalPath.empty() ? nullptr : &journal);
+        vector<unique_ptr<ReservationWorkload>> terminals;
+        for (size_t t = 0; t < threads; ++t) {
+            terminals.emplace_back(new ReservationWorkload(engine, plates, firstDay, t + 1));
+        }
+        vector<thread> workers;
+        auto start = chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] { terminals[t]->run(operations); });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = threads * operations / seconds;
+        if (threads == 1) {
+            baseline = rate;
+        }
+        cout << threads << " threads: " << rate << " operations/sec (" << rate / baseline << "x)";
+        if (!journalPath.empty()) {
+            cout << ", " << double(journal.syncCount()) / (threads * operations) << " fsyncs per operation";
+            journal.close();
+            remove(journalPath.c_str());
+        }
+        cout << endl;
+    }
+}
+
+// Throughput of the engine from 1 to 32 threads on a large fleet, where
+// terminals rarely want the same car. First with no journal, so only the
+// engine is measured, then (with a tenth of the operations) with a journal
+// synced on every record, where concurrent records share a sync.
+void runReservationBenchmark(size_t operations) {
+    const size_t cars = 100000;
+    int32_t firstDay = Date::fromYMD(2025, 1, 1).days;
+    string journalPath = "bench_journal.wal";
+    cout << "hardware threads: " << thread::hardware_concurrency() << ", " << operations << " operations per thread" << endl;
+    for (bool journaled : {false, true}) {
+        if (journaled) {
+            operations = max<size_t>(operations / 10, 1);
+            cout << "with a journal synced on every record, " << operations << " operations per thread:" << endl;
+        }
+        runReservationCurve(cars, firstDay, operations, journaled ? journalPath : string());
+    }
+}
+#ifndef _WIN32
+
+// Load test: the server runs in this process on its own thread with a
+// synthetic fleet and no journal; one client thread drives 'connections'
+// sockets through epoll, each sending a request as soon as the previous one
+// is answered (book a car, then return it). Reports throughput and latency
+// percentiles.
+void runServerBenchmark(size_t connectionCount, size_t requestsPerConnection) {
+    const size_t cars = 100000;
+    string socketPath = "bench_server.sock";
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    FleetRegistry fleet;
+    vector<string> plates;
+    addStressFleet(fleet, plates, cars);
+    ContractStore contracts;
+    ReservationEngine engine(fleet, contracts);
+    serverStopRequested = false;
+    thread server([&] { runServer(socketPath, engine, fleet, contracts, nullptr); });
+    while (access(socketPath.c_str(), F_OK) != 0) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    struct LoadConnection {
+        int fd = -1;
+        string in;
+        string out;
+        size_t outSent = 0;
+        size_t done = 0;
+        bool holding = false; // has a booking to return
+        ContractId held;
+        chrono::steady_clock::time_point sentAt;
+    };
+    vector<LoadConnection> load(connectionCount);
+    int poller = epoll_create1(EPOLL_CLOEXEC);
+    uint64_t seed = 99;
+    auto next = [&] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(seed >> 33);
+    };
+    int32_t firstDay = Date::fromYMD(2025, 1, 1).days;
+    BookingRequest req;
+    req.name = "Load customer";
+    req.address = "54 Nguyen Luong Bang";
+    req.brand = "Toyota";
+    req.reason = "Trip";
+    req.carType = "4-seater";
+    auto sendNext = [&](LoadConnection& c) {
+        JournalEncoder body;
+        uint8_t op;
+        if (c.holding) {
+            op = OP_END;
+            body.putU32(c.held.slot);
+            body.putU32(c.held.generation);
+        } else {
+            op = OP_BOOK;
+            req.licensePlate = plates[next() % plates.size()];
+            req.phoneNumber = "09" + to_string(10000000 + next() % 90000000);
+            req.rentalDate = Date(firstDay + static_cast<int32_t>(next() % 365));
+            req.returnDate = Date(req.rentalDate.days + 1 + static_cast<int32_t>(next() % 14));
+            putBookingRequest(body, req);
+        }
+        appendFrame(c.out, op, body.data());
+        c.sentAt = chrono::steady_clock::now();
+        ssize_t sent = send(c.fd, c.out.data() + c.outSent, c.out.size() - c.outSent, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c.outSent += static_cast<size_t>(sent);
+        }
+        if (c.outSent == c.out.size()) {
+            c.out.clear();
+            c.outSent = 0;
+        }
+    };
+
+    auto connectStart = chrono::steady_clock::now();
+    for (size_t i = 0; i < connectionCount; ++i) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            cout << "connection " << i << " failed: " << strerror(errno) << endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            connectionCount = i;
+            load.resize(i);
+            break;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        load[i].fd = fd;
+        epoll_event add = {};
+        add.events = EPOLLIN;
+        add.data.u64 = i;
+        epoll_ctl(poller, EPOLL_CTL_ADD, fd, &add);
+    }
+    double connectSeconds = chrono::duration<double>(chrono::steady_clock::now() - connectStart).count();
+
+    vector<double> latencies;
+    latencies.reserve(connectionCount * requestsPerConnection);
+    size_t active = connectionCount, booked = 0, refused = 0;
+    auto start = chrono::steady_clock::now();
+    for (LoadConnection& c : load) {
+        sendNext(c);
+    }
+    vector<epoll_event> events(1024);
+    char buffer[64 * 1024];
+    while (active > 0) {
+        int ready = epoll_wait(poller, events.data(), static_cast<int>(events.size()), 1000);
+        if (ready <= 0) {
+            if (ready == 0) {
+                cout << "the server stopped answering" << endl;
+                break;
+            }
+            continue;
+        }
+        for (int e = 0; e < ready; ++e) {
+            LoadConnection& c = load[events[e].data.u64];
+            ssize_t got;
+            while ((got = recv(c.fd, buffer, sizeof(buffer), 0)) > 0) {
+                c.in.append(buffer, static_cast<size_t>(got));
+            }
+            while (c.in.size() >= 5) {
+                uint32_t length;
+                memcpy(&length, c.in.data(), 4);
+                if (c.in.size() - 4 < length) {
+                    break;
+                }
+                latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - c.sentAt).count());
+                uint8_t status = static_cast<uint8_t>(c.in[4]);
+                if (!c.holding && status == STATUS_OK) {
+                    memcpy(&c.held.slot, c.in.data() + 5, 4);
+                    memcpy(&c.held.generation, c.in.data() + 9, 4);
+                    c.holding = true;
+                    booked++;
+                } else if (c.holding) {
+                    c.holding = false;
+                } else {
+                    refused++;
+                }
+                c.in.erase(0, 4 + length);
+                if (++c.done < requestsPerConnection) {
+                    sendNext(c);
+                } else {
+                    active--;
+                }
+            }
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (LoadConnection& c : load) {
+        close(c.fd);
+    }
+    close(poller);
+    serverStopRequested = true;
+    server.join();
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies.empty() ? 0 : latencies[min(latencies.size() - 1, static_cast<size_t>(latencies.size() * p))]; };
+    cout << connectionCount << " connections opened in " << connectSeconds * 1000 << " ms" << endl;
+    cout << latencies.size() << " requests in " << seconds << " s: " << latencies.size() / seconds << " requests/sec ("
+         << booked << " bookings, " << refused << " refused)" << endl;
+    cout << "latency: p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) << " us, p99.9 " << percentile(0.999)
+         << " us, max " << (latencies.empty() ? 0 : latencies.back()) << " us" << endl;
+}
+#endif
+
+// Benchmark a save/load round trip with the given number of active contracts
+void runSnapshotBenchmark(size_t contracts) {
+    FleetRegistry fleet;
+    ContractStore customerList;
+    Date rental = Date::fromYMD(2025, 1, 1);
+    Date giveBack = Date::fromYMD(2025, 1, 8);
+    ContractId id;
+    for (size_t i = 0; i < contracts; ++i) {
+        Vehicle* car = fleet.addVehicle(Vehicle("BK" + to_string(1000000 + i), "Toyota", "Red", "Good"));
+        if (i % 2 == 0) {
+            customerList.emplace<Customer>(id, "Customer " + to_string(i), "54 Nguyen Luong Bang", "0905" + to_string(100000 + i),
+                "Toyota", "Business", CAR_4_SEATER, rental, giveBack, car);
+        } else {
+            customerList.emplace<CustomerVIP>(id, "Customer " + to_string(i), "54 Nguyen Luong Bang", "0905" + to_string(100000 + i),
+                "Toyota", "Holiday", CAR_7_SEATER, rental, giveBack, car, 0.1);
+        }
+    }
+
+    string path = "bench_fleet.snap";
+    auto start = chrono::steady_clock::now();
+    if (!saveSnapshot(fleet, customerList, path)) {
+        cout << "Unable to write snapshot " << path << endl;
+        return;
+    }
+    double saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    FleetRegistry loadedFleet;
+    ContractStore loadedCustomers;
+    start = chrono::steady_clock::now();
+    uint64_t lastJournalSequence;
+    SnapshotStatus status = loadSnapshot(path, loadedFleet, loadedCustomers, lastJournalSequence);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "Contracts: " << contracts << ", save " << saveMs << " ms, load " << loadMs << " ms ("
+         << (status == SnapshotStatus::Loaded ? "ok" : "failed") << ", " << loadedFleet.size() << " vehicles, "
+         << loadedCustomers.size() << " customers)" << endl;
+    remove(path.c_str());
+}
+
+// Benchmark the journal: booking latency as the fsync group grows, then
+// replay throughput over a journal of mixed records
+void runJournalBenchmark(size_t replayBookings) {
+    string path = "bench_journal.wal";
+    BookingRequest req;
+    req.name = "Nguyen Van A";
+    req.address = "54 Nguyen Luong Bang";
+    req.phoneNumber = "0905123456";
+    req.brand = "Toyota";
+    req.reason = "Business";
+    req.carType = "4-seater";
+    req.rentalDate = Date::fromYMD(2025, 1, 1);
+    req.returnDate = Date::fromYMD(2025, 1, 8);
+    int64_t quote = pricing().quote(CAR_4_SEATER, req.rentalDate, req.returnDate);
+
+    const size_t groupSizes[] = {1, 8, 64, 512};
+    for (size_t group : groupSizes) {
+        remove(path.c_str());
+        Journal journal;
+        if (!journal.open(path, 1, 0)) {
+            cout << "Unable to open " << path << endl;
+            return;
+        }
+        journal.setSyncEvery(group);
+        size_t bookings = group == 1 ? 2000 : 20000;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < bookings; ++i) {
+            req.licensePlate = "BK" + to_string(1000000 + i);
+            journal.logAddCustomer(ContractId{static_cast<uint32_t>(i), 0}, req, quote);
+        }
+        journal.sync();
+        double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / bookings;
+        cout << "Group commit of " << group << ": " << us << " us per booking, "
+             << double(journal.syncCount()) / bookings << " fsyncs per booking" << endl;
+    }
+
+    // Journal of bookings, extensions, phone changes and maintenance in equal
+    // parts. Bookings into an empty store take IDs 1..n in order.
+    remove(path.c_str());
+    FleetRegistry fleet;
+    fleet.reserve(replayBookings);
+    {
+        Journal journal;
+        journal.open(path, 1, 0);
+        journal.setSyncEvery(100000);
+        for (size_t i = 0; i < replayBookings; ++i) {
+            req.licensePlate = "BK" + to_string(1000000 + i);
+            fleet.addVehicle(Vehicle(req.licensePlate, "Toyota", "Red", "Good"));
+            journal.logAddCustomer(ContractId{static_cast<uint32_t>(i), 0}, req, quote);
+        }
+        Date later = Date::fromYMD(2025, 1, 15);
+        int64_t laterQuote = pricing().quote(CAR_4_SEATER, req.rentalDate, later);
+        for (size_t i = 0; i < replayBookings; ++i) {
+            ContractId id{static_cast<uint32_t>(i), 0};
+            journal.logExtendRental(id, later, laterQuote);
+            journal.logChangeInfo(id, FIELD_PHONE, "0914" + to_string(100000 + i));
+            journal.logScheduleMaintenance(MaintenanceTaskId{static_cast<uint32_t>(i), 0}, "BK" + to_string(1000000 + i), "Oil change", later);
+        }
+    }
+
+    ContractStore customerList;
+    auto start = chrono::steady_clock::now();
+    ReplayResult result = replayJournal(path, 0, fleet, customerList);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Replayed " << result.applied << " records (" << result.rejected << " rejected) in " << seconds * 1000
+         << " ms: " << result.applied / seconds << " records/sec" << endl;
+    remove(path.c_str());
+}
+
+// Benchmark rental day counting over many contracts: the old struct tm +
+// mktime computation against Date subtraction
+void runDateBenchmark(size_t contracts) {
+    vector<tm> oldRental(contracts), oldReturn(contracts);
+    vector<Date> rental(contracts), giveBack(contracts);
+    for (size_t i = 0; i < contracts; ++i) {
+        int day = 1 + static_cast<int>(i % 28), month = 1 + static_cast<int>(i / 28 % 12), length = 1 + static_cast<int>(i % 30);
+        rental[i] = Date::fromYMD(2025, month, day);
+        giveBack[i] = Date(rental[i].days + length);
+        tm t = {};
+        t.tm_year = 125;
+        t.tm_mon = month - 1;
+        t.tm_mday = day;
+        oldRental[i] = t;
+        t.tm_mday += length;
+        oldReturn[i] = t;
+    }
+
+    long long oldTotal = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < contracts; ++i) {
+        time_t tRental = mktime(&oldRental[i]);
+        time_t tReturn = mktime(&oldReturn[i]);
+        oldTotal += static_cast<int>(difftime(tReturn, tRental) / (60 * 60 * 24));
+    }
+    double oldNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / contracts;
+
+    long long newTotal = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < contracts; ++i) {
+        newTotal += giveBack[i] - rental[i];
+    }
+    double newNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / contracts;
+
+    cout << "Contracts: " << contracts << endl;
+    cout << "struct tm + mktime: " << oldNs << " ns/contract, " << sizeof(tm) << " bytes per date, total " << oldTotal << " days" << endl;
+    cout << "Date subtraction:   " << newNs << " ns/contract, " << sizeof(Date) << " bytes per date, total " << newTotal << " days" << endl;
+}
+
+// Benchmark batch billing: per-object virtual calls against the scalar and
+// AVX2 column kernels, checking that all three agree exactly
+void runBillingBenchmark() {
+    const size_t sizes[] = {1000000, 10000000};
+    for (size_t contracts : sizes) {
+        Date rental = Date::fromYMD(2025, 1, 1);
+        BillingColumns columns;
+        columns.reserve(contracts);
+        for (size_t i = 0; i < contracts; ++i) {
+            Date giveBack(rental.days + 1 + static_cast<int32_t>(i % 30));
+            CarTypeId carType = i % 3 == 0 ? CAR_7_SEATER : CAR_4_SEATER;
+            columns.add(pricing().quote(carType, rental, giveBack) / 100.0, i % 4 == 0 ? 0.05 * (i % 7) : 0);
+        }
+        vector<double> scalarBills, simdBills;
+
+        auto start = chrono::steady_clock::now();
+        computeBills(columns, scalarBills, false);
+        double scalarSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        computeBills(columns, simdBills, true);
+        double simdSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << "Contracts: " << contracts << endl;
+        cout << "  scalar kernel: " << contracts / scalarSeconds << " contracts/sec" << endl;
+#ifdef BILLING_HAS_AVX2
+        cout << "  AVX2 kernel:   " << contracts / simdSeconds << " contracts/sec" << (cpuHasAvx2() ? "" : " (not supported, scalar used)") << endl;
+#else
+        cout << "  AVX2 kernel:   not built, scalar used (" << contracts / simdSeconds << " contracts/sec)" << endl;
+#endif
+        cout << "  kernels agree: " << (memcmp(scalarBills.data(), simdBills.data(), contracts * sizeof(double)) == 0 ? "yes" : "NO") << endl;
+
+        // The per-object path needs real customers, so it is measured at 10^6 only
+        if (contracts > 1000000) {
+            continue;
+        }
+        FleetRegistry fleet;
+        fleet.reserve(contracts);
+        ContractStore customerList;
+        ContractId id; // distinct phone numbers: equal ones share one probe run in the phone index
+        for (size_t i = 0; i < contracts; ++i) {
+            Vehicle* car = fleet.addVehicle(Vehicle("BK" + to_string(1000000 + i), "Toyota", "Red", "Good"));
+            Date giveBack(rental.days + 1 + static_cast<int32_t>(i % 30));
+            CarTypeId carType = i % 3 == 0 ? CAR_7_SEATER : CAR_4_SEATER;
+            if (columns.discountRate[i] != 0) {
+                customerList.emplace<CustomerVIP>(id, "A", "B", to_string(i), "Toyota", "R", carType, rental, giveBack, car, columns.discountRate[i]);
+            } else {
+                customerList.emplace<Customer>(id, "A", "B", to_string(i), "Toyota", "R", carType, rental, giveBack, car);
+            }
+        }
+        vector<double> objectBills(contracts);
+        size_t next = 0;
+        start = chrono::steady_clock::now();
+        customerList.forEach([&](const ContractId&, const Customer* cus) {
+            objectBills[next++] = cus->calculateRentalCost();
+        });
+        double objectSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        BillingColumns collected = collectBillingColumns(customerList);
+        double collectSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        vector<double> collectedBills;
+        computeBills(collected, collectedBills);
+
+        cout << "  per-object:    " << contracts / objectSeconds << " contracts/sec" << endl;
+        cout << "  column gather: " << contracts / collectSeconds << " contracts/sec" << endl;
+        cout << "  matches per-object path: "
+             << (memcmp(objectBills.data(), collectedBills.data(), contracts * sizeof(double)) == 0
+                 && memcmp(objectBills.data(), simdBills.data(), contracts * sizeof(double)) == 0 ? "yes" : "NO") << endl;
+    }
+}
+
+// Benchmark the pricing engine with a typical rule set: quotes from the
+// compiled calendars against pricing every day from the rules, and a full
+// compile against the incremental one after adding a single holiday
+void runPricingBenchmark(size_t quotes) {
+    vector<PricingRule> rules;
+    PricingRule rule;
+    rule.kind = RULE_SEASON;
+    rule.fromMonth = 6, rule.fromDay = 15, rule.toMonth = 8, rule.toDay = 31, rule.factor = 1.3;
+    rules.push_back(rule);
+    rule.fromMonth = 12, rule.fromDay = 20, rule.toMonth = 1, rule.toDay = 5, rule.factor = 1.5;
+    rules.push_back(rule);
+    rule.kind = RULE_WEEKEND;
+    rule.factor = 1.15;
+    rules.push_back(rule);
+    rule.kind = RULE_HOLIDAY;
+    rule.allTypes = false, rule.carType = CAR_7_SEATER, rule.factor = 1.25;
+    const int holidays[][2] = {{1, 1}, {30, 4}, {1, 5}, {2, 9}, {24, 12}};
+    for (const auto& holiday : holidays) {
+        rule.fromDay = holiday[0], rule.fromMonth = holiday[1];
+        rules.push_back(rule);
+    }
+    rule = PricingRule();
+    rule.kind = RULE_LONG_RENTAL;
+    rule.minDays = 7, rule.discount = 0.05;
+    rules.push_back(rule);
+    rule.minDays = 30, rule.discount = 0.15;
+    rules.push_back(rule);
+
+    PricingEngine compiled, uncompiled;
+    for (const PricingRule& r : rules) {
+        compiled.addRule(r);
+        uncompiled.addRule(r);
+    }
+    auto start = chrono::steady_clock::now();
+    size_t fullDays = compiled.compile();
+    double fullMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    rule = PricingRule();
+    rule.kind = RULE_HOLIDAY;
+    rule.fromDay = 14, rule.fromMonth = 7, rule.year = 2026, rule.factor = 1.4;
+    compiled.addRule(rule);
+    uncompiled.addRule(rule);
+    start = chrono::steady_clock::now();
+    size_t incrementalDays = compiled.compile();
+    double incrementalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "Rules: " << compiled.ruleList().size() << ", calendars " << compiled.memoryBytes() / (1024.0 * 1024.0) << " MB" << endl;
+    cout << "  full compile:        " << fullDays << " days in " << fullMs << " ms" << endl;
+    cout << "  add one holiday:     " << incrementalDays << " days in " << incrementalMs << " ms" << endl;
+
+    rule.kind = RULE_SEASON;
+    rule.fromDay = 1, rule.fromMonth = 3, rule.toDay = 15, rule.toMonth = 3, rule.factor = 0.9;
+    compiled.addRule(rule);
+    uncompiled.addRule(rule);
+    start = chrono::steady_clock::now();
+    incrementalDays = compiled.compile();
+    incrementalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "  add one season:      " << incrementalDays << " days in " << incrementalMs << " ms" << endl;
+
+    // Rentals of 1 to 90 days starting anywhere in 2025-2027
+    vector<Date> from(quotes), to(quotes);
+    vector<CarTypeId> types(quotes);
+    SyntheticRandom random(7);
+    Date first = Date::fromYMD(2025, 1, 1);
+    for (size_t i = 0; i < quotes; ++i) {
+        from[i] = Date(first.days + static_cast<int32_t>(random.below(3 * 365)));
+        to[i] = Date(from[i].days + 1 + static_cast<int32_t>(random.below(90)));
+        types[i] = random.below(2) ? CAR_7_SEATER : CAR_4_SEATER;
+    }
+    int64_t compiledTotal = 0, perDayTotal = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < quotes; ++i) {
+        compiledTotal += compiled.quote(types[i], from[i], to[i]);
+    }
+    double compiledNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / quotes;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < quotes; ++i) {
+        perDayTotal += uncompiled.quote(types[i], from[i], to[i]);
+    }
+    double perDayNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / quotes;
+
+    cout << "Quotes: " << quotes << " (1-90 days)" << endl;
+    cout << "  compiled calendars:  " << compiledNs << " ns/quote" << endl;
+    cout << "  day-by-day rules:    " << perDayNs << " ns/quote (x" << perDayNs / compiledNs << ")" << endl;
+    cout << "  totals agree: " << (compiledTotal == perDayTotal ? "yes" : "NO") << endl;
+}
+
+// Benchmark plate lookup: the old linear scan over vector<Vehicle> against the
+// fleet registry hash index, at several fleet sizes
+void runLookupBenchmark() {
+    const size_t fleetSizes[] = {1000, 100000, 1000000};
+    for (size_t n : fleetSizes) {
+        vector<string> scanList; // the plates, as the old vector<Vehicle> held them
+        FleetRegistry registry;
+        scanList.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            scanList.push_back("BK" + to_string(1000000 + i));
+            registry.addVehicle(Vehicle(scanList.back(), "Toyota", "Red", "Good"));
+        }
+
+        // Same pseudo-random sequence of existing plates for both lookups
+        size_t indexLookups = 1000000;
+        size_t scanLookups = min<size_t>(indexLookups, 200000000 / n);
+        vector<string> queries;
+        uint64_t seed = 12345;
+        for (size_t i = 0; i < indexLookups; ++i) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            queries.push_back(scanList[(seed >> 33) % n]);
+        }
+
+        size_t found = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < scanLookups; ++i) {
+            for (const string& plate : scanList) {
+                if (plate == queries[i]) {
+                    found++;
+                    break;
+                }
+            }
+        }
+        double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / scanLookups;
+
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < indexLookups; ++i) {
+            if (registry.find(queries[i])) {
+                found++;
+            }
+        }
+        double indexNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / indexLookups;
+
+        cout << "Fleet size " << n << ": linear scan " << scanNs << " ns/lookup, hash index "
+             << indexNs << " ns/lookup (speedup x" << scanNs / indexNs << ", " << found << " hits)" << endl;
+    }
+}
+
+// Case-insensitive comparison against an already lower-cased value
+bool equalsLower(const string& value, const string& lower) {
+    if (value.size() != lower.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(value[i])) != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// What a search cost before the attribute index: every vehicle tested
+bool scanMatches(const FleetQuery& query, const Vehicle& xe) {
+    auto anyOf = [](const vector<string>& values, const string& field) {
+        if (values.empty()) {
+            return true;
+        }
+        for (const string& value : values) {
+            if (equalsLower(field, value)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!anyOf(query.brands, xe.brandText()) || !anyOf(query.colors, xe.colorText()) || !anyOf(query.conditions, xe.conditionText())) {
+        return false;
+    }
+    if (!query.carTypes.empty() && find(query.carTypes.begin(), query.carTypes.end(), xe.carType) == query.carTypes.end()) {
+        return false;
+    }
+    if ((query.availability == Availability::Available && !xe.isAvailable()) || (query.availability == Availability::Rented && xe.isAvailable())) {
+        return false;
+    }
+    for (const string& filter : query.textFilters) {
+        if (!matchesFilter(filter, xe.licensePlate(), xe.brandText(), xe.colorText())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Benchmark car search on a synthetic fleet with about 40% of the cars out:
+// the bitmap index against a scan of every vehicle, for a few typical queries
+void runFleetSearchBenchmark(size_t cars) {
+    SyntheticConfig config;
+    config.cars = cars;
+    FleetRegistry fleet;
+    vector<string> plates;
+    generateFleet(fleet, config, &plates);
+    for (size_t i = 0; i < plates.size(); i += 5) {
+        // Only the flag matters to the search, so no contracts are made
+        fleet.find(plates[i])->setAvailable(false);
+        if (i + 1 < plates.size()) {
+            fleet.find(plates[i + 1])->setAvailable(false);
+        }
+    }
+    cout << "Fleet of " << cars << " cars, index " << fleet.index().memoryBytes() / (1024.0 * 1024.0) << " MB" << endl;
+
+    const char* const searches[] = {"", "toyota", "toyota red", "honda blue good 7-seater", "ford kia black white", "rented vinfast silver", "all new 4-seater"};
+    const int repeats = 20;
+    for (const char* search : searches) {
+        FleetQuery query = parseFleetQuery(fleet, search);
+        size_t indexed = 0;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            indexed = searchFleet(fleet, query).cardinality();
+        }
+        double indexMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+
+        size_t scanned = 0;
+        start = chrono::steady_clock::now();
+        fleet.forEach([&](const Vehicle& xe) {
+            scanned += scanMatches(query, xe) ? 1 : 0;
+        });
+        double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        cout << "  \"" << search << "\": " << indexed << " cars, index " << indexMs << " ms, scan " << scanMs << " ms (x"
+             << scanMs / indexMs << ")" << (indexed == scanned ? "" : ", counts DIFFER") << endl;
+    }
+}
+
+// Benchmark the CSV fleet import on a synthetic inventory with a bad row in
+// every thousand: parsing alone (a check) and the full import into an empty
+// fleet, as the number of parsing threads grows
+void runImportBenchmark(size_t rows) {
+    static const char* const brands[] = {"Toyota", "Honda", "Ford", "Chevrolet", "Hyundai", "Kia", "Mazda", "VinFast"};
+    static const char* const colors[] = {"Red", "Blue", "Black", "White", "Silver", "Grey"};
+    static const char* const conditions[] = {"Good", "Good", "Good", "Fair", "New"};
+    string path = "bench_fleet.csv";
+    {
+        ofstream out(path, ios::binary);
+        SyntheticRandom random(3);
+        out << "plate,brand,color,type,condition,tasks\n";
+        for (size_t i = 0; i < rows; ++i) {
+            out << syntheticPlate(i) << ',' << brands[random.below(8)] << ',' << colors[random.below(6)] << ','
+                << (i % 1000 == 999 ? "bus" : random.below(10) < 7 ? "4-seater" : "7-seater") << ',' << conditions[random.below(5)];
+            if (i % 5 == 0) {
+                out << ",Oil change," << 1 + random.below(28) << '/' << 1 + random.below(12) << "/2026";
+            }
+            out << '\n';
+        }
+    }
+    struct stat info;
+    stat(path.c_str(), &info);
+    cout << "Inventory: " << rows << " rows, " << info.st_size / (1024.0 * 1024.0) << " MB; hardware threads: " << thread::hardware_concurrency() << endl;
+
+    ostringstream rejected; // one line per bad row, not shown
+    const size_t threadCounts[] = {1, 2, 4, 8};
+    for (size_t threads : threadCounts) {
+        FleetImportResult check, import;
+        {
+            ReportWriter report(rejected);
+            importFleetCsv(path, nullptr, threads, report, check);
+        }
+        FleetRegistry fleet;
+        {
+            ReportWriter report(rejected);
+            importFleetCsv(path, &fleet, threads, report, import);
+        }
+        cout << "  " << threads << " thread(s): parse " << check.rows / check.seconds << " rows/sec, import "
+             << import.rows / import.seconds << " rows/sec (" << import.vehicles << " vehicles, " << import.tasks << " tasks, "
+             << import.rejected << " rejected)" << endl;
+    }
+    remove(path.c_str());
+}
+
+// Vehicle record as it was laid out before the per-slot arrays: every field
+// inline, so reading the availability of a car loads its record
+struct InlineVehicle {
+    string licensePlate;
+    string brand;
+    string color;
+    bool available;
+    string condition;
+    CarTypeId carType;
+    vector<MaintenanceTaskId> maintenanceTasks;
+    ReservationCalendar reservations;
+    uint32_t slot;
+    FleetIndex* attributeIndex;
+};
+
+// Benchmark whole-fleet availability scans and plate lookups that check
+// availability, on records laid out as before (InlineVehicle) and on the
+// fleet's per-slot arrays, with about 40% of the cars out
+void runFleetScanBenchmark(size_t cars) {
+    SyntheticConfig config;
+    config.cars = cars;
+    FleetRegistry fleet;
+    vector<string> plates;
+    generateFleet(fleet, config, &plates);
+    deque<InlineVehicle> records;
+    for (size_t i = 0; i < plates.size(); ++i) {
+        Vehicle* car = fleet.find(plates[i]);
+        if (i % 5 < 2) {
+            car->setAvailable(false);
+        }
+        records.push_back(InlineVehicle{car->licensePlate(), car->brandText(), car->colorText(), car->isAvailable(), car->conditionText(),
+            car->carType, vector<MaintenanceTaskId>(), ReservationCalendar(), car->slot, nullptr});
+    }
+    cout << "Fleet of " << cars << " cars; a scan steps through " << sizeof(InlineVehicle) << "-byte inline records or "
+         << sizeof(uint8_t) + sizeof(CarTypeId) << " bytes of slot arrays per car (Vehicle record now " << sizeof(Vehicle) << " bytes)" << endl;
+
+    const int repeats = 10;
+    size_t inlineCount = 0, slotCount = 0, bitsetCount = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        inlineCount = 0;
+        for (const InlineVehicle& record : records) {
+            inlineCount += record.available && record.carType == CAR_7_SEATER;
+        }
+    }
+    double inlineMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+    const vector<uint8_t>& status = fleet.index().slotStatus();
+    const vector<CarTypeId>& types = fleet.index().slotTypes();
+    const uint8_t free = FleetIndex::SLOT_IN_SERVICE | FleetIndex::SLOT_AVAILABLE;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        slotCount = 0;
+        for (size_t i = 0; i < status.size(); ++i) {
+            slotCount += status[i] == free && types[i] == CAR_7_SEATER;
+        }
+    }
+    double slotMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        bitsetCount = fleet.countAvailable(CAR_7_SEATER);
+    }
+    double bitsetMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+    cout << "  free 7-seaters: inline records " << inlineMs << " ms, slot arrays " << slotMs << " ms (x" << inlineMs / slotMs << "), free bitset "
+         << bitsetMs * 1e6 << " ns" << (inlineCount == slotCount && slotCount == bitsetCount ? "" : ", counts DIFFER") << endl;
+
+    // Same pseudo-random plates for both; the probe into the plate index is shared
+    size_t lookups = 1000000;
+    vector<const string*> queries(lookups);
+    SyntheticRandom random(11);
+    for (size_t i = 0; i < lookups; ++i) {
+        queries[i] = &plates[random.below(static_cast<uint32_t>(plates.size()))];
+    }
+    size_t inlineFree = 0, slotFree = 0;
+    uint32_t slot;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        inlineFree += fleet.findSlot(*queries[i], slot) && records[slot].available;
+    }
+    double inlineNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        slotFree += fleet.findSlot(*queries[i], slot) && fleet.isAvailable(slot);
+    }
+    double slotNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups;
+    cout << "  plate lookup + availability: inline records " << inlineNs << " ns, slot arrays " << slotNs << " ns (x" << inlineNs / slotNs << ")"
+         << (inlineFree == slotFree ? "" : ", results DIFFER") << endl;
+}
+
+// Benchmark picking any free car of a type as the fleet fills up: each step
+// takes a car and hands back a random rented one, so the share rented stays
+// put. The free bitsets are compared with a scan of the slot arrays from the
+// first slot, which is what finding a car without them comes to.
+void runAssignBenchmark(size_t cars) {
+    SyntheticConfig config;
+    config.cars = cars;
+    const double rentedShares[] = {0.0, 0.5, 0.9, 0.99, 0.999};
+    const size_t steps = 20000; // the scans run a tenth of these
+    cout << "Fleet of " << cars << " cars; one step picks a free 7-seater (of any brand / a Toyota), rents it and returns a rented car" << endl;
+    for (double share : rentedShares) {
+        FleetRegistry fleet;
+        vector<string> plates;
+        generateFleet(fleet, config, &plates);
+        vector<Vehicle*> rented;
+        SyntheticRandom random(17);
+        for (const string& plate : plates) {
+            if (random.below(1000000) < share * 1000000) {
+                Vehicle* car = fleet.find(plate);
+                car->setAvailable(false);
+                rented.push_back(car);
+            }
+        }
+        const vector<uint8_t>& status = fleet.index().slotStatus();
+        const vector<CarTypeId>& types = fleet.index().slotTypes();
+        const uint8_t free = FleetIndex::SLOT_IN_SERVICE | FleetIndex::SLOT_AVAILABLE;
+        size_t freeSevens = fleet.countAvailable(CAR_7_SEATER);
+
+        // Each variant runs the same pick/rent/return cycle from the same state
+        auto pickByScan = [&](const char* brand) -> Vehicle* {
+            for (size_t slot = 0; slot < status.size(); ++slot) {
+                if (status[slot] == free && types[slot] == CAR_7_SEATER && (!*brand || fleet.at(static_cast<uint32_t>(slot)).brandText() == brand)) {
+                    return fleet.find(fleet.at(static_cast<uint32_t>(slot)).licensePlate());
+                }
+            }
+            return nullptr;
+        };
+        bool same = pickByScan("") == fleet.findFree(CAR_7_SEATER) && pickByScan("Toyota") == fleet.findFree(CAR_7_SEATER, "Toyota");
+        auto run = [&](const char* brand, bool scan) {
+            vector<Vehicle*> out = rented;
+            SyntheticRandom cycle(23);
+            size_t count = scan ? steps / 10 : steps;
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                Vehicle* car = scan ? pickByScan(brand) : fleet.findFree(CAR_7_SEATER, brand);
+                if (car) {
+                    car->setAvailable(false);
+                    out.push_back(car);
+                }
+                if (!out.empty()) {
+                    size_t back = cycle.below(static_cast<uint32_t>(out.size()));
+                    out[back]->setAvailable(true);
+                    out[back] = out.back();
+                    out.pop_back();
+                }
+            }
+            double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / count;
+            for (Vehicle* car : out) { // back to the shared starting state
+                car->setAvailable(true);
+            }
+            for (Vehicle* car : rented) {
+                car->setAvailable(false);
+            }
+            return ns;
+        };
+        auto scanAny = run("", true);
+        auto bitsetAny = run("", false);
+        auto scanBrand = run("Toyota", true);
+        auto bitsetBrand = run("Toyota", false);
+
+        cout << "  " << share * 100 << "% rented (" << freeSevens << " free 7-seaters): any brand: scan " << scanAny << " ns, bitset "
+             << bitsetAny << " ns (x" << scanAny / bitsetAny << "); Toyota: scan " << scanBrand << " ns, bitset " << bitsetBrand << " ns (x"
+             << scanBrand / bitsetBrand << ")" << (same ? "" : ", picks DIFFER") << endl;
+    }
+}
+
+// Picking a car free for given dates once most cars have bookings: the day
+// free sets against a slot-order scan of the calendars, which is what
+// findFree fell back to once no car was without bookings. Each car is booked
+// for about the given share of 2025 in stays of 1 to 4 weeks; the picks ask
+// for 1 to 14 days starting anywhere in 2025.
+void runDatedAssignBenchmark(size_t cars) {
+    const double bookedShares[] = {0.5, 0.9, 0.99};
+    const size_t picks = 2000; // the scans run a tenth of these
+    int32_t firstDay = Date::fromYMD(2025, 1, 1).days, lastDay = Date::fromYMD(2026, 1, 1).days;
+    cout << "Fleet of " << cars << " cars; one pick finds a 4-seater free for 1 to 14 days" << endl;
+    for (double share : bookedShares) {
+        FleetRegistry fleet;
+        vector<string> plates;
+        addStressFleet(fleet, plates, cars);
+        SyntheticRandom random(29);
+        for (const string& plate : plates) {
+            Vehicle* car = fleet.find(plate);
+            for (int32_t day = firstDay; day < lastDay;) {
+                int32_t stay = 7 + static_cast<int32_t>(random.below(22));
+                int32_t meanGap = static_cast<int32_t>(stay * (1 - share) / share);
+                day += static_cast<int32_t>(random.below(static_cast<uint32_t>(2 * meanGap + 1)));
+                car->reserve(day, day + stay);
+                day += stay;
+            }
+            car->setAvailable(false);
+        }
+        vector<pair<Date, Date>> periods;
+        for (size_t i = 0; i < picks; ++i) {
+            Date from(firstDay + static_cast<int32_t>(random.below(365)));
+            periods.emplace_back(from, Date(from.days + 1 + static_cast<int32_t>(random.below(14))));
+        }
+
+        auto pickByScan = [&](const pair<Date, Date>& period) -> Vehicle* {
+            Vehicle* found = nullptr;
+            fleet.visitFrom(0, [&](const Vehicle& car) {
+                if (car.carType == CAR_4_SEATER && car.reservations.isFree(period.first.days, period.second.days)) {
+                    found = fleet.find(car.licensePlate());
+                }
+                return !found;
+            });
+            return found;
+        };
+        size_t agree = 0, found = 0;
+        for (size_t i = 0; i < picks / 10; ++i) {
+            agree += (pickByScan(periods[i]) != nullptr) == (fleet.findFree(CAR_4_SEATER, "", periods[i].first, periods[i].second) != nullptr);
+        }
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < picks / 10; ++i) {
+            pickByScan(periods[i]);
+        }
+        double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (picks / 10);
+        start = chrono::steady_clock::now();
+        for (const auto& period : periods) {
+            found += fleet.findFree(CAR_4_SEATER, "", period.first, period.second) != nullptr;
+        }
+        double weekNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / picks;
+
+        cout << "  " << share * 100 << "% booked (" << found << " of " << picks << " picks find a car): scan " << scanNs << " ns, day sets "
+             << weekNs << " ns (x" << scanNs / weekNs << ")" << (agree == picks / 10 ? "" : ", results DIFFER") << endl;
+    }
+}
+
+// Benchmark customer lookup over the given number of active contracts: a
+// scan of every contract (what reading case 4 amounts to) against the phone
+// index, exact and by prefix, and the cost of keeping it current
+void runCustomerLookupBenchmark(size_t contracts) {
+    FleetRegistry fleet;
+    fleet.reserve(contracts);
+    ContractStore customerList;
+    Date rental = Date::fromYMD(2025, 1, 1);
+    Date giveBack = Date::fromYMD(2025, 1, 8);
+    ContractId id;
+    vector<string> phones(contracts);
+    for (size_t i = 0; i < contracts; ++i) {
+        Vehicle* car = fleet.addVehicle(Vehicle("BK" + to_string(1000000 + i), "Toyota", "Red", "Good"));
+        phones[i] = "09" + to_string(10000000 + (i * 7919) % 90000000);
+        customerList.emplace<Customer>(id, "Customer " + to_string(i), "54 Nguyen Luong Bang", phones[i], "Toyota", "Business",
+            CAR_4_SEATER, rental, giveBack, car);
+    }
+    vector<string> queries;
+    for (size_t i = 0; i < 100000; ++i) {
+        queries.push_back(phones[(i * 104729) % contracts]);
+    }
+
+    size_t scanLookups = 200, found = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < scanLookups; ++i) {
+        customerList.forEach([&](const ContractId&, const Customer* cus) {
+            if (cus->getPhoneNumber() == queries[i]) {
+                found++;
+            }
+        });
+    }
+    double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / scanLookups;
+
+    start = chrono::steady_clock::now();
+    for (const string& phone : queries) {
+        customerList.forEachWithPhone(phone, [&](const ContractId&, const Customer*) { found++; });
+    }
+    double exactNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries.size();
+
+    start = chrono::steady_clock::now();
+    customerList.forEachWithPhonePrefix("", 1, [&](const ContractId&, const Customer*) {});
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (const string& phone : queries) {
+        customerList.forEachWithPhonePrefix(phone.substr(0, 6), PHONE_PREFIX_MATCHES, [&](const ContractId&, const Customer*) { found++; });
+    }
+    double prefixNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries.size();
+
+    size_t updates = 100000;
+    start = chrono::steady_clock::now();
+    customerList.forEach([&](const ContractId&, Customer* cus) {
+        if (updates > 0) {
+            cus->setPhoneNumber("08" + to_string(10000000 + updates));
+            updates--;
+        }
+    });
+    double updateNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / 100000;
+
+    cout << "Contracts: " << contracts << " (" << found << " hits)" << endl;
+    cout << "  full scan:          " << scanNs << " ns/lookup" << endl;
+    cout << "  phone index exact:  " << exactNs << " ns/lookup" << endl;
+    cout << "  phone index prefix: " << prefixNs << " ns/lookup (6 digits, up to " << PHONE_PREFIX_MATCHES << " matches), built in "
+         << buildMs << " ms on first use" << endl;
+    cout << "  phone change:       " << updateNs << " ns/update" << endl;
+}
+
+// Benchmark the customer listing: the former line-by-line cout << endl
+// rendering against ReportWriter, both into a file, then one page deep in
+// the listing through a cursor
+void runReportBenchmark(size_t contracts) {
+    FleetRegistry fleet;
+    fleet.reserve(contracts);
+    ContractStore customerList;
+    Date rental = Date::fromYMD(2025, 1, 1);
+    Date giveBack = Date::fromYMD(2025, 1, 8);
+    ContractId id;
+    for (size_t i = 0; i < contracts; ++i) {
+        Vehicle* car = fleet.addVehicle(Vehicle("BK" + to_string(1000000 + i), "Toyota", "Red", "Good"));
+        customerList.emplace<Customer>(id, "Customer " + to_string(i), "54 Nguyen Luong Bang", "0905" + to_string(100000 + i),
+            "Toyota", "Business", CAR_4_SEATER, rental, giveBack, car);
+    }
+
+    string path = "bench_report.txt";
+    ofstream file(path);
+    streambuf* console = cout.rdbuf(file.rdbuf());
+
+    auto start = chrono::steady_clock::now();
+    customerList.forEach([](const ContractId& id, const Customer* cus) {
+        cout << "Customer ID " << formatContractId(id) << ":" << endl;
+        cout << "Name: " << cus->getName() << endl;
+        cout << "Address: " << cus->getAddress() << endl;
+        cout << "Phone number: " << cus->getPhoneNumber() << endl;
+        cout << "Brand: " << cus->getBrand() << endl;
+        cout << "Reason for renting: " << cus->getReason() << endl;
+        cout << "Car type: " << cus->getCarType().name << endl;
+        cout << "License plate: " << cus->getCar()->licensePlate() << endl;
+        cout << "Rental Date: " << cus->getRentalDate() << endl;
+        cout << "Return Date: " << cus->getReturnDate() << endl;
+        cout << "Number of rental days: " << cus->RentalDays() << endl;
+        cout << "Total rental cost: $" << cus->calculateRentalCost() << endl;
+        cout << "-----------------------------------------" << endl;
+    });
+    double endlSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    {
+        ReportWriter report(cout);
+        customerList.forEach([&](const ContractId& id, const Customer* cus) {
+            report << "Customer ID " << formatContractId(id) << ":\n";
+            cus->writeInfo(report);
+            report << "-----------------------------------------\n";
+        });
+    }
+    double bufferedSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // The last page, reached through a cursor left by the page before it
+    size_t position = contracts > REPORT_PAGE_SIZE ? contracts - REPORT_PAGE_SIZE : 0;
+    start = chrono::steady_clock::now();
+    {
+        ReportWriter report(cout);
+        size_t shown = 0;
+        customerList.visitFrom(position, [&](const ContractId& id, const Customer* cus) {
+            report << "Customer ID " << formatContractId(id) << ":\n";
+            cus->writeInfo(report);
+            return ++shown < REPORT_PAGE_SIZE;
+        });
+    }
+    double pageUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+    cout.rdbuf(console);
+    file.close();
+    remove(path.c_str());
+    cout << "Customers: " << contracts << endl;
+    cout << "  cout << endl:  " << contracts / endlSeconds << " rows/sec" << endl;
+    cout << "  ReportWriter:  " << contracts / bufferedSeconds << " rows/sec (x" << endlSeconds / bufferedSeconds << ")" << endl;
+    cout << "  next page of " << REPORT_PAGE_SIZE << " at the end of the listing: " << pageUs << " us" << endl;
+}
+
+// Benchmark the maintenance scheduler on a 20000-car fleet: scheduling,
+// the due-soon query by calendar against a scan of every task, completing
+// and removing tasks
+void runMaintenanceBenchmark(size_t taskCount) {
+    const size_t vehicleCount = 20000;
+    FleetRegistry fleet;
+    fleet.reserve(vehicleCount);
+    vector<Vehicle*> cars;
+    for (size_t i = 0; i < vehicleCount; ++i) {
+        cars.push_back(fleet.addVehicle(Vehicle("MT" + to_string(1000000 + i), "Toyota", "Red", "Good")));
+    }
+    MaintenanceScheduler& scheduler = fleet.maintenance();
+    uint64_t seed = 7;
+    auto rng = [&] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(seed >> 33);
+    };
+    int32_t firstDay = Date::fromYMD(2025, 1, 1).days;
+
+    auto start = chrono::steady_clock::now();
+    vector<MaintenanceTaskId> ids(taskCount);
+    for (size_t i = 0; i < taskCount; ++i) {
+        ids[i] = scheduler.add(cars[rng() % vehicleCount], "Oil change", Date(firstDay + static_cast<int32_t>(rng() % 730)));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "scheduled " << taskCount << " tasks: " << taskCount / seconds << " tasks/sec" << endl;
+
+    // Due in the next 7 days, by the calendar and by scanning every task of
+    // every vehicle as the per-vehicle lists required
+    const int queries = 20;
+    size_t found = 0, scanned = 0;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        Date from(firstDay + 30 * q);
+        found += scheduler.dueBetween(from, Date(from.days + 7)).size();
+    }
+    double heapSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() / queries;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        Date from(firstDay + 30 * q), to(from.days + 7);
+        fleet.forEach([&](const Vehicle& v) {
+            for (const MaintenanceTaskId& id : v.maintenanceTasks) {
+                const MaintenanceTask* task = scheduler.get(id);
+                if (!task->completed && from <= task->dueDate && task->dueDate <= to) {
+                    scanned++;
+                }
+            }
+        });
+    }
+    double scanSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() / queries;
+    cout << "due in 7 days (" << found / queries << " tasks): calendar " << heapSeconds * 1000 << " ms, full scan "
+         << scanSeconds * 1000 << " ms (" << scanSeconds / heapSeconds << "x)" << (found == scanned ? "" : " MISMATCH") << endl;
+
+    // Complete and remove a random tenth each, in random order
+    for (size_t i = taskCount; i > 1; --i) {
+        swap(ids[i - 1], ids[rng() % i]);
+    }
+    size_t tenth = taskCount / 10;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < tenth; ++i) {
+        scheduler.complete(ids[i]);
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "completed " << tenth << " tasks: " << seconds / tenth * 1e9 << " ns each" << endl;
+    start = chrono::steady_clock::now();
+    for (size_t i = tenth; i < 2 * tenth; ++i) {
+        scheduler.remove(ids[i]);
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "removed " << tenth << " tasks: " << seconds / tenth * 1e9 << " ns each (" << scheduler.size() << " left, "
+         << scheduler.pending() << " pending)" << endl;
+}
+
+// Benchmark the columnar history file on generated contracts closing in
+// date order: write speed and bytes per row, then revenue by month and car
+// type and the rentals of one plate, with and without matching blocks
+void runHistoryBenchmark(size_t rows) {
+    string path = "bench_history.col", tailPath = "bench_history.tail";
+    const char* types[] = {"4-seater", "7-seater"};
+    const char* brands[] = {"Toyota", "Honda", "Hyundai", "Kia", "Ford"};
+    const int64_t dailyCents[] = {100000, 150000};
+    const size_t plates = 5000;
+    int32_t firstDay = Date::fromYMD(2019, 1, 1).days;
+    int32_t spanDays = Date::fromYMD(2027, 1, 1).days - firstDay;
+    remove(path.c_str());
+    remove(tailPath.c_str());
+
+    // Contracts close roughly in date order, as they do in the archive
+    auto begin = chrono::steady_clock::now();
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cout << "Cannot create " << path << endl;
+        return;
+    }
+    vector<HistoryRow> block(HISTORY_BLOCK_ROWS);
+    string bytes;
+    uint32_t seed = 12345;
+    auto next = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    };
+    for (size_t done = 0; done < rows;) {
+        size_t count = min<size_t>(HISTORY_BLOCK_ROWS, rows - done);
+        block.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            HistoryRow& row = block[i];
+            uint32_t plate = next() % plates;
+            int type = plate % 2;
+            row.plate = "43A-" + to_string(10000 + plate);
+            row.carType = types[type];
+            row.brand = brands[plate % 5];
+            row.rentalDay = firstDay + static_cast<int32_t>((done + i) * spanDays / rows);
+            row.days = 1 + next() % 30;
+            row.customerClass = next() % 5 == 0;
+            row.baseCents = row.days * dailyCents[type];
+            row.discountCents = row.customerClass ? row.baseCents / 10 : 0;
+            row.damageCents = next() % 20 == 0 ? row.baseCents / 10 : 0;
+        }
+        bytes.clear();
+        encodeHistoryBlock(block, bytes);
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        done += count;
+    }
+    fclose(file);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    uint64_t size = fileSize(path);
+    cout << "wrote " << rows << " rows in " << seconds << " s, " << size / 1048576.0 << " MB ("
+         << double(size) / rows << " bytes/row)" << endl;
+
+    ostringstream sink;
+    {
+        HistoryScanStats stats;
+        begin = chrono::steady_clock::now();
+        auto revenue = revenueByMonthAndType(path, tailPath, 2025, stats);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        ReportWriter report(sink);
+        printRevenueReport(report, 2025, revenue);
+        cout << "revenue by month and car type, 2025: " << seconds << " s, " << stats.blocksSkipped << "/" << stats.blocks
+             << " blocks skipped, " << stats.rowsScanned / seconds / 1e6 << "M rows/s scanned" << endl;
+    }
+    {
+        HistoryScanStats stats;
+        begin = chrono::steady_clock::now();
+        auto revenue = revenueByMonthAndType(path, tailPath, 2030, stats);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cout << "revenue, year with no rentals:      " << seconds << " s, " << stats.blocksSkipped << "/" << stats.blocks
+             << " blocks skipped" << endl;
+    }
+    {
+        HistoryScanStats stats;
+        begin = chrono::steady_clock::now();
+        vector<HistoryRow> found = rentalsOfPlate(path, tailPath, "43A-10042", stats);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cout << "rentals of one plate:               " << seconds << " s, " << found.size() << " rentals, "
+             << stats.rowsScanned / seconds / 1e6 << "M rows/s scanned" << endl;
+    }
+    {
+        HistoryScanStats stats;
+        begin = chrono::steady_clock::now();
+        vector<HistoryRow> found = rentalsOfPlate(path, tailPath, "99Z-00000", stats);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cout << "rentals of an unknown plate:        " << seconds << " s, " << stats.blocksSkipped << "/" << stats.blocks
+             << " blocks skipped" << endl;
+    }
+    remove(path.c_str());
+}
+
+// Benchmark checkout latency seen by the caller: the former synchronous
+// open/append/close per contract against the background archive writer in
+// each durability mode
+void runArchiveBenchmark(size_t contracts) {
+    ArchiveRecord rec;
+    rec.name = "Nguyen Van A";
+    rec.address = "54 Nguyen Luong Bang";
+    rec.phoneNumber = "0905123456";
+    rec.brand = "Toyota";
+    rec.carType = "4-seater";
+    rec.rentalDate = Date::fromYMD(2025, 1, 1);
+    rec.returnDate = Date::fromYMD(2025, 1, 8);
+    rec.totalCost = 7000;
+    string path = "bench_archive.txt";
+
+    auto report = [&](const string& label, vector<double>& latencies, double totalSeconds) {
+        sort(latencies.begin(), latencies.end());
+        double sum = 0;
+        for (double us : latencies) {
+            sum += us;
+        }
+        cout << label << ": mean " << sum / latencies.size() << " us, p99 " << latencies[latencies.size() * 99 / 100]
+             << " us, max " << latencies.back() << " us per checkout, " << contracts / totalSeconds << " contracts/sec incl. drain" << endl;
+    };
+
+    // The former path flushed every line of the entry with endl
+    ostringstream text;
+    {
+        ReportWriter entry(text);
+        writeArchiveEntry(entry, rec);
+    }
+    vector<string> lines;
+    istringstream entryLines(text.str());
+    for (string line; getline(entryLines, line);) {
+        lines.push_back(line);
+    }
+
+    remove(path.c_str());
+    vector<double> latencies(contracts);
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < contracts; ++i) {
+        auto start = chrono::steady_clock::now();
+        ofstream file(path, ios::app);
+        for (const string& line : lines) {
+            file << line << endl;
+        }
+        file.close();
+        latencies[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    }
+    report("synchronous append     ", latencies, chrono::duration<double>(chrono::steady_clock::now() - begin).count());
+
+    const ArchiveDurability modes[] = {ArchiveDurability::PerContract, ArchiveDurability::Interval, ArchiveDurability::OnShutdown};
+    const char* labels[] = {"async, fsync per batch  ", "async, fsync every 200ms", "async, fsync on shutdown"};
+    for (int m = 0; m < 3; ++m) {
+        remove(path.c_str());
+        begin = chrono::steady_clock::now();
+        size_t batches;
+        {
+            ArchiveWriter archive(path, modes[m]);
+            for (size_t i = 0; i < contracts; ++i) {
+                auto start = chrono::steady_clock::now();
+                archive.submit(rec);
+                latencies[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+            }
+            archive.close();
+            batches = archive.batches();
+        }
+        report(labels[m], latencies, chrono::duration<double>(chrono::steady_clock::now() - begin).count());
+        cout << "    " << contracts / double(batches) << " contracts per write" << endl;
+    }
+    remove(path.c_str());
+}
+
+// Discards everything written to it, for measuring formatting alone
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+volatile double benchSink; // keeps measured results alive
+
+// Runs fn(i) for i in [0, operations) after a short warm-up and prints
+// ns/op, heap allocations/op and operations/sec
+template <typename Fn>
+void runMicro(const string& name, size_t operations, Fn fn) {
+    double sum = 0;
+    for (size_t i = 0; i < min<size_t>(operations / 10, 10000); ++i) {
+        sum += fn(i);
+    }
+    uint64_t allocationsBefore = allocationCount.load();
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; ++i) {
+        sum += fn(i);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    benchSink = sum;
+    printf("%-34s %12.1f %12.2f %14.0f\n", name.c_str(), seconds * 1e9 / operations, static_cast<double>(allocations) / operations,
+        operations / seconds);
+}
+
+// Micro-benchmarks of the hot paths on a generated fleet of the given size,
+// with as many active contracts and two maintenance tasks per car
+void runMicroBenchmarks(size_t scale, uint64_t seed) {
+    SyntheticConfig config;
+    config.cars = scale;
+    config.contracts = scale;
+    config.seed = seed;
+    FleetRegistry fleet;
+    ContractStore contracts;
+    vector<string> plates;
+    pricing().compile(); // flat rates, compiled as restoreState leaves them
+    auto start = chrono::steady_clock::now();
+    generateFleet(fleet, config, &plates);
+    size_t booked = generateContracts(fleet, contracts, config);
+    size_t tasks = generateMaintenance(fleet, config);
+    double generateSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("scale %zu (seed %llu): %zu cars, %zu contracts, %zu maintenance tasks generated in %.2f s\n", scale,
+        static_cast<unsigned long long>(seed), fleet.size(), booked, tasks, generateSeconds);
+
+    // Visit order is random but fixed, so runs compare like for like
+    const size_t operations = 1000000;
+    SyntheticRandom random(seed);
+    vector<uint32_t> order(min<size_t>(operations, 1 << 20));
+    for (uint32_t& index : order) {
+        index = random.below(static_cast<uint32_t>(scale));
+    }
+    auto pick = [&](size_t i) { return order[i % order.size()]; };
+    vector<string> missingPlates;
+    for (size_t i = 0; i < 4096; ++i) {
+        missingPlates.push_back("99Z-" + to_string(10000 + i));
+    }
+    vector<const Customer*> customers;
+    contracts.forEach([&](const ContractId&, const Customer* cus) { customers.push_back(cus); });
+    vector<uint32_t> contractOrder(order.size());
+    for (uint32_t& index : contractOrder) {
+        index = random.below(static_cast<uint32_t>(customers.size()));
+    }
+    int32_t firstDay = Date::fromYMD(config.year, 1, 1).days;
+
+    printf("%-34s %12s %12s %14s\n", "benchmark", "ns/op", "allocs/op", "ops/sec");
+    runMicro("findCar (hit)", operations, [&](size_t i) { return findCar(fleet, plates[pick(i)]) != nullptr ? 1.0 : 0.0; });
+    runMicro("findCar (miss)", operations, [&](size_t i) { return findCar(fleet, missingPlates[i % missingPlates.size()]) != nullptr ? 1.0 : 0.0; });
+    runMicro("RentalDays", operations, [&](size_t i) { return customers[contractOrder[i % contractOrder.size()]]->RentalDays(); });
+    runMicro("calculateRentalCost", operations, [&](size_t i) { return customers[contractOrder[i % contractOrder.size()]]->calculateRentalCost(); });
+    NullBuffer nullBuffer;
+    ostream nowhere(&nullBuffer);
+    ReportWriter bills(nowhere);
+    runMicro("printBill formatting", operations / 4, [&](size_t i) { return writeBill(bills, customers[contractOrder[i % contractOrder.size()]]); });
+    runMicro("car maintenance list", operations, [&](size_t i) {
+        const Vehicle* car = fleet.find(plates[pick(i)]);
+        size_t pending = 0;
+        for (const MaintenanceTaskId& id : car->maintenanceTasks) {
+            pending += !fleet.maintenance().get(id)->completed;
+        }
+        return static_cast<double>(pending);
+    });
+    const char* const searches[] = {"toyota red", "honda 7-seater", "rented silver", "all ford good"};
+    runMicro("fleet search", operations / 100, [&](size_t i) {
+        return static_cast<double>(searchFleet(fleet, parseFleetQuery(fleet, searches[i % 4])).cardinality());
+    });
+    runMicro("maintenance due in 7 days", operations / 10, [&](size_t i) {
+        Date from(firstDay + static_cast<int32_t>(order[i % order.size()] % 358));
+        return static_cast<double>(fleet.maintenance().dueBetween(from, Date(from.days + 7)).size());
+    });
+    // Revenue by brand and month from the cube, against walking every
+    // contract as a report had to before
+    runMicro("revenue cube roll-up", 1000, [&](size_t) {
+        writeRevenueCube(bills, contracts.revenueCube(), CUBE_BRAND | CUBE_MONTH);
+        return 1.0;
+    });
+    runMicro("revenue full recompute", 10, [&](size_t) {
+        map<pair<string, int32_t>, int64_t> revenue;
+        contracts.forEach([&](const ContractId&, const Customer* cus) {
+            Date rental = cus->getRentalDate();
+            revenue[make_pair(cus->getCar()->brandText(), rental.year() * 12 + rental.month())] += llround(cus->calculateRentalCost() * 100);
+        });
+        return static_cast<double>(revenue.size());
+    });
+    // Cost of the operation statistics themselves: a call that is only
+    // counted, and one that is also timed into the histogram
+    runMicro("stats: counted call", operations, [&](size_t) {
+        OperationTimer timer(STAT_FIND_CAR);
+        return 0.0;
+    });
+    runMicro("stats: timed call", operations, [&](size_t) {
+        OperationTimer timer(STAT_MENU_STATISTICS);
+        return 0.0;
+    });
+    {
+        string archivePath = "bench_micro_archive.txt";
+        remove(archivePath.c_str());
+        ArchiveWriter archive(archivePath, ArchiveDurability::OnShutdown);
+        runMicro("saveDeletedCustomerInfo", operations / 4, [&](size_t i) {
+            saveDeletedCustomerInfo(customers[contractOrder[i % contractOrder.size()]], archive);
+            return 0.0;
+        });
+        archive.close();
+        remove(archivePath.c_str());
+    }
+    ReportWriter report(cout);
+    report << '\n';
+    writeOperationStats(report);
+    writeMemoryFootprint(report, fleet, contracts);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench-lookup") {
+        runLookupBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-import") {
+        runImportBenchmark(argc > 2 ? stoul(argv[2]) : 2000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-fleet-scan") {
+        runFleetScanBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-assign") {
+        runAssignBenchmark(argc > 2 ? stoul(argv[2]) : 100000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-assign-dated") {
+        runDatedAssignBenchmark(argc > 2 ? stoul(argv[2]) : 100000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-fleet-search") {
+        runFleetSearchBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--stress-reservations") {
+        return runReservationStress(argc > 2 ? stoul(argv[2]) : 16, argc > 3 ? stoul(argv[3]) : 50000) ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-reservations") {
+        runReservationBenchmark(argc > 2 ? stoul(argv[2]) : 200000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-server") {
+#ifndef _WIN32
+        runServerBenchmark(argc > 2 ? stoul(argv[2]) : 2000, argc > 3 ? stoul(argv[3]) : 50);
+        return 0;
+#else
+        cout << "Server mode needs Unix domain sockets and epoll; it is not available on Windows." << endl;
+        return 1;
+#endif
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-maintenance") {
+        runMaintenanceBenchmark(argc > 2 ? stoul(argv[2]) : 2000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-history") {
+        runHistoryBenchmark(argc > 2 ? stoul(argv[2]) : 100000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-archive") {
+        runArchiveBenchmark(argc > 2 ? stoul(argv[2]) : 20000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-report") {
+        runReportBenchmark(argc > 2 ? stoul(argv[2]) : 100000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-customers") {
+        runCustomerLookupBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-snapshot") {
+        runSnapshotBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-journal") {
+        runJournalBenchmark(argc > 2 ? stoul(argv[2]) : 250000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-billing") {
+        runBillingBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-pricing") {
+        runPricingBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-dates") {
+        runDateBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+        return 0;
+    }
+    size_t scale = 100000;
+    uint64_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--scale") {
+            scale = stoul(argv[i + 1]);
+        } else if (option == "--seed") {
+            seed = stoull(argv[i + 1]);
+        } else {
+            break;
+        }
+    }
+    if (argc % 2 == 0 || scale < 1000 || scale > 10000000) {
+        cout << "Usage: " << argv[0] << " [--scale <1000..10000000>] [--seed <n>] | --bench-<name> [size] | --stress-reservations" << endl;
+        return 1;
+    }
+    runMicroBenchmarks(scale, seed);
+    return 0;
+}
@@ -0,0 +1,2848 @@
+#include "rental_core.h"
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+using namespace std;
+
+ostream& operator<<(ostream& out, const Date& date) {
+    int y, m, d;
+    date.toYMD(y, m, d);
+    return out << d << "/" << m << "/" << y;
+}
+
+string formatLatency(uint64_t ns) {
+    char text[32];
+    if (ns < 10000) {
+        snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+    } else if (ns < 10000000) {
+        snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+    } else if (ns < 10000000000ULL) {
+        snprintf(text, sizeof(text), "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(text, sizeof(text), "%.1f s", ns / 1e9);
+    }
+    return text;
+}
+
+void writeOperationStats(ReportWriter& report) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-28s %12s %10s %10s %10s %10s\n", "Operation", "count", "p50", "p99", "p99.9", "max");
+    report << line;
+    uint64_t calls, maxNs;
+    vector<uint64_t> buckets;
+    for (size_t op = 0; op < STAT_OPERATION_COUNT; ++op) {
+        StatsRegistry::instance().collect(op, calls, maxNs, buckets);
+        if (calls == 0) {
+            continue;
+        }
+        uint64_t samples = 0;
+        for (uint64_t count : buckets) {
+            samples += count;
+        }
+        // Percentiles are the start of the bucket holding the rank, capped by the max
+        auto percentile = [&](double fraction) {
+            if (samples == 0) {
+                return string("-"); // not timed yet (sampled, or still running)
+            }
+            uint64_t rank = static_cast<uint64_t>(ceil(fraction * samples));
+            uint64_t seen = 0;
+            for (size_t b = 0; b < STAT_BUCKETS; ++b) {
+                seen += buckets[b];
+                if (seen >= max<uint64_t>(rank, 1)) {
+                    return formatLatency(min(latencyBucketStart(b), maxNs));
+                }
+            }
+            return formatLatency(maxNs);
+        };
+        snprintf(line, sizeof(line), "%-28s %12llu %10s %10s %10s %10s\n", STAT_OPERATIONS[op].name, static_cast<unsigned long long>(calls),
+            percentile(0.50).c_str(), percentile(0.99).c_str(), percentile(0.999).c_str(), samples == 0 ? "-" : formatLatency(maxNs).c_str());
+        report << line;
+    }
+}
+
+bool packPlate(string_view plate, PlateKey& key) {
+    if (plate.empty() || plate.size() > MAX_PLATE_LENGTH) {
+        return false;
+    }
+    char buffer[MAX_PLATE_LENGTH] = {};
+    memcpy(buffer, plate.data(), plate.size());
+    memcpy(&key.lo, buffer, 8);
+    memcpy(&key.hi, buffer + 8, 8);
+    return true;
+}
+
+string unpackPlate(const PlateKey& key) {
+    char buffer[MAX_PLATE_LENGTH];
+    memcpy(buffer, &key.lo, 8);
+    memcpy(buffer + 8, &key.hi, 8);
+    size_t length = 0;
+    while (length < MAX_PLATE_LENGTH && buffer[length] != '\0') {
+        length++;
+    }
+    return string(buffer, length);
+}
+
+uint64_t hashPlate(const PlateKey& key) {
+    uint64_t h = key.lo * 0x9E3779B97F4A7C15ULL ^ key.hi;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+SymbolTable& symbols() {
+    static SymbolTable table;
+    return table;
+}
+
+CarTypeRegistry& carTypes() {
+    static CarTypeRegistry registry;
+    return registry;
+}
+
+void loadCarTypes(const string& filePath) {
+    ifstream file(filePath);
+    if (!file.is_open()) {
+        return;
+    }
+    string line;
+    size_t lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t bar = line.find('|');
+        char* end = nullptr;
+        double rate = bar == string::npos ? 0 : strtod(line.c_str() + bar + 1, &end);
+        CarTypeId id;
+        if (bar == string::npos || end == line.c_str() + bar + 1 || *end != '\0' || rate <= 0
+            || !carTypes().add(line.substr(0, bar), rate, id)) {
+            cout << filePath << " line " << lineNumber << ": invalid or duplicate car type, skipped." << endl;
+        }
+    }
+}
+
+bool isKnownCarType(const string& typeName) {
+    CarTypeId id;
+    return carTypes().find(typeName, id);
+}
+
+PricingEngine& pricing() {
+    static PricingEngine engine;
+    return engine;
+}
+
+// Reads "dd/mm" or, when a year is allowed, "dd/mm/yyyy"
+bool parseRuleDate(const string& text, bool allowYear, int& day, int& month, int& year) {
+    char tail;
+    year = 0;
+    int fields = sscanf(text.c_str(), "%d/%d/%d%c", &day, &month, &year, &tail);
+    if (fields != 2 && !(allowYear && fields == 3 && year >= 1970)) {
+        return false;
+    }
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+bool parseRuleNumber(const string& text, double& value) {
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+bool parsePricingRule(const vector<string>& fields, PricingRule& rule) {
+    static const size_t FIELD_COUNTS[] = {5, 3, 4, 4};
+    const string& kind = fields[0];
+    if (kind == "season") {
+        rule.kind = RULE_SEASON;
+    } else if (kind == "weekend") {
+        rule.kind = RULE_WEEKEND;
+    } else if (kind == "holiday") {
+        rule.kind = RULE_HOLIDAY;
+    } else if (kind == "long") {
+        rule.kind = RULE_LONG_RENTAL;
+    } else {
+        return false;
+    }
+    if (fields.size() != FIELD_COUNTS[rule.kind]) {
+        return false;
+    }
+    rule.allTypes = fields[1] == "*";
+    if (!rule.allTypes && !carTypes().find(fields[1], rule.carType)) {
+        return false;
+    }
+    int year;
+    switch (rule.kind) {
+        case RULE_SEASON:
+            return parseRuleDate(fields[2], false, rule.fromDay, rule.fromMonth, year)
+                && parseRuleDate(fields[3], false, rule.toDay, rule.toMonth, year)
+                && parseRuleNumber(fields[4], rule.factor) && rule.factor > 0;
+        case RULE_WEEKEND:
+            return parseRuleNumber(fields[2], rule.factor) && rule.factor > 0;
+        case RULE_HOLIDAY:
+            return parseRuleDate(fields[2], true, rule.fromDay, rule.fromMonth, rule.year)
+                && parseRuleNumber(fields[3], rule.factor) && rule.factor > 0;
+        case RULE_LONG_RENTAL: {
+            double minDays;
+            if (!parseRuleNumber(fields[2], minDays) || minDays < 1 || minDays != floor(minDays)
+                || !parseRuleNumber(fields[3], rule.discount) || rule.discount < 0 || rule.discount >= 1) {
+                return false;
+            }
+            rule.minDays = static_cast<int32_t>(minDays);
+            return true;
+        }
+    }
+    return false;
+}
+
+void loadPricingRules(const string& filePath) {
+    ifstream file(filePath);
+    if (!file.is_open()) {
+        return;
+    }
+    string line;
+    vector<string> fields;
+    size_t lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        splitFields(line, fields);
+        PricingRule rule;
+        if (!parsePricingRule(fields, rule)) {
+            cout << filePath << " line " << lineNumber << ": invalid pricing rule, skipped." << endl;
+            continue;
+        }
+        pricing().addRule(rule);
+    }
+    pricing().compile();
+}
+
+// Shortest text that reads back as the same number
+string formatRuleNumber(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.15g", value);
+    if (strtod(text, nullptr) != value) {
+        snprintf(text, sizeof(text), "%.17g", value);
+    }
+    return text;
+}
+
+string formatPricingRule(const PricingRule& rule) {
+    static const char* KIND_NAMES[] = {"season", "weekend", "holiday", "long"};
+    char date[32];
+    string line = string(KIND_NAMES[rule.kind]) + "|" + (rule.allTypes ? "*" : carTypes().get(rule.carType).name) + "|";
+    switch (rule.kind) {
+        case RULE_SEASON:
+            snprintf(date, sizeof(date), "%02d/%02d|%02d/%02d|", rule.fromDay, rule.fromMonth, rule.toDay, rule.toMonth);
+            return line + date + formatRuleNumber(rule.factor);
+        case RULE_WEEKEND:
+            return line + formatRuleNumber(rule.factor);
+        case RULE_HOLIDAY:
+            snprintf(date, sizeof(date), rule.year == 0 ? "%02d/%02d|" : "%02d/%02d/%d|", rule.fromDay, rule.fromMonth, rule.year);
+            return line + date + formatRuleNumber(rule.factor);
+        case RULE_LONG_RENTAL:
+            return line + to_string(rule.minDays) + "|" + formatRuleNumber(rule.discount);
+    }
+    return line;
+}
+
+void writePricingRules(ReportWriter& report) {
+    const vector<PricingRule>& rules = pricing().ruleList();
+    if (rules.empty()) {
+        report << "No pricing rules; every day costs the daily rate.\n";
+    }
+    for (size_t i = 0; i < rules.size(); ++i) {
+        report << static_cast<unsigned long>(i + 1) << ". " << formatPricingRule(rules[i]) << '\n';
+    }
+}
+
+// Writes the rules to a temporary file and moves it over the rules file
+bool savePricingRules(const string& filePath, const vector<PricingRule>& rules) {
+    string tempPath = filePath + ".tmp";
+    ofstream file(tempPath, ios::trunc);
+    for (const PricingRule& rule : rules) {
+        file << formatPricingRule(rule) << '\n';
+    }
+    file.close();
+    return !file.fail() && rename(tempPath.c_str(), filePath.c_str()) == 0;
+}
+
+bool runPricingRuleCommand(const vector<string>& fields, size_t& recomputed, string& error) {
+    vector<PricingRule> rules = pricing().ruleList();
+    PricingRule added;
+    double number = 0;
+    bool add = fields.size() > 2 && fields[1] == "add";
+    if (add) {
+        if (!parsePricingRule(vector<string>(fields.begin() + 2, fields.end()), added)) {
+            error = "invalid pricing rule";
+            return false;
+        }
+        rules.push_back(added);
+    } else if (fields.size() == 3 && fields[1] == "delete") {
+        if (!parseRuleNumber(fields[2], number) || number < 1 || number > rules.size() || number != floor(number)) {
+            error = "no pricing rule " + fields[2];
+            return false;
+        }
+        rules.erase(rules.begin() + static_cast<size_t>(number - 1));
+    } else {
+        error = "expected rule|add|<rule> or rule|delete|<rule number>";
+        return false;
+    }
+    if (!savePricingRules(PRICING_PATH, rules)) {
+        error = "unable to write " + PRICING_PATH + "; the rules were left as they were";
+        return false;
+    }
+    if (add) {
+        pricing().addRule(added);
+    } else {
+        pricing().removeRule(static_cast<size_t>(number - 1));
+    }
+    recomputed = pricing().compile();
+    return true;
+}
+
+uint64_t hashPhone(const string& phone) {
+    uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a
+    for (unsigned char c : phone) {
+        h = (h ^ c) * 0x100000001B3ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+string formatContractId(const ContractId& id) {
+    string text = to_string(id.slot + 1);
+    if (id.generation > 0) {
+        text += "-" + to_string(id.generation);
+    }
+    return text;
+}
+
+bool parseContractId(const string& text, ContractId& id) {
+    char* end;
+    unsigned long slot = strtoul(text.c_str(), &end, 10);
+    if (text.empty() || !isdigit(static_cast<unsigned char>(text[0])) || slot < 1 || slot > 0xFFFFFFFFul) {
+        return false;
+    }
+    unsigned long generation = 0;
+    if (*end == '-') {
+        const char* genText = end + 1;
+        generation = strtoul(genText, &end, 10);
+        if (!isdigit(static_cast<unsigned char>(*genText)) || generation > 0xFFFFFFFFul) {
+            return false;
+        }
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    id.slot = static_cast<uint32_t>(slot - 1);
+    id.generation = static_cast<uint32_t>(generation);
+    return true;
+}
+
+string formatTaskId(const MaintenanceTaskId& id) {
+    return "M" + formatContractId(ContractId{id.slot, id.generation});
+}
+
+bool parseTaskId(const string& text, MaintenanceTaskId& id) {
+    ContractId number;
+    if (text.size() < 2 || (text[0] != 'M' && text[0] != 'm') || !parseContractId(text.substr(1), number)) {
+        return false;
+    }
+    id = MaintenanceTaskId{number.slot, number.generation};
+    return true;
+}
+
+BillingColumns collectBillingColumns(const ContractStore& CustomerList) {
+    BillingColumns columns;
+    columns.reserve(CustomerList.size());
+    CustomerList.forEach([&](const ContractId&, const Customer* cus) {
+        columns.add(cus->calculateBaseRentalCost(), cus->getDiscountRate());
+    });
+    return columns;
+}
+
+bool parseCubeDimensions(const string& text, unsigned& dimensions) {
+    dimensions = 0;
+    istringstream words(text);
+    string word;
+    while (words >> word) {
+        word = lowerCase(word);
+        if (word == "brand") {
+            dimensions |= CUBE_BRAND;
+        } else if (word == "type") {
+            dimensions |= CUBE_CAR_TYPE;
+        } else if (word == "class") {
+            dimensions |= CUBE_CLASS;
+        } else if (word == "month") {
+            dimensions |= CUBE_MONTH;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void writeRevenueCube(ReportWriter& report, const RevenueCube& cube, unsigned dimensions) {
+    // Rows in brand, type, class and month order; dimensions rolled up are
+    // left empty in the key
+    typedef tuple<string, string, int, int> RowKey;
+    map<RowKey, RevenueCubeCell> rows;
+    RevenueCubeCell total;
+    cube.forEachCell([&](const string& brand, CarTypeId carType, bool vip, int year, int month, const RevenueCubeCell& cell) {
+        RowKey key((dimensions & CUBE_BRAND) ? brand : string(), (dimensions & CUBE_CAR_TYPE) ? carTypes().get(carType).name : string(),
+            (dimensions & CUBE_CLASS) ? (vip ? 2 : 1) : 0, (dimensions & CUBE_MONTH) ? year * 12 + month - 1 : -1);
+        rows[key].add(cell);
+        total.add(cell);
+    });
+
+    auto averageDays = [](const CubeMeasures& m) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.1f", m.contracts ? static_cast<double>(m.rentalDays) / m.contracts : 0.0);
+        return m.contracts ? string(text) : string("-");
+    };
+    auto column = [](const string& text, int width) {
+        char cell[96];
+        snprintf(cell, sizeof(cell), "%-*s", width, text.c_str());
+        return string(cell);
+    };
+
+    string heading;
+    heading += (dimensions & CUBE_BRAND) ? "Brand        " : "";
+    heading += (dimensions & CUBE_CAR_TYPE) ? "Car type     " : "";
+    heading += (dimensions & CUBE_CLASS) ? "Class    " : "";
+    heading += (dimensions & CUBE_MONTH) ? "Month    " : "";
+    report << heading << "  Active  Avg days         Booked   Closed  Avg days         Earned    Damage fees\n";
+    auto writeRow = [&](const string& label, const RevenueCubeCell& cell) {
+        char line[200];
+        snprintf(line, sizeof(line), "%s%8lld  %8s  %13s  %7lld  %8s  %13s  %13s\n", label.c_str(), static_cast<long long>(cell.active.contracts),
+            averageDays(cell.active).c_str(), formatCents(cell.active.revenueCents).c_str(), static_cast<long long>(cell.checkedOut.contracts),
+            averageDays(cell.checkedOut).c_str(), formatCents(cell.checkedOut.revenueCents).c_str(), formatCents(cell.damageCents).c_str());
+        report << line;
+    };
+    if (dimensions != 0) {
+        for (const auto& row : rows) {
+            const RowKey& key = row.first;
+            if (row.second.active.contracts == 0 && row.second.checkedOut.contracts == 0) {
+                continue; // every contract of this cell has ended without checkout
+            }
+            string label;
+            label += (dimensions & CUBE_BRAND) ? column(get<0>(key), 13) : "";
+            label += (dimensions & CUBE_CAR_TYPE) ? column(get<1>(key), 13) : "";
+            label += (dimensions & CUBE_CLASS) ? column(get<2>(key) == 2 ? "VIP" : "Regular", 9) : "";
+            label += (dimensions & CUBE_MONTH) ? column(to_string(get<3>(key) % 12 + 1) + "/" + to_string(get<3>(key) / 12), 9) : "";
+            writeRow(label, row.second);
+        }
+    }
+    writeRow(column("Total", static_cast<int>(heading.size())), total);
+    report << "Booked: revenue of active contracts; earned: revenue of contracts checked out, before damage fees\n";
+}
+
+bool checkRevenueCube(const ContractStore& CustomerList, ReportWriter& report) {
+    typedef tuple<string, CarTypeId, bool, int, int> CellKey;
+    map<CellKey, CubeMeasures> kept, recomputed;
+    CustomerList.revenueCube().forEachCell([&](const string& brand, CarTypeId carType, bool vip, int year, int month, const RevenueCubeCell& cell) {
+        if (!(cell.active == CubeMeasures())) {
+            kept[CellKey(brand, carType, vip, year, month)] = cell.active;
+        }
+    });
+    RevenueCube fresh;
+    CustomerList.forEach([&](const ContractId&, const Customer* cus) {
+        fresh.addActive(cus->cubeEntry());
+    });
+    fresh.forEachCell([&](const string& brand, CarTypeId carType, bool vip, int year, int month, const RevenueCubeCell& cell) {
+        recomputed[CellKey(brand, carType, vip, year, month)] = cell.active;
+    });
+
+    size_t differing = 0;
+    auto compare = [&](const CellKey& key, const CubeMeasures& cube, const CubeMeasures& actual) {
+        if (cube == actual) {
+            return;
+        }
+        if (++differing <= 10) {
+            report << "Differs: " << get<0>(key) << ", " << carTypes().get(get<1>(key)).name << ", " << (get<2>(key) ? "VIP" : "Regular") << ", "
+                   << get<4>(key) << '/' << get<3>(key) << ": cube " << cube.contracts << " contracts, " << cube.rentalDays << " days, $"
+                   << formatCents(cube.revenueCents) << "; contracts " << actual.contracts << ", " << actual.rentalDays << " days, $"
+                   << formatCents(actual.revenueCents) << '\n';
+        }
+    };
+    for (const auto& cell : recomputed) {
+        auto found = kept.find(cell.first);
+        compare(cell.first, found == kept.end() ? CubeMeasures() : found->second, cell.second);
+    }
+    for (const auto& cell : kept) {
+        if (!recomputed.count(cell.first)) {
+            compare(cell.first, cell.second, CubeMeasures());
+        }
+    }
+    if (differing > 0) {
+        report << "Revenue cube is out of step with the contracts in " << static_cast<unsigned long>(differing) << " cell(s)\n";
+        return false;
+    }
+    report << "Revenue cube matches all " << static_cast<unsigned long>(CustomerList.size()) << " active contracts ("
+           << static_cast<unsigned long>(recomputed.size()) << " cells)\n";
+    return true;
+}
+
+// Heap bytes of a string holding text; shorter texts fit the inline buffer
+size_t stringHeapBytes(const string& text) {
+    return text.size() > 15 ? text.size() + 1 : 0;
+}
+
+void writeMemoryFootprint(ReportWriter& report, const FleetRegistry& VehicleList, const ContractStore& CustomerList) {
+    size_t vehicles = 0, vehicleBytes = 0, vehicleStringBytes = 0;
+    VehicleList.forEach([&](const Vehicle& xe) {
+        vehicles++;
+        size_t record = sizeof(Vehicle) + sizeof(uint8_t) + sizeof(CarTypeId); // with its slot status and type
+        vehicleBytes += record;
+        vehicleStringBytes += record + 3 * (sizeof(string) - sizeof(Symbol))
+            + stringHeapBytes(xe.brandText()) + stringHeapBytes(xe.colorText()) + stringHeapBytes(xe.conditionText());
+    });
+    size_t contracts = 0, contractBytes = 0, contractStringBytes = 0;
+    CustomerList.forEach([&](const ContractId&, const Customer* cus) {
+        size_t record = cus->isVip() ? sizeof(CustomerVIP) : sizeof(Customer);
+        contracts++;
+        contractBytes += record;
+        contractStringBytes += record + sizeof(string) - sizeof(Symbol) + stringHeapBytes(cus->getBrand());
+    });
+    size_t tableBytes = symbols().memoryBytes();
+
+    report << "-----------------------------------------\n";
+    report << "Interned texts: " << static_cast<unsigned long>(symbols().size()) << ", " << static_cast<unsigned long>(tableBytes) << " bytes\n";
+    if (vehicles > 0) {
+        report << "Vehicles: " << static_cast<unsigned long>(vehicles) << ", brand/color/condition as symbols "
+               << static_cast<double>(vehicleBytes) / vehicles << " bytes each, as strings "
+               << static_cast<double>(vehicleStringBytes) / vehicles << " bytes each\n";
+    }
+    if (contracts > 0) {
+        report << "Contracts: " << static_cast<unsigned long>(contracts) << ", brand as a symbol "
+               << static_cast<double>(contractBytes) / contracts << " bytes each, as a string "
+               << static_cast<double>(contractStringBytes) / contracts << " bytes each\n";
+    }
+    report << "Saved: " << (static_cast<double>(vehicleStringBytes + contractStringBytes) - vehicleBytes - contractBytes - tableBytes) / (1024 * 1024)
+           << " MB, interned texts included\n";
+    report << "-----------------------------------------\n";
+}
+
+void computeBillsScalar(const double* base, const double* discount, double* bills, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        bills[i] = base[i] * (1 - discount[i]);
+    }
+}
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+__attribute__((target("avx2")))
+void computeBillsAvx2(const double* base, const double* discount, double* bills, size_t count) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d keep = _mm256_sub_pd(one, _mm256_loadu_pd(discount + i));
+        _mm256_storeu_pd(bills + i, _mm256_mul_pd(_mm256_loadu_pd(base + i), keep));
+    }
+    computeBillsScalar(base + i, discount + i, bills + i, count - i);
+}
+
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+size_t andBitmapWordsScalar(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    size_t bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = a[i] & b[i];
+        bits += popcount64(out[i]);
+    }
+    return bits;
+}
+
+size_t orBitmapWordsScalar(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    size_t bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = a[i] | b[i];
+        bits += popcount64(out[i]);
+    }
+    return bits;
+}
+
+#ifdef BILLING_HAS_AVX2
+// AVX2 has no vector popcount, so the combined words are counted with popcnt
+// while they are still in cache
+template <bool Union>
+__attribute__((target("avx2,popcnt")))
+size_t combineBitmapWordsAvx2(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    size_t bits = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Union ? _mm256_or_si256(x, y) : _mm256_and_si256(x, y));
+        bits += __builtin_popcountll(out[i]) + __builtin_popcountll(out[i + 1]) + __builtin_popcountll(out[i + 2]) + __builtin_popcountll(out[i + 3]);
+    }
+    return bits + (Union ? orBitmapWordsScalar : andBitmapWordsScalar)(a + i, b + i, out + i, count - i);
+}
+#endif
+
+size_t andBitmapWords(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+#ifdef BILLING_HAS_AVX2
+    if (cpuHasAvx2()) {
+        return combineBitmapWordsAvx2<false>(a, b, out, count);
+    }
+#endif
+    return andBitmapWordsScalar(a, b, out, count);
+}
+
+size_t orBitmapWords(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+#ifdef BILLING_HAS_AVX2
+    if (cpuHasAvx2()) {
+        return combineBitmapWordsAvx2<true>(a, b, out, count);
+    }
+#endif
+    return orBitmapWordsScalar(a, b, out, count);
+}
+
+void computeBills(const BillingColumns& columns, vector<double>& bills, bool allowSimd) {
+    bills.resize(columns.size());
+#ifdef BILLING_HAS_AVX2
+    if (allowSimd && cpuHasAvx2()) {
+        computeBillsAvx2(columns.baseCost.data(), columns.discountRate.data(), bills.data(), columns.size());
+        return;
+    }
+#endif
+    computeBillsScalar(columns.baseCost.data(), columns.discountRate.data(), bills.data(), columns.size());
+}
+
+uint32_t crc32(const char* data, size_t length, uint32_t crc) {
+    struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    };
+    static const Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table.entries[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+double writeBill(ReportWriter& report, const Customer* cus) {
+    double originalCost = cus->calculateRentalCost();
+    double discountedCost = originalCost;
+    report << "-----------------------------------------\n";
+    report << "|                 BILL                  |\n";
+    report << "-----------------------------------------\n";
+    cus->writeInfo(report);
+
+    // How the pricing rules moved the price away from the flat daily rate;
+    // after a rule change the contract keeps its quote and only that is shown
+    CarTypeId carType = cus->getCarTypeId();
+    int64_t flatCents = llround(cus->getCarType().dailyRentalRate * 100) * cus->RentalDays();
+    int64_t dayCents = pricing().dayTotal(carType, cus->getRentalDate(), cus->getReturnDate());
+    double longRental = pricing().longRentalDiscount(carType, cus->RentalDays());
+    if (pricing().quote(carType, cus->getRentalDate(), cus->getReturnDate()) != cus->getQuotedCents()) {
+        report << "Price as quoted before the pricing rules last changed\n";
+    } else {
+        if (dayCents != flatCents) {
+            report << "Season, weekend and holiday rates: " << (dayCents > flatCents ? "+$" : "-$") << llabs(dayCents - flatCents) / 100.0 << '\n';
+        }
+        if (longRental != 0) {
+            report << "Long rental discount: " << longRental * 100 << "% off $" << dayCents / 100.0 << '\n';
+        }
+    }
+
+    if (cus->isVip()) {
+        originalCost = cus->calculateBaseRentalCost();
+        discountedCost = cus->calculateRentalCost();
+        report << "Total rental cost (before discount): $" << originalCost << '\n';
+        report << "Total rental cost afther discount: $" << discountedCost << '\n';
+    } else {
+        report << "Total rental cost: $" << originalCost << '\n';
+    }
+
+    report << "-----------------------------------------\n";
+    return discountedCost;
+}
+
+double printBill(const Customer* cus) {
+    double discountedCost;
+    {
+        ReportWriter report(cout);
+        discountedCost = writeBill(report, cus);
+    } // flushed before the damage prompt
+    char damage;
+    cout << "Did the customer cause any damage to the car? (y/n)? ";
+    cin >> damage;
+    double insuranceCost = 0;
+    if (damage == 'y' || damage == 'Y') {
+        char tier;
+        cout << "Enter the extent of the damage (A/B/C): ";
+        cin >> tier;
+        switch (tier) {
+            case 'A': case 'a':
+                insuranceCost = 500;
+                break;
+            case 'B': case 'b':
+                insuranceCost = 200;
+                break;
+            case 'C': case 'c':
+                insuranceCost = 100;
+                break;
+            default:
+                cout << "Invalid extent, insurance fee not applicable" << endl;
+                insuranceCost = 0;
+                break;
+        }
+    }
+    double totalCost = discountedCost + insuranceCost;
+    ReportWriter report(cout);
+    report << "Insurance fee: $" << insuranceCost << '\n';
+    report << "Total amount: $" << totalCost << '\n';
+    report << "-----------------------------------------\n";
+    return insuranceCost;
+}
+
+bool readStoredPassword(string& correctPassword) {
+    ifstream file("D:\\pb\\pass.txt"); // Mở tập tin chứa mật khẩu
+    if (file.is_open()) {
+        getline(file, correctPassword); // Đọc mật khẩu từ tập tin
+        file.close(); // Đóng tập tin sau khi đọc xong
+        return true;
+    }
+    cerr << "Cannot open the file pass.txt\n";
+    return false; // Trả về false nếu không thể mở tập tin
+}
+
+void initializeCar(FleetRegistry& VehicleList) {
+    VehicleList.addVehicle(Vehicle("4S1234", "Toyota", "Red", "Good"));
+    VehicleList.addVehicle(Vehicle("4S5678", "Honda", "Blue", "Good"));
+    VehicleList.addVehicle(Vehicle("7S2345", "Ford", "Black", "Good", CAR_7_SEATER));
+    VehicleList.addVehicle(Vehicle("7S6789", "Chevrolet", "White", "Good", CAR_7_SEATER));
+}
+
+Vehicle* findCar(FleetRegistry& VehicleList, const string& licensePlate) {
+    OperationTimer timer(STAT_FIND_CAR);
+    return VehicleList.find(licensePlate);
+}
+
+Vehicle* assignFreeCar(FleetRegistry& VehicleList, CarTypeId carType, const string& brand, Date from, Date to) {
+    OperationTimer timer(STAT_ASSIGN_CAR);
+    return VehicleList.findFree(carType, brand, from, to);
+}
+
+string noFreeCarError(const FleetRegistry& VehicleList, const BookingRequest& req, CarTypeId carType) {
+    return "No " + req.carType + " car" + (req.brand.empty() ? "" : " of brand " + req.brand) + " is free for that period ("
+        + to_string(VehicleList.countAvailable(carType)) + " " + req.carType + " cars of any brand have no bookings)!";
+}
+
+Customer* bookCustomer(FleetRegistry& VehicleList, ContractStore& CustomerList, const BookingRequest& req, ContractId& id, string& error, bool keepId) {
+    Vehicle* car = nullptr;
+    if (!req.licensePlate.empty()) {
+        car = findCar(VehicleList, req.licensePlate);
+        if (!car) {
+            error = "The car is not available or invalid license plate number!";
+            return nullptr;
+        }
+    }
+    CarTypeId carType;
+    if (!carTypes().find(req.carType, carType)) {
+        error = "Invalid car type!";
+        return nullptr;
+    }
+    if (req.returnDate <= req.rentalDate) {
+        error = "The return date must be after the rental date!";
+        return nullptr;
+    }
+    if (!car) {
+        car = assignFreeCar(VehicleList, carType, req.brand, req.rentalDate, req.returnDate);
+        if (!car) {
+            error = noFreeCarError(VehicleList, req, carType);
+            return nullptr;
+        }
+    }
+    if (!car->reservations.isFree(req.rentalDate.days, req.returnDate.days)) {
+        error = "The car is already booked for that period!";
+        return nullptr;
+    }
+    Customer* cus;
+    if (keepId) {
+        if (req.vip) {
+            cus = CustomerList.emplaceAt<CustomerVIP>(id, req.name, req.address, req.phoneNumber, req.brand, req.reason, carType, req.rentalDate, req.returnDate, car, req.discountRate, req.quotedCents);
+        } else {
+            cus = CustomerList.emplaceAt<Customer>(id, req.name, req.address, req.phoneNumber, req.brand, req.reason, carType, req.rentalDate, req.returnDate, car, req.quotedCents);
+        }
+        if (!cus) {
+            error = "Customer ID " + formatContractId(id) + " is already in use!";
+        }
+    } else if (req.vip) {
+        cus = CustomerList.emplace<CustomerVIP>(id, req.name, req.address, req.phoneNumber, req.brand, req.reason, carType, req.rentalDate, req.returnDate, car, req.discountRate, req.quotedCents);
+    } else {
+        cus = CustomerList.emplace<Customer>(id, req.name, req.address, req.phoneNumber, req.brand, req.reason, carType, req.rentalDate, req.returnDate, car, req.quotedCents);
+    }
+    return cus;
+}
+
+bool removeCustomer(ContractStore& CustomerList, const ContractId& id) {
+    return CustomerList.remove(id);
+}
+
+bool checkOutCustomer(ContractStore& CustomerList, const ContractId& id, double damageFee) {
+    return CustomerList.checkOut(id, damageFee);
+}
+
+bool applyCustomerField(Customer* cus, CustomerField field, const string& value) {
+    switch (field) {
+        case FIELD_NAME: cus->setName(value); return true;
+        case FIELD_ADDRESS: cus->setAddress(value); return true;
+        case FIELD_PHONE: cus->setPhoneNumber(value); return true;
+        case FIELD_REASON: cus->setReason(value); return true;
+    }
+    return false;
+}
+
+bool scheduleMaintenance(FleetRegistry& VehicleList, const string& licensePlate, const string& description, const Date& dueDate,
+    MaintenanceTaskId& id, string& error, bool keepId) {
+    Vehicle* car = VehicleList.find(licensePlate);
+    if (car == nullptr) {
+        error = "Car does not exist or is currently rented";
+        return false;
+    }
+    if (!keepId) {
+        id = VehicleList.maintenance().add(car, description, dueDate);
+    } else if (!VehicleList.maintenance().addAt(id, car, description, dueDate)) {
+        error = "Maintenance task ID " + formatTaskId(id) + " is already in use!";
+        return false;
+    }
+    return true;
+}
+
+bool completeMaintenance(FleetRegistry& VehicleList, const MaintenanceTaskId& id, string& error) {
+    const MaintenanceTask* task = VehicleList.maintenance().get(id);
+    if (!task) {
+        error = "Maintenance task " + formatTaskId(id) + " not found.";
+        return false;
+    }
+    if (!VehicleList.maintenance().complete(id)) {
+        error = "Maintenance task " + formatTaskId(id) + " is already completed.";
+        return false;
+    }
+    return true;
+}
+
+bool cancelMaintenance(FleetRegistry& VehicleList, const MaintenanceTaskId& id, string& error) {
+    if (!VehicleList.maintenance().remove(id)) {
+        error = "Maintenance task " + formatTaskId(id) + " not found.";
+        return false;
+    }
+    return true;
+}
+
+bool findMaintenanceByDescription(const FleetRegistry& VehicleList, const string& licensePlate, const string& description, MaintenanceTaskId& id, string& error) {
+    const Vehicle* car = VehicleList.find(licensePlate);
+    if (car == nullptr) {
+        error = "The car does not exist or is currently being rented.";
+        return false;
+    }
+    for (const MaintenanceTaskId& taskId : car->maintenanceTasks) {
+        if (VehicleList.maintenance().get(taskId)->description == description) {
+            id = taskId;
+            return true;
+        }
+    }
+    error = "Maintenance task with description '" + description + "' not found.";
+    return false;
+}
+
+bool matchesFilter(const string& filter, const string& a, const string& b, const string& c) {
+    return filter.empty() || a.find(filter) != string::npos || b.find(filter) != string::npos || c.find(filter) != string::npos;
+}
+
+string lowerCase(const string& text) {
+    string lower(text);
+    for (char& ch : lower) {
+        ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+    }
+    return lower;
+}
+
+FleetQuery parseFleetQuery(const FleetRegistry& VehicleList, const string& text) {
+    FleetQuery query;
+    istringstream words(text);
+    string word;
+    while (words >> word) {
+        string lower = lowerCase(word);
+        CarTypeId type;
+        if (lower == "available") {
+            query.availability = Availability::Available;
+        } else if (lower == "rented") {
+            query.availability = Availability::Rented;
+        } else if (lower == "all") {
+            query.availability = Availability::Any;
+        } else if (VehicleList.index().isBrand(lower)) {
+            query.brands.push_back(lower);
+        } else if (VehicleList.index().isColor(lower)) {
+            query.colors.push_back(lower);
+        } else if (VehicleList.index().isCondition(lower)) {
+            query.conditions.push_back(lower);
+        } else if (carTypes().find(lower, type)) {
+            query.carTypes.push_back(type);
+        } else {
+            query.textFilters.push_back(word);
+        }
+    }
+    return query;
+}
+
+RoaringBitmap searchFleet(const FleetRegistry& VehicleList, const FleetQuery& query) {
+    RoaringBitmap matches = VehicleList.index().match(query);
+    if (query.textFilters.empty()) {
+        return matches;
+    }
+    RoaringBitmap filtered;
+    matches.visitFrom(0, [&](uint32_t slot) {
+        const Vehicle& xe = VehicleList.at(slot);
+        bool keep = true;
+        for (const string& filter : query.textFilters) {
+            keep = keep && matchesFilter(filter, xe.licensePlate(), xe.brandText(), xe.colorText());
+        }
+        if (keep) {
+            filtered.add(slot);
+        }
+        return true;
+    });
+    return filtered;
+}
+
+void writeVehicle(ReportWriter& report, const Vehicle& xe) {
+    report << "license plate number: " << xe.licensePlate() << '\n';
+    report << "Brand: " << xe.brandText() << '\n';
+    report << "Color: " << xe.colorText() << '\n';
+    report << "Car type: " << carTypes().get(xe.carType).name << '\n';
+    report << "Availability: " << (xe.isAvailable() ? "Available" : "Rented") << '\n';
+    report << "Condition: " << xe.conditionText() << '\n';
+    report << "-----------------------------------------\n";
+}
+
+void writeMaintenanceTask(ReportWriter& report, const MaintenanceTaskId& id, const MaintenanceTask& task) {
+    report << "Task ID: " << formatTaskId(id) << '\n';
+    report << "Car: " << task.vehicle->licensePlate() << '\n';
+    report << "Description: " << task.description << '\n';
+    report << "Due Date: " << task.dueDate << '\n';
+    report << "Status: " << (task.completed ? "Completed" : "Pending") << '\n';
+    report << "-----------------------------------------\n";
+}
+
+void padTo8(string& out) {
+    out.append((8 - out.size() % 8) % 8, '\0');
+}
+
+void packColumn(string& out, const vector<int64_t>& values) {
+    int64_t lo = values.empty() ? 0 : *min_element(values.begin(), values.end());
+    int64_t hi = values.empty() ? 0 : *max_element(values.begin(), values.end());
+    uint64_t range = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo);
+    uint8_t width = 0;
+    while (width < 64 && (range >> width) != 0) {
+        width++;
+    }
+    vector<uint64_t> words((values.size() * width + 63) / 64, 0);
+    for (size_t i = 0; i < values.size() && width > 0; ++i) {
+        uint64_t v = static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(lo);
+        size_t bit = i * width, word = bit / 64, offset = bit % 64;
+        words[word] |= v << offset;
+        if (offset + width > 64) {
+            words[word + 1] |= v >> (64 - offset);
+        }
+    }
+    out.append(reinterpret_cast<const char*>(&lo), 8);
+    out.append(reinterpret_cast<const char*>(&hi), 8);
+    out.push_back(static_cast<char>(width));
+    padTo8(out);
+    out.append(reinterpret_cast<const char*>(words.data()), words.size() * 8);
+}
+
+void encodeHistoryBlock(const vector<HistoryRow>& rows, string& out) {
+    string body;
+    uint32_t count = static_cast<uint32_t>(rows.size());
+    body.append(reinterpret_cast<const char*>(&count), 4);
+    body.append(4, '\0');
+    vector<int64_t> values(rows.size());
+    for (int column = 0; column < HISTORY_TEXT_COLUMNS; ++column) {
+        unordered_map<string, uint32_t> codes;
+        vector<const string*> entries;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            auto inserted = codes.emplace(rows[i].text(column), static_cast<uint32_t>(entries.size()));
+            if (inserted.second) {
+                entries.push_back(&inserted.first->first);
+            }
+            values[i] = inserted.first->second;
+        }
+        uint32_t entryCount = static_cast<uint32_t>(entries.size());
+        body.append(reinterpret_cast<const char*>(&entryCount), 4);
+        for (const string* entry : entries) {
+            uint32_t length = static_cast<uint32_t>(entry->size());
+            body.append(reinterpret_cast<const char*>(&length), 4);
+            body += *entry;
+        }
+        padTo8(body);
+        packColumn(body, values);
+    }
+    for (int column = HISTORY_TEXT_COLUMNS; column < HISTORY_COLUMN_COUNT; ++column) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            values[i] = rows[i].number(column);
+        }
+        packColumn(body, values);
+    }
+
+    uint32_t magic = HISTORY_BLOCK_MAGIC;
+    uint32_t checksum = crc32(body.data(), body.size());
+    uint64_t length = body.size();
+    out.append(reinterpret_cast<const char*>(&magic), 4);
+    out.append(reinterpret_cast<const char*>(&checksum), 4);
+    out.append(reinterpret_cast<const char*>(&length), 8);
+    out += body;
+}
+
+void encodeHistoryTailRecord(const HistoryRow& row, string& out) {
+    JournalEncoder e;
+    e.putString(row.plate);
+    e.putString(row.carType);
+    e.putString(row.brand);
+    e.putU32(static_cast<uint32_t>(row.rentalDay));
+    e.putU32(static_cast<uint32_t>(row.days));
+    e.putU64(static_cast<uint64_t>(row.baseCents));
+    e.putU64(static_cast<uint64_t>(row.discountCents));
+    e.putU64(static_cast<uint64_t>(row.damageCents));
+    e.putU8(row.customerClass);
+    uint32_t length = static_cast<uint32_t>(e.data().size());
+    uint32_t checksum = crc32(e.data().data(), length);
+    out.append(reinterpret_cast<const char*>(&length), 4);
+    out.append(reinterpret_cast<const char*>(&checksum), 4);
+    out += e.data();
+}
+
+bool truncateFile(const string& filePath, uint64_t length) {
+#ifdef _WIN32
+    int fd = ::_open(filePath.c_str(), _O_WRONLY | _O_BINARY);
+    bool ok = fd >= 0 && _chsize_s(fd, static_cast<long long>(length)) == 0;
+#else
+    int fd = ::open(filePath.c_str(), O_WRONLY);
+    bool ok = fd >= 0 && ftruncate(fd, static_cast<off_t>(length)) == 0;
+#endif
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return ok;
+}
+
+uint64_t fileSize(const string& filePath) {
+    struct stat info;
+    return stat(filePath.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+uint64_t historyValidLength(const string& filePath) {
+    uint64_t size = fileSize(filePath);
+    FILE* file = fopen(filePath.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    uint64_t valid = 0, lastBlock = 0;
+    char header[HISTORY_BLOCK_HEADER_SIZE];
+    while (fseeko(file, static_cast<long long>(valid), SEEK_SET) == 0 && fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint32_t magic;
+        uint64_t length;
+        memcpy(&magic, header, 4);
+        memcpy(&length, header + 8, 8);
+        if (magic != HISTORY_BLOCK_MAGIC || length > size - valid - sizeof(header)) {
+            break;
+        }
+        lastBlock = valid;
+        valid += sizeof(header) + length;
+    }
+    // Blocks are synced one at a time, so only the last can be torn
+    if (valid > 0) {
+        string body(valid - lastBlock - sizeof(header), '\0');
+        uint32_t checksum;
+        if (fseeko(file, static_cast<long long>(lastBlock), SEEK_SET) != 0 || fread(header, 1, sizeof(header), file) != sizeof(header)
+            || fread(&body[0], 1, body.size(), file) != body.size()) {
+            valid = lastBlock;
+        } else {
+            memcpy(&checksum, header + 4, 4);
+            if (checksum != crc32(body.data(), body.size())) {
+                valid = lastBlock;
+            }
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+void loadHistoryTail(const string& tailPath, uint64_t historyLength, vector<HistoryRow>& rows) {
+    rows.clear();
+    ifstream file(tailPath, ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    string bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    uint64_t baseLength;
+    if (bytes.size() < 16 || memcmp(bytes.data(), HISTORY_TAIL_MAGIC, 8) != 0) {
+        return;
+    }
+    memcpy(&baseLength, bytes.data() + 8, 8);
+    if (baseLength != historyLength) {
+        return; // already sealed into a block
+    }
+    size_t offset = 16;
+    while (bytes.size() - offset >= 8) {
+        uint32_t length, checksum;
+        memcpy(&length, bytes.data() + offset, 4);
+        memcpy(&checksum, bytes.data() + offset + 4, 4);
+        if (bytes.size() - offset - 8 < length || crc32(bytes.data() + offset + 8, length) != checksum) {
+            break; // torn record
+        }
+        JournalDecoder in(bytes.data() + offset + 8, length);
+        HistoryRow row;
+        uint32_t rentalDay, days;
+        uint64_t base, discount, damage;
+        if (!in.getString(row.plate) || !in.getString(row.carType) || !in.getString(row.brand) || !in.getU32(rentalDay)
+            || !in.getU32(days) || !in.getU64(base) || !in.getU64(discount) || !in.getU64(damage) || !in.getU8(row.customerClass)) {
+            break;
+        }
+        row.rentalDay = static_cast<int32_t>(rentalDay);
+        row.days = static_cast<int32_t>(days);
+        row.baseCents = static_cast<int64_t>(base);
+        row.discountCents = static_cast<int64_t>(discount);
+        row.damageCents = static_cast<int64_t>(damage);
+        rows.push_back(std::move(row));
+        offset += 8 + length;
+    }
+}
+
+ArchiveRecord makeArchiveRecord(const Customer* customer, double damageFee) {
+    ArchiveRecord rec;
+    rec.name = customer->getName();
+    rec.address = customer->getAddress();
+    rec.phoneNumber = customer->getPhoneNumber();
+    rec.brand = customer->getBrand();
+    rec.carType = customer->getCarType().name;
+    rec.rentalDate = customer->getRentalDate();
+    rec.returnDate = customer->getReturnDate();
+    rec.totalCost = customer->calculateRentalCost(); // after any VIP discount
+    rec.licensePlate = customer->getCar()->licensePlate();
+    rec.baseCost = customer->calculateBaseRentalCost();
+    rec.damageFee = damageFee;
+    rec.vip = customer->isVip();
+    return rec;
+}
+
+HistoryRow toHistoryRow(const ArchiveRecord& rec) {
+    HistoryRow row;
+    row.plate = rec.licensePlate;
+    row.carType = rec.carType;
+    row.brand = rec.brand;
+    row.rentalDay = rec.rentalDate.days;
+    row.days = rec.returnDate - rec.rentalDate;
+    row.baseCents = llround(rec.baseCost * 100);
+    row.discountCents = row.baseCents - llround(rec.totalCost * 100);
+    row.damageCents = llround(rec.damageFee * 100);
+    row.customerClass = rec.vip ? 1 : 0;
+    return row;
+}
+
+void writeArchiveEntry(ReportWriter& file, const ArchiveRecord& rec) {
+    file << "===================================================================CAR RENTAL AGREEMENT============================================================================" << '\n';
+    file << "|                                                                   RENTER INFORMATION                                                                            |" << '\n';
+    file << "| Name: " << rec.name << "                                                                                                                              |" << '\n';
+    file << "| Address: " << rec.address << "                                                                                                                        |" << '\n';
+    file << "| Phone Number: " << rec.phoneNumber << "                                                                                                               |" << '\n';
+    file << "| Desired Brand: " << rec.brand << "                                                                                                                    |" << '\n';
+    file << "| Vehicle Type: " << rec.carType << "                                                                                                      |" << '\n';
+    file << "| Rental Date: " << rec.rentalDate << "       |" << '\n';
+    file << "| Return Date: " << rec.returnDate << "       |" << '\n';
+    file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << '\n';
+    file << "|                                                                    OWNER INFORMATION     " << "                                                                   |" << '\n';
+    file << "| Name: Nguyen Hoang Bach" << "                                                                                                                                     |" << '\n';
+    file << "| Address: 54 Nguyen Luong Bang" << "                                                                                                                               |" << '\n';
+    file << "| Phone Number: 555-1234" << "                                                                                                                                      |" << '\n';
+    file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << '\n';
+    file << "|                                                                          TERMS                                                                                  |" << '\n';
+    file << "| Terms A,B,C,D,etc" << "                                                                                                                                           |" << '\n';
+    file << "| By signing contract," << "                                                                                                                                        |" << '\n';
+    file << "| both parties confirm their understanding and acceptance of these terms and conditions." << "                                                                      |" << '\n';
+    file << "-------------------------------------------------------------------------------------------------------------------------------------------------------------------" << '\n';
+    if (rec.damageFee > 0) {
+        file << "Rental Cost: $" << rec.totalCost << '\n';
+        file << "Insurance Fee: $" << rec.damageFee << '\n';
+    }
+    file << "Total Rental Cost: $" << rec.totalCost + rec.damageFee << '\n';
+    file << "-----------------------------------------" << '\n';
+}
+
+ArchiveDurability archiveDurabilityFromEnv(int& flushIntervalMs) {
+    flushIntervalMs = ARCHIVE_FLUSH_MS;
+    const char* setting = getenv("PBL_ARCHIVE_SYNC");
+    if (!setting) {
+        return ArchiveDurability::Interval;
+    }
+    string mode = setting;
+    if (mode == "contract") {
+        return ArchiveDurability::PerContract;
+    }
+    if (mode == "shutdown") {
+        return ArchiveDurability::OnShutdown;
+    }
+    int ms = atoi(setting);
+    if (ms > 0) {
+        flushIntervalMs = ms;
+    }
+    return ArchiveDurability::Interval;
+}
+
+void saveDeletedCustomerInfo(const Customer* customer, ArchiveWriter& archive, double damageFee) {
+    OperationTimer timer(STAT_ARCHIVE_SUBMIT);
+    archive.submit(makeArchiveRecord(customer, damageFee));
+}
+
+SnapshotDate toSnapshotDate(const Date& date) {
+    int y, m, day;
+    date.toYMD(y, m, day);
+    SnapshotDate d;
+    d.year = static_cast<int16_t>(y);
+    d.month = static_cast<uint8_t>(m);
+    d.day = static_cast<uint8_t>(day);
+    return d;
+}
+
+Date fromSnapshotDate(const SnapshotDate& d) {
+    return Date::fromYMD(d.year, d.month, d.day);
+}
+
+bool saveSnapshot(const FleetRegistry& fleet, const ContractStore& customerList, const string& filePath, uint64_t lastJournalSequence) {
+    SnapshotWriter writer;
+    return writer.save(fleet, customerList, filePath, lastJournalSequence);
+}
+
+SnapshotStatus loadSnapshot(const string& filePath, FleetRegistry& fleet, ContractStore& customerList, uint64_t& lastJournalSequence) {
+    MappedFile file;
+    if (!file.open(filePath)) {
+        return SnapshotStatus::Missing;
+    }
+    if (file.size() < sizeof(SnapshotHeader)) {
+        return SnapshotStatus::Corrupt;
+    }
+    SnapshotHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION) {
+        return SnapshotStatus::Corrupt;
+    }
+    uint64_t expected = sizeof(SnapshotHeader)
+        + uint64_t(header.vehicleCount) * sizeof(SnapshotVehicle)
+        + uint64_t(header.taskCount) * sizeof(SnapshotTask)
+        + uint64_t(header.customerCount) * sizeof(SnapshotCustomer)
+        + (uint64_t(header.contractSlotCount) + header.taskSlotCount) * sizeof(uint32_t)
+        + uint64_t(header.closedCellCount) * sizeof(SnapshotCubeCell)
+        + header.stringBytes;
+    if (expected != file.size()) {
+        return SnapshotStatus::Corrupt;
+    }
+
+    const char* vehicleBytes = file.data() + sizeof(SnapshotHeader);
+    const char* taskBytes = vehicleBytes + uint64_t(header.vehicleCount) * sizeof(SnapshotVehicle);
+    const char* customerBytes = taskBytes + uint64_t(header.taskCount) * sizeof(SnapshotTask);
+    const char* generationBytes = customerBytes + uint64_t(header.customerCount) * sizeof(SnapshotCustomer);
+    const char* taskGenerationBytes = generationBytes + uint64_t(header.contractSlotCount) * sizeof(uint32_t);
+    const char* closedCellBytes = taskGenerationBytes + uint64_t(header.taskSlotCount) * sizeof(uint32_t);
+    const char* pool = closedCellBytes + uint64_t(header.closedCellCount) * sizeof(SnapshotCubeCell);
+
+    vector<uint32_t> generations(header.contractSlotCount);
+    memcpy(generations.data(), generationBytes, generations.size() * sizeof(uint32_t));
+    vector<uint32_t> taskGenerations(header.taskSlotCount);
+    memcpy(taskGenerations.data(), taskGenerationBytes, taskGenerations.size() * sizeof(uint32_t));
+    auto vehicleAt = [&](uint32_t i) {
+        SnapshotVehicle v;
+        memcpy(&v, vehicleBytes + uint64_t(i) * sizeof(SnapshotVehicle), sizeof(v));
+        return v;
+    };
+    auto taskAt = [&](uint32_t i) {
+        SnapshotTask t;
+        memcpy(&t, taskBytes + uint64_t(i) * sizeof(SnapshotTask), sizeof(t));
+        return t;
+    };
+    auto customerAt = [&](uint32_t i) {
+        SnapshotCustomer c;
+        memcpy(&c, customerBytes + uint64_t(i) * sizeof(SnapshotCustomer), sizeof(c));
+        return c;
+    };
+
+    auto validString = [&](const SnapshotString& ref) {
+        return uint64_t(ref.offset) + ref.length <= header.stringBytes;
+    };
+    auto text = [&](const SnapshotString& ref) {
+        return string(pool + ref.offset, ref.length);
+    };
+    auto view = [&](const SnapshotString& ref) {
+        return string_view(pool + ref.offset, ref.length);
+    };
+    // Car type names repeat on every record; resolve each distinct one once
+    unordered_map<string_view, CarTypeId> typeIds;
+    auto carTypeOf = [&](const SnapshotString& ref, CarTypeId& type) {
+        auto known = typeIds.find(view(ref));
+        if (known != typeIds.end()) {
+            type = known->second;
+            return true;
+        }
+        if (!carTypes().find(text(ref), type)) {
+            return false;
+        }
+        typeIds.emplace(view(ref), type);
+        return true;
+    };
+
+    for (uint32_t i = 0; i < header.vehicleCount; ++i) {
+        SnapshotVehicle v = vehicleAt(i);
+        if (!validString(v.licensePlate) || !validString(v.brand) || !validString(v.color) || !validString(v.condition)
+            || !validString(v.carType) || uint64_t(v.firstTask) + v.taskCount > header.taskCount) {
+            return SnapshotStatus::Corrupt;
+        }
+        CarTypeId carType;
+        if (!carTypeOf(v.carType, carType)) {
+            return SnapshotStatus::Corrupt;
+        }
+    }
+    for (uint32_t i = 0; i < header.taskCount; ++i) {
+        SnapshotTask t = taskAt(i);
+        if (!validString(t.description) || t.taskSlot >= taskGenerations.size() || t.taskGeneration != taskGenerations[t.taskSlot]) {
+            return SnapshotStatus::Corrupt;
+        }
+    }
+    for (uint32_t i = 0; i < header.customerCount; ++i) {
+        SnapshotCustomer c = customerAt(i);
+        if (!validString(c.name) || !validString(c.address) || !validString(c.phoneNumber) || !validString(c.brand)
+            || !validString(c.reason) || !validString(c.carType) || c.vehicleIndex >= header.vehicleCount
+            || c.contractSlot >= generations.size() || c.contractGeneration != generations[c.contractSlot]) {
+            return SnapshotStatus::Corrupt;
+        }
+        CarTypeId carType;
+        if (!carTypeOf(c.carType, carType)) {
+            return SnapshotStatus::Corrupt;
+        }
+    }
+    vector<SnapshotCubeCell> closedCells(header.closedCellCount);
+    if (!closedCells.empty()) {
+        memcpy(closedCells.data(), closedCellBytes, closedCells.size() * sizeof(SnapshotCubeCell));
+    }
+    for (const SnapshotCubeCell& cell : closedCells) {
+        CarTypeId carType;
+        if (!validString(cell.brand) || !validString(cell.carType) || !carTypeOf(cell.carType, carType) || cell.month < 0) {
+            return SnapshotStatus::Corrupt;
+        }
+    }
+
+    FleetRegistry loadedFleet;
+    loadedFleet.reserve(header.vehicleCount);
+    loadedFleet.maintenance().reserve(taskGenerations.size());
+    loadedFleet.maintenance().restoreGenerations(taskGenerations);
+    vector<Vehicle*> slots(header.vehicleCount);
+    for (uint32_t i = 0; i < header.vehicleCount; ++i) {
+        SnapshotVehicle v = vehicleAt(i);
+        CarTypeId carType = CAR_4_SEATER;
+        carTypeOf(v.carType, carType); // checked above
+        // The stored availability flag is not needed: the contracts below book their cars
+        Vehicle* car = loadedFleet.addVehicle(Vehicle(view(v.licensePlate), view(v.brand), view(v.color), view(v.condition), carType));
+        if (!car) {
+            return SnapshotStatus::Corrupt; // duplicate plate
+        }
+        car->maintenanceTasks.reserve(v.taskCount);
+        for (uint32_t i = v.firstTask; i < v.firstTask + v.taskCount; ++i) {
+            SnapshotTask t = taskAt(i);
+            if (!loadedFleet.maintenance().addAt(MaintenanceTaskId{t.taskSlot, t.taskGeneration}, car, text(t.description),
+                    fromSnapshotDate(t.dueDate), t.completed != 0)) {
+                return SnapshotStatus::Corrupt; // two tasks with one ID
+            }
+        }
+        slots[i] = car;
+    }
+
+    // Declared after the fleet so a rejected load releases its bookings first
+    ContractStore loadedCustomers;
+    loadedCustomers.reserve(generations.size());
+    loadedCustomers.restoreGenerations(generations);
+    for (uint32_t i = 0; i < header.customerCount; ++i) {
+        SnapshotCustomer c = customerAt(i);
+        Date rentalDate = fromSnapshotDate(c.rentalDate), returnDate = fromSnapshotDate(c.returnDate);
+        Vehicle* car = slots[c.vehicleIndex];
+        if (returnDate <= rentalDate || !car->reservations.isFree(rentalDate.days, returnDate.days)) {
+            return SnapshotStatus::Corrupt; // overlapping bookings of one car
+        }
+        CarTypeId carType = CAR_4_SEATER;
+        carTypeOf(c.carType, carType); // checked above
+        ContractId id{c.contractSlot, c.contractGeneration};
+        Customer* cus;
+        if (c.vip) {
+            cus = loadedCustomers.emplaceAt<CustomerVIP>(id, text(c.name), text(c.address), text(c.phoneNumber), view(c.brand), text(c.reason),
+                carType, rentalDate, returnDate, car, c.discountRate, c.quotedCents);
+        } else {
+            cus = loadedCustomers.emplaceAt<Customer>(id, text(c.name), text(c.address), text(c.phoneNumber), view(c.brand), text(c.reason),
+                carType, rentalDate, returnDate, car, c.quotedCents);
+        }
+        if (!cus) {
+            return SnapshotStatus::Corrupt; // two customers with one ID
+        }
+    }
+    for (const SnapshotCubeCell& cell : closedCells) {
+        CubeEntry key = {};
+        key.brand = symbols().intern(view(cell.brand));
+        carTypeOf(cell.carType, key.carType); // checked above
+        key.vip = cell.vip != 0;
+        key.rentalDate = Date::fromYMD(cell.month / 12, cell.month % 12 + 1, 1);
+        CubeMeasures checkedOut;
+        checkedOut.contracts = cell.contracts;
+        checkedOut.rentalDays = cell.rentalDays;
+        checkedOut.revenueCents = cell.revenueCents;
+        loadedCustomers.revenueCube().restoreCheckedOut(key, checkedOut, cell.damageCents);
+    }
+
+    // Old customers point into the old fleet, so release them first. Moving
+    // the fleet keeps its vehicles in place, so the new customers stay valid.
+    customerList.clear();
+    customerList.swap(loadedCustomers);
+    fleet = std::move(loadedFleet);
+    lastJournalSequence = header.lastJournalSequence;
+    return SnapshotStatus::Loaded;
+}
+
+// Reads a field of decimal digits with from_chars; the whole field must parse
+bool parseImportNumber(string_view text, int& value) {
+    auto parsed = from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && parsed.ec == errc() && parsed.ptr == text.data() + text.size();
+}
+
+bool parseImportDate(string_view text, Date& date) {
+    size_t first = text.find('/');
+    size_t second = first == string_view::npos ? first : text.find('/', first + 1);
+    int day, month, year;
+    if (second == string_view::npos || !parseImportNumber(text.substr(0, first), day)
+        || !parseImportNumber(text.substr(first + 1, second - first - 1), month) || !parseImportNumber(text.substr(second + 1), year)
+        || !Date::isValid(year, month, day)) {
+        return false;
+    }
+    date = Date::fromYMD(year, month, day);
+    return true;
+}
+
+// Parses one data line into the chunk; returns why it was rejected, or null
+const char* parseFleetImportRow(string_view text, FleetImportChunk& chunk, uint32_t line) {
+    string_view fields[5];
+    size_t from = 0;
+    for (int i = 0; i < 5; ++i) {
+        size_t comma = text.find(',', from);
+        if (comma == string_view::npos && i < 4) {
+            return "expected plate,brand,color,car type,condition";
+        }
+        fields[i] = text.substr(from, comma == string_view::npos ? string_view::npos : comma - from);
+        from = comma == string_view::npos ? text.size() + 1 : comma + 1;
+    }
+    if (fields[0].empty() || fields[0].size() > MAX_PLATE_LENGTH) {
+        return "invalid license plate";
+    }
+    if (fields[1].empty() || fields[2].empty() || fields[4].empty()) {
+        return "empty brand, color or condition";
+    }
+    ImportedVehicle vehicle{fields[0], fields[1], fields[2], fields[4], CAR_4_SEATER, static_cast<uint32_t>(chunk.tasks.size()), 0, line};
+    size_t type = 0;
+    while (type < carTypes().size() && carTypes().get(static_cast<CarTypeId>(type)).name != fields[3]) {
+        type++;
+    }
+    if (type == carTypes().size()) {
+        return "unknown car type";
+    }
+    vehicle.carType = static_cast<CarTypeId>(type);
+
+    while (from <= text.size()) {
+        size_t comma = text.find(',', from);
+        size_t end = comma == string_view::npos ? comma : text.find(',', comma + 1);
+        Date dueDate;
+        if (comma == string_view::npos || comma == from
+            || !parseImportDate(text.substr(comma + 1, end == string_view::npos ? end : end - comma - 1), dueDate)) {
+            chunk.tasks.resize(vehicle.firstTask);
+            return "invalid maintenance task (description,dd/mm/yyyy)";
+        }
+        chunk.tasks.push_back(ImportedTask{text.substr(from, comma - from), dueDate});
+        from = end == string_view::npos ? text.size() + 1 : end + 1;
+    }
+    vehicle.taskCount = static_cast<uint32_t>(chunk.tasks.size()) - vehicle.firstTask;
+    chunk.vehicles.push_back(vehicle);
+    return nullptr;
+}
+
+void parseFleetImportChunk(FleetImportChunk& chunk) {
+    chunk.lines = 0;
+    chunk.vehicles.clear();
+    chunk.tasks.clear();
+    chunk.errors.clear();
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+        const char* lineEnd = eol ? eol : chunk.end;
+        string_view text(p, lineEnd - p);
+        p = eol ? eol + 1 : chunk.end;
+        uint32_t line = ++chunk.lines;
+        if (!text.empty() && text.back() == '\r') {
+            text.remove_suffix(1);
+        }
+        if (text.empty() || text[0] == '#' || (chunk.firstInFile && line == 1 && text.compare(0, 6, "plate,") == 0)) {
+            continue;
+        }
+        if (const char* reason = parseFleetImportRow(text, chunk, line)) {
+            chunk.errors.push_back(ImportError{line, reason});
+        }
+    }
+}
+
+bool importFleetCsv(const string& filePath, FleetRegistry* fleet, size_t threads, ReportWriter& report, FleetImportResult& result) {
+    auto start = chrono::steady_clock::now();
+    result = FleetImportResult();
+    MappedFile file;
+    if (!file.open(filePath)) {
+        return false;
+    }
+    threads = max<size_t>(threads, 1);
+
+    // Chunks end just after a newline, so no line is split between two
+    vector<FleetImportChunk> chunks;
+    const char* data = file.data();
+    const char* fileEnd = data + file.size();
+    for (const char* p = data; p < fileEnd;) {
+        const char* cut = p + min(FLEET_IMPORT_CHUNK_BYTES, static_cast<size_t>(fileEnd - p));
+        if (cut < fileEnd) {
+            const char* eol = static_cast<const char*>(memchr(cut, '\n', fileEnd - cut));
+            cut = eol ? eol + 1 : fileEnd;
+        }
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = cut;
+        chunks.back().firstInFile = p == data;
+        p = cut;
+    }
+
+    // Workers stay at most two chunks each ahead of the insertion
+    mutex lock;
+    condition_variable changed;
+    vector<char> parsed(chunks.size(), 0);
+    size_t nextChunk = 0, inserted = 0;
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            while (true) {
+                size_t index;
+                {
+                    unique_lock<mutex> guard(lock);
+                    changed.wait(guard, [&] { return nextChunk >= chunks.size() || nextChunk < inserted + threads * 2; });
+                    if (nextChunk >= chunks.size()) {
+                        return;
+                    }
+                    index = nextChunk++;
+                }
+                parseFleetImportChunk(chunks[index]);
+                {
+                    lock_guard<mutex> guard(lock);
+                    parsed[index] = 1;
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    auto reject = [&](uint64_t line, const char* reason) {
+        if (result.rejected++ < FLEET_IMPORT_REPORTED_ERRORS) {
+            report << filePath << " line " << static_cast<unsigned long long>(line) << ": " << reason << ", skipped.\n";
+        }
+    };
+    uint64_t linesBefore = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return parsed[i] != 0; });
+        }
+        FleetImportChunk& chunk = chunks[i];
+        if (fleet) {
+            fleet->reserve(fleet->size() + chunk.vehicles.size());
+        }
+        size_t error = 0;
+        for (const ImportedVehicle& row : chunk.vehicles) {
+            for (; error < chunk.errors.size() && chunk.errors[error].line < row.line; ++error) {
+                reject(linesBefore + chunk.errors[error].line, chunk.errors[error].reason);
+            }
+            if (fleet) {
+                Vehicle* car = fleet->addVehicle(Vehicle(string(row.plate), row.brand, row.color, row.condition, row.carType));
+                if (!car) {
+                    reject(linesBefore + row.line, "license plate already in the fleet");
+                    continue;
+                }
+                for (uint32_t k = 0; k < row.taskCount; ++k) {
+                    const ImportedTask& task = chunk.tasks[row.firstTask + k];
+                    fleet->maintenance().add(car, string(task.description), task.dueDate);
+                }
+            }
+            result.vehicles++;
+            result.tasks += row.taskCount;
+        }
+        for (; error < chunk.errors.size(); ++error) {
+            reject(linesBefore + chunk.errors[error].line, chunk.errors[error].reason);
+        }
+        linesBefore += chunk.lines;
+        chunk = FleetImportChunk(); // its rows are in the fleet now
+        {
+            lock_guard<mutex> guard(lock);
+            inserted = i + 1;
+        }
+        changed.notify_all();
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    if (result.rejected > FLEET_IMPORT_REPORTED_ERRORS) {
+        report << "... and " << static_cast<unsigned long long>(result.rejected - FLEET_IMPORT_REPORTED_ERRORS) << " more rejected rows\n";
+    }
+    result.rows = result.vehicles + result.rejected;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool parseHistoryBlock(const char* body, uint64_t length, HistoryBlockView& view) {
+    uint64_t offset = 8;
+    if (length < offset) {
+        return false;
+    }
+    memcpy(&view.rows, body, 4);
+    auto align = [&] { offset = (offset + 7) / 8 * 8; };
+    auto column = [&](PackedColumnView& col) {
+        if (length - offset < 24) {
+            return false;
+        }
+        memcpy(&col.min, body + offset, 8);
+        memcpy(&col.max, body + offset + 8, 8);
+        col.width = static_cast<uint8_t>(body[offset + 16]);
+        offset += 24;
+        uint64_t bytes = (uint64_t(view.rows) * col.width + 63) / 64 * 8;
+        if (col.width > 64 || length - offset < bytes) {
+            return false;
+        }
+        col.words = reinterpret_cast<const uint64_t*>(body + offset);
+        offset += bytes;
+        return true;
+    };
+    for (int c = 0; c < HISTORY_TEXT_COLUMNS; ++c) {
+        DictionaryView& dict = view.text[c];
+        if (length - offset < 4) {
+            return false;
+        }
+        memcpy(&dict.count, body + offset, 4);
+        offset += 4;
+        dict.entries = body + offset;
+        for (uint32_t i = 0; i < dict.count; ++i) {
+            uint32_t entryLength;
+            if (length - offset < 4) {
+                return false;
+            }
+            memcpy(&entryLength, body + offset, 4);
+            if (length - offset - 4 < entryLength) {
+                return false;
+            }
+            offset += 4 + entryLength;
+        }
+        dict.entriesEnd = body + offset;
+        align();
+        if (offset > length || !column(dict.codes) || (view.rows > 0 && uint64_t(dict.codes.max) >= dict.count)) {
+            return false;
+        }
+    }
+    for (int c = HISTORY_TEXT_COLUMNS; c < HISTORY_COLUMN_COUNT; ++c) {
+        if (!column(view.numbers[c])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+map<string, array<RevenueCell, 12>> revenueByMonthAndType(const string& historyPath, const string& tailPath, int year, HistoryScanStats& stats) {
+    int32_t first = Date::fromYMD(year, 1, 1).days;
+    int32_t last = Date::fromYMD(year + 1, 1, 1).days - 1;
+    vector<uint8_t> monthOfDay(last - first + 1);
+    for (int32_t day = first; day <= last; ++day) {
+        monthOfDay[day - first] = static_cast<uint8_t>(Date(day).month() - 1);
+    }
+
+    map<string, array<RevenueCell, 12>> result;
+    vector<int64_t> rental, base, discount, damage, type;
+    vector<HistoryRow> tailRows;
+    scanHistory(historyPath, tailPath, stats, tailRows, [&](const HistoryBlockView& view) {
+        const PackedColumnView& days = view.numbers[HISTORY_RENTAL_DAY];
+        if (view.rows == 0 || days.max < first || days.min > last) {
+            stats.blocksSkipped++;
+            return;
+        }
+        stats.rowsScanned += view.rows;
+        rental.resize(view.rows);
+        base.resize(view.rows);
+        discount.resize(view.rows);
+        damage.resize(view.rows);
+        type.resize(view.rows);
+        days.decode(view.rows, rental.data());
+        view.numbers[HISTORY_BASE_CENTS].decode(view.rows, base.data());
+        view.numbers[HISTORY_DISCOUNT_CENTS].decode(view.rows, discount.data());
+        view.numbers[HISTORY_DAMAGE_CENTS].decode(view.rows, damage.data());
+        view.text[HISTORY_CAR_TYPE].codes.decode(view.rows, type.data());
+
+        vector<RevenueCell> cells(view.text[HISTORY_CAR_TYPE].count * 12);
+        for (size_t i = 0; i < view.rows; ++i) {
+            if (rental[i] < first || rental[i] > last) {
+                continue;
+            }
+            RevenueCell& cell = cells[type[i] * 12 + monthOfDay[rental[i] - first]];
+            cell.cents += base[i] - discount[i] + damage[i];
+            cell.rentals++;
+        }
+        view.text[HISTORY_CAR_TYPE].forEachEntry([&](uint32_t code, const char* name, uint32_t length) {
+            array<RevenueCell, 12>* months = nullptr;
+            for (int m = 0; m < 12; ++m) {
+                const RevenueCell& cell = cells[code * 12 + m];
+                if (cell.rentals == 0) {
+                    continue;
+                }
+                if (!months) {
+                    months = &result[string(name, length)];
+                }
+                (*months)[m].cents += cell.cents;
+                (*months)[m].rentals += cell.rentals;
+            }
+        });
+    });
+    for (const HistoryRow& row : tailRows) {
+        if (row.rentalDay >= first && row.rentalDay <= last) {
+            RevenueCell& cell = result[row.carType][monthOfDay[row.rentalDay - first]];
+            cell.cents += row.revenueCents();
+            cell.rentals++;
+        }
+    }
+    stats.rowsScanned += tailRows.size();
+    return result;
+}
+
+vector<HistoryRow> rentalsOfPlate(const string& historyPath, const string& tailPath, const string& plate, HistoryScanStats& stats) {
+    vector<HistoryRow> rows;
+    vector<int64_t> codes;
+    vector<string_view> carTypes, brands;
+    vector<HistoryRow> tailRows;
+    scanHistory(historyPath, tailPath, stats, tailRows, [&](const HistoryBlockView& view) {
+        uint32_t code = 0;
+        if (!view.text[HISTORY_PLATE].find(plate, code)) {
+            stats.blocksSkipped++;
+            return;
+        }
+        stats.rowsScanned += view.rows;
+        codes.resize(view.rows);
+        view.text[HISTORY_PLATE].codes.decode(view.rows, codes.data());
+        view.text[HISTORY_CAR_TYPE].index(carTypes);
+        view.text[HISTORY_BRAND].index(brands);
+        for (size_t i = 0; i < view.rows; ++i) {
+            if (codes[i] != code) {
+                continue;
+            }
+            HistoryRow row;
+            row.plate = plate;
+            row.carType = string(carTypes[view.text[HISTORY_CAR_TYPE].codes.at(i)]);
+            row.brand = string(brands[view.text[HISTORY_BRAND].codes.at(i)]);
+            row.rentalDay = static_cast<int32_t>(view.numbers[HISTORY_RENTAL_DAY].at(i));
+            row.days = static_cast<int32_t>(view.numbers[HISTORY_DAYS].at(i));
+            row.baseCents = view.numbers[HISTORY_BASE_CENTS].at(i);
+            row.discountCents = view.numbers[HISTORY_DISCOUNT_CENTS].at(i);
+            row.damageCents = view.numbers[HISTORY_DAMAGE_CENTS].at(i);
+            row.customerClass = static_cast<uint8_t>(view.numbers[HISTORY_CUSTOMER_CLASS].at(i));
+            rows.push_back(std::move(row));
+        }
+    });
+    for (HistoryRow& row : tailRows) {
+        if (row.plate == plate) {
+            rows.push_back(std::move(row));
+        }
+    }
+    stats.rowsScanned += tailRows.size();
+    return rows;
+}
+
+string formatCents(int64_t cents) {
+    char text[32];
+    snprintf(text, sizeof(text), "%s%lld.%02lld", cents < 0 ? "-" : "", llabs(cents) / 100, llabs(cents) % 100);
+    return text;
+}
+
+void printRevenueReport(ReportWriter& report, int year, const map<string, array<RevenueCell, 12>>& revenue) {
+    report << "Revenue by month and car type, " << year << '\n';
+    report << "Month    Car type        Rentals    Revenue\n";
+    int64_t total = 0;
+    for (int m = 0; m < 12; ++m) {
+        for (const auto& type : revenue) {
+            const RevenueCell& cell = type.second[m];
+            if (cell.rentals == 0) {
+                continue;
+            }
+            char line[160];
+            snprintf(line, sizeof(line), "%2d/%d  %-15s %8llu    $%s\n", m + 1, year, type.first.c_str(),
+                static_cast<unsigned long long>(cell.rentals), formatCents(cell.cents).c_str());
+            report << line;
+            total += cell.cents;
+        }
+    }
+    report << "Total: $" << formatCents(total) << '\n';
+}
+
+void printPlateRentals(ReportWriter& report, const string& plate, const vector<HistoryRow>& rows) {
+    report << "Rentals of " << plate << ": " << static_cast<unsigned long>(rows.size()) << '\n';
+    for (const HistoryRow& row : rows) {
+        report << Date(row.rentalDay) << " - " << Date(row.rentalDay + row.days) << "  " << row.carType << ", " << row.brand
+               << (row.customerClass ? ", VIP" : "") << "  $" << formatCents(row.revenueCents())
+               << " (base $" << formatCents(row.baseCents) << ", discount $" << formatCents(row.discountCents)
+               << ", damage $" << formatCents(row.damageCents) << ")\n";
+    }
+}
+
+bool runHistoryQuery(const string& kind, const string& argument) {
+    HistoryScanStats stats;
+    auto start = chrono::steady_clock::now();
+    ReportWriter report(cout);
+    if (kind == "revenue") {
+        int year = atoi(argument.c_str());
+        if (year < 1970 || year > 9999) {
+            report << "Invalid year!\n";
+            return false;
+        }
+        printRevenueReport(report, year, revenueByMonthAndType(HISTORY_PATH, HISTORY_TAIL_PATH, year, stats));
+    } else if (kind == "plate") {
+        printPlateRentals(report, argument, rentalsOfPlate(HISTORY_PATH, HISTORY_TAIL_PATH, argument, stats));
+    } else {
+        report << "Unknown history query '" << kind << "'\n";
+        return false;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report << "(" << static_cast<unsigned long>(stats.blocks) << " blocks, " << static_cast<unsigned long>(stats.blocksSkipped)
+           << " skipped, " << static_cast<unsigned long long>(stats.rowsScanned) << " rows scanned in " << seconds << " s)\n";
+    return true;
+}
+
+bool applyJournalRecord(uint8_t type, JournalDecoder& in, FleetRegistry& VehicleList, ContractStore& CustomerList) {
+    string error;
+    ContractId id;
+    switch (type) {
+        case JOURNAL_ADD_CUSTOMER:
+        case JOURNAL_BOOK_CONTRACT: {
+            BookingRequest req;
+            uint8_t vip;
+            uint64_t quoted = static_cast<uint64_t>(QUOTE_FROM_RULES);
+            bool keepId = type == JOURNAL_BOOK_CONTRACT;
+            if ((keepId && (!in.getU32(id.slot) || !in.getU32(id.generation)))
+                || !in.getString(req.name) || !in.getString(req.address) || !in.getString(req.phoneNumber) || !in.getString(req.brand)
+                || !in.getString(req.reason) || !in.getString(req.carType) || !in.getString(req.licensePlate)
+                || !in.getDate(req.rentalDate) || !in.getDate(req.returnDate) || !in.getU8(vip) || !in.getDouble(req.discountRate)
+                || (!in.atEnd() && !in.getU64(quoted))) {
+                return false;
+            }
+            req.vip = vip != 0;
+            req.quotedCents = static_cast<int64_t>(quoted);
+            return bookCustomer(VehicleList, CustomerList, req, id, error, keepId) != nullptr;
+        }
+        // Types 2-4 addressed customers by list position, which no longer
+        // identifies a contract; such records are counted as rejected
+        case JOURNAL_DELETE_CUSTOMER:
+        case JOURNAL_EXTEND_RENTAL:
+        case JOURNAL_CHANGE_INFO:
+            return false;
+        case JOURNAL_END_CONTRACT: {
+            double damageFee = 0;
+            if (!in.getU32(id.slot) || !in.getU32(id.generation) || (!in.atEnd() && !in.getDouble(damageFee))) {
+                return false;
+            }
+            return checkOutCustomer(CustomerList, id, damageFee);
+        }
+        case JOURNAL_EXTEND_CONTRACT: {
+            Date newReturnDate;
+            uint64_t quoted = static_cast<uint64_t>(QUOTE_FROM_RULES);
+            if (!in.getU32(id.slot) || !in.getU32(id.generation) || !in.getDate(newReturnDate) || (!in.atEnd() && !in.getU64(quoted))) {
+                return false;
+            }
+            Customer* cus = CustomerList.get(id);
+            return cus && cus->setReturnDate(newReturnDate, static_cast<int64_t>(quoted));
+        }
+        case JOURNAL_CHANGE_CONTRACT: {
+            uint8_t field;
+            string value;
+            if (!in.getU32(id.slot) || !in.getU32(id.generation) || !in.getU8(field) || !in.getString(value)) {
+                return false;
+            }
+            Customer* cus = CustomerList.get(id);
+            return cus && applyCustomerField(cus, static_cast<CustomerField>(field), value);
+        }
+        case JOURNAL_ADD_MAINTENANCE:
+        case JOURNAL_SCHEDULE_MAINTENANCE: {
+            string licensePlate, description;
+            Date dueDate;
+            MaintenanceTaskId taskId;
+            bool keepId = type == JOURNAL_SCHEDULE_MAINTENANCE;
+            if ((keepId && (!in.getU32(taskId.slot) || !in.getU32(taskId.generation)))
+                || !in.getString(licensePlate) || !in.getString(description) || !in.getDate(dueDate)) {
+                return false;
+            }
+            return scheduleMaintenance(VehicleList, licensePlate, description, dueDate, taskId, error, keepId);
+        }
+        case JOURNAL_DELETE_MAINTENANCE: {
+            string licensePlate, description;
+            MaintenanceTaskId taskId;
+            if (!in.getString(licensePlate) || !in.getString(description)) {
+                return false;
+            }
+            return findMaintenanceByDescription(VehicleList, licensePlate, description, taskId, error) && cancelMaintenance(VehicleList, taskId, error);
+        }
+        case JOURNAL_COMPLETE_MAINTENANCE:
+        case JOURNAL_CANCEL_MAINTENANCE: {
+            MaintenanceTaskId taskId;
+            if (!in.getU32(taskId.slot) || !in.getU32(taskId.generation)) {
+                return false;
+            }
+            return type == JOURNAL_COMPLETE_MAINTENANCE ? completeMaintenance(VehicleList, taskId, error) : cancelMaintenance(VehicleList, taskId, error);
+        }
+    }
+    return false;
+}
+
+ReplayResult replayJournal(const string& filePath, uint64_t afterSequence, FleetRegistry& VehicleList, ContractStore& CustomerList) {
+    ReplayResult result;
+    result.lastSequence = afterSequence;
+    MappedFile file;
+    if (!file.open(filePath)) {
+        return result;
+    }
+    const char* data = file.data();
+    size_t offset = 0;
+    while (offset < file.size()) {
+        if (file.size() - offset < JOURNAL_HEADER_SIZE) {
+            result.tornTail = true;
+            break;
+        }
+        uint32_t length, checksum;
+        uint64_t sequence;
+        memcpy(&length, data + offset, 4);
+        memcpy(&checksum, data + offset + 4, 4);
+        memcpy(&sequence, data + offset + 8, 8);
+        if (file.size() - offset - JOURNAL_HEADER_SIZE < length
+            || crc32(data + offset + 8, JOURNAL_HEADER_SIZE - 8 + length) != checksum) {
+            result.tornTail = true;
+            break;
+        }
+        if (sequence > afterSequence) {
+            JournalDecoder in(data + offset + JOURNAL_HEADER_SIZE, length);
+            if (applyJournalRecord(static_cast<uint8_t>(data[offset + 16]), in, VehicleList, CustomerList)) {
+                result.applied++;
+            } else {
+                result.rejected++;
+            }
+            result.lastSequence = sequence;
+        }
+        offset += JOURNAL_HEADER_SIZE + length;
+    }
+    result.validBytes = offset;
+    return result;
+}
+
+bool compactJournal(Journal& journal, const FleetRegistry& VehicleList, const ContractStore& CustomerList) {
+    journal.sync(); // the snapshot covers these records whether or not they reached the disk
+    if (!saveSnapshot(VehicleList, CustomerList, SNAPSHOT_PATH, journal.lastSequence())) {
+        return false;
+    }
+    return !journal.isOpen() || journal.reset();
+}
+
+bool restoreState(FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal) {
+    loadCarTypes(CAR_TYPES_PATH); // before the snapshot, which may refer to these types
+    loadPricingRules(PRICING_PATH); // every contract loaded below is priced with these rules
+    uint64_t snapshotSequence = 0;
+    SnapshotStatus snapshotStatus = loadSnapshot(SNAPSHOT_PATH, VehicleList, CustomerList, snapshotSequence);
+    if (snapshotStatus == SnapshotStatus::Corrupt) {
+        cout << "The snapshot file " << SNAPSHOT_PATH << " is damaged or from another version. Fix or remove it before starting." << endl;
+        return false;
+    }
+    if (snapshotStatus == SnapshotStatus::Missing) {
+        initializeCar(VehicleList); // Initialize vehicle list
+    }
+
+    // Redo the changes made since that snapshot, then keep journaling
+    ReplayResult replay = replayJournal(JOURNAL_PATH, snapshotSequence, VehicleList, CustomerList);
+    if (replay.applied > 0 || replay.rejected > 0) {
+        cout << "Recovered " << replay.applied << " change(s) from the journal";
+        if (replay.rejected > 0) {
+            cout << ", " << replay.rejected << " could not be applied";
+        }
+        cout << "." << endl;
+    }
+    if (replay.tornTail) {
+        cout << "The journal ended with an incomplete record, which was discarded." << endl;
+    }
+    if (!journal.open(JOURNAL_PATH, replay.lastSequence + 1, replay.validBytes)) {
+        cout << "Unable to open the journal file; changes will only be saved on exit." << endl;
+    }
+    return true;
+}
+
+bool parseDate(const string& text, Date& date) {
+    int day, month, year;
+    char extra;
+    if (sscanf(text.c_str(), "%d/%d/%d%c", &day, &month, &year, &extra) != 3
+        || !Date::isValid(year, month, day)) {
+        return false;
+    }
+    date = Date::fromYMD(year, month, day);
+    return true;
+}
+
+Customer* findContract(const string& text, const ContractStore& CustomerList, ContractId& id) {
+    return parseContractId(text, id) ? CustomerList.get(id) : nullptr;
+}
+
+bool journaled(const Journal& journal, bool written, string& error) {
+    if (!written) {
+        error = "the change was made but could not be written to the journal (" + journal.error() + "); save a snapshot to keep it";
+    }
+    return written;
+}
+
+bool runExclusiveBatchCommand(const vector<string>& fields, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, string& error) {
+    const string& command = fields[0];
+    if (command == "change") {
+        ContractId id;
+        Customer* cus = fields.size() == 4 ? findContract(fields[1], CustomerList, id) : nullptr;
+        if (!cus) {
+            error = "Invalid customer ID!";
+            return false;
+        }
+        CustomerField field;
+        if (fields[2] == "name") {
+            field = FIELD_NAME;
+        } else if (fields[2] == "address") {
+            field = FIELD_ADDRESS;
+        } else if (fields[2] == "phone") {
+            field = FIELD_PHONE;
+        } else if (fields[2] == "reason") {
+            field = FIELD_REASON;
+        } else {
+            error = "unknown field '" + fields[2] + "'";
+            return false;
+        }
+        applyCustomerField(cus, field, fields[3]);
+        return journaled(journal, journal.logChangeInfo(id, field, fields[3]), error);
+    }
+    if (command == "maint") {
+        if (fields.size() == 5 && fields[1] == "add") {
+            Date dueDate;
+            if (!parseDate(fields[4], dueDate)) {
+                error = "invalid date";
+                return false;
+            }
+            MaintenanceTaskId id;
+            if (!scheduleMaintenance(VehicleList, fields[2], fields[3], dueDate, id, error)) {
+                return false;
+            }
+            return journaled(journal, journal.logScheduleMaintenance(id, fields[2], fields[3], dueDate), error);
+        }
+        bool done = fields.size() > 1 && fields[1] == "done";
+        if ((fields.size() == 3 || (fields.size() == 4 && !done)) && (done || fields[1] == "delete")) {
+            MaintenanceTaskId id;
+            if (fields.size() == 3 && !parseTaskId(fields[2], id)) {
+                error = "Invalid maintenance task ID";
+                return false;
+            }
+            if (fields.size() == 4 && !findMaintenanceByDescription(VehicleList, fields[2], fields[3], id, error)) {
+                return false;
+            }
+            if (done) {
+                if (!completeMaintenance(VehicleList, id, error)) {
+                    return false;
+                }
+                return journaled(journal, journal.logCompleteMaintenance(id), error);
+            }
+            if (!cancelMaintenance(VehicleList, id, error)) {
+                return false;
+            }
+            return journaled(journal, journal.logCancelMaintenance(id), error);
+        }
+        error = "expected maint|add|plate|description|date, maint|done|task ID or maint|delete|task ID";
+        return false;
+    }
+    if (command == "rule") {
+        size_t recomputed;
+        return runPricingRuleCommand(fields, recomputed, error);
+    }
+    error = "unknown command '" + command + "'";
+    return false;
+}
+
+void splitFields(const string& line, vector<string>& fields) {
+    fields.clear();
+    size_t from = 0;
+    while (true) {
+        size_t bar = line.find('|', from);
+        fields.push_back(line.substr(from, bar == string::npos ? string::npos : bar - from));
+        if (bar == string::npos) {
+            break;
+        }
+        from = bar + 1;
+    }
+}
+
+bool parseBookingCommand(const vector<string>& fields, BookingRequest& req, string& error) {
+    bool vip = fields[0] == "addvip";
+    if (fields.size() != (vip ? 11u : 10u)) {
+        error = "expected " + string(vip ? "10" : "9") + " fields";
+        return false;
+    }
+    req.name = fields[1];
+    req.address = fields[2];
+    req.phoneNumber = fields[3];
+    req.brand = fields[4];
+    req.reason = fields[5];
+    req.carType = fields[6];
+    req.licensePlate = fields[7];
+    if (!parseDate(fields[8], req.rentalDate) || !parseDate(fields[9], req.returnDate)) {
+        error = "invalid date";
+        return false;
+    }
+    if (vip) {
+        char* end;
+        req.vip = true;
+        req.discountRate = strtod(fields[10].c_str(), &end);
+        if (fields[10].empty() || *end != '\0' || req.discountRate < 0 || req.discountRate > 1) {
+            error = "invalid discount rate";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool runBatchCommand(const vector<string>& fields, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, string& error) {
+    const string& command = fields[0];
+    if (command == "add" || command == "addvip") {
+        BookingRequest req;
+        ContractId id;
+        return parseBookingCommand(fields, req, error) && engine.book(req, id, error);
+    }
+    if (command == "delete") {
+        ContractId id;
+        if (fields.size() != 2 || !parseContractId(fields[1], id)) {
+            error = "Invalid customer ID";
+            return false;
+        }
+        return engine.end(id, error);
+    }
+    if (command == "extend") {
+        ContractId id;
+        Date newReturnDate;
+        if (fields.size() != 3 || !parseContractId(fields[1], id)) {
+            error = "Invalid customer ID!";
+            return false;
+        }
+        if (!parseDate(fields[2], newReturnDate)) {
+            error = "invalid date";
+            return false;
+        }
+        return engine.extend(id, newReturnDate, error);
+    }
+    return engine.exclusive([&] { return runExclusiveBatchCommand(fields, VehicleList, CustomerList, journal, error); });
+}
+
+size_t runBatch(istream& input, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, ostream& out) {
+    string line, error;
+    vector<string> fields;
+    size_t lineNumber = 0, commands = 0, failed = 0;
+    auto start = chrono::steady_clock::now();
+    while (getline(input, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        splitFields(line, fields);
+        commands++;
+        if (!runBatchCommand(fields, engine, VehicleList, CustomerList, journal, error)) {
+            failed++;
+            out << "line " << lineNumber << ": " << error << '\n';
+        }
+        if (!engine.compactIfNeeded()) {
+            out << "line " << lineNumber << ": unable to write snapshot file\n";
+        }
+    }
+    if (!engine.exclusive([&] { return journal.sync(); })) {
+        out << "The last commands may not have reached the disk: " << journal.error() << '\n';
+        failed++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    out << "Batch finished: " << commands << " commands, " << commands - failed << " succeeded, " << failed
+         << " failed in " << seconds << " s (" << (seconds > 0 ? commands / seconds : 0) << " commands/sec)" << endl;
+    return failed;
+}
+
+void putBookingRequest(JournalEncoder& e, const BookingRequest& req) {
+    e.putString(req.name);
+    e.putString(req.address);
+    e.putString(req.phoneNumber);
+    e.putString(req.brand);
+    e.putString(req.reason);
+    e.putString(req.carType);
+    e.putString(req.licensePlate);
+    e.putDate(req.rentalDate);
+    e.putDate(req.returnDate);
+    e.putU8(req.vip ? 1 : 0);
+    e.putDouble(req.discountRate);
+}
+
+bool getBookingRequest(JournalDecoder& in, BookingRequest& req) {
+    uint8_t vip;
+    if (!in.getString(req.name) || !in.getString(req.address) || !in.getString(req.phoneNumber) || !in.getString(req.brand)
+        || !in.getString(req.reason) || !in.getString(req.carType) || !in.getString(req.licensePlate)
+        || !in.getDate(req.rentalDate) || !in.getDate(req.returnDate) || !in.getU8(vip) || !in.getDouble(req.discountRate)) {
+        return false;
+    }
+    req.vip = vip != 0;
+    return true;
+}
+
+void appendFrame(string& out, uint8_t code, const string& body) {
+    uint32_t length = static_cast<uint32_t>(body.size() + 1);
+    out.append(reinterpret_cast<const char*>(&length), 4);
+    out.push_back(static_cast<char>(code));
+    out += body;
+}
+
+uint8_t handleServerRequest(uint8_t op, JournalDecoder& in, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList,
+    Journal* journal, JournalEncoder& out) {
+    string error, filter;
+    ContractId id;
+    MaintenanceTaskId taskId;
+    uint64_t cursor;
+    auto done = [&](bool ok) {
+        if (!ok) {
+            out.putString(error);
+        }
+        return ok ? STATUS_OK : STATUS_REJECTED;
+    };
+    switch (op) {
+        case OP_BOOK: {
+            BookingRequest req;
+            if (!getBookingRequest(in, req) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            if (!engine.book(req, id, error)) {
+                return done(false);
+            }
+            out.putU32(id.slot);
+            out.putU32(id.generation);
+            return STATUS_OK;
+        }
+        case OP_END:
+            if (!in.getU32(id.slot) || !in.getU32(id.generation) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            return done(engine.end(id, error));
+        case OP_EXTEND: {
+            Date newReturnDate;
+            if (!in.getU32(id.slot) || !in.getU32(id.generation) || !in.getDate(newReturnDate) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            return done(engine.extend(id, newReturnDate, error));
+        }
+        case OP_LIST_CARS:
+        case OP_LIST_CONTRACTS: {
+            if (!in.getString(filter) || !in.getU64(cursor) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            ostringstream page;
+            size_t shown = 0;
+            size_t next = engine.exclusive([&] {
+                ReportWriter report(page);
+                if (op == OP_LIST_CARS) {
+                    RoaringBitmap matches = searchFleet(VehicleList, parseFleetQuery(VehicleList, filter));
+                    return matches.visitFrom(cursor, [&](uint32_t slot) {
+                        writeVehicle(report, VehicleList.at(slot));
+                        return ++shown < REPORT_PAGE_SIZE;
+                    });
+                }
+                return CustomerList.visitFrom(cursor, [&](const ContractId& contract, const Customer* cus) {
+                    if (!matchesFilter(filter, cus->getName(), cus->getPhoneNumber(), cus->getCar()->licensePlate())) {
+                        return true;
+                    }
+                    report << "Customer ID " << formatContractId(contract) << ":\n";
+                    cus->writeInfo(report);
+                    report << "-----------------------------------------\n";
+                    return ++shown < REPORT_PAGE_SIZE;
+                });
+            });
+            out.putString(page.str());
+            out.putU8(shown == REPORT_PAGE_SIZE ? 1 : 0); // a full page may be followed by more
+            out.putU64(next);
+            return STATUS_OK;
+        }
+        case OP_MAINT_ADD: {
+            string licensePlate, description;
+            Date dueDate;
+            if (!in.getString(licensePlate) || !in.getString(description) || !in.getDate(dueDate) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            bool ok = engine.exclusive([&] {
+                if (!scheduleMaintenance(VehicleList, licensePlate, description, dueDate, taskId, error)) {
+                    return false;
+                }
+                return !journal || journaled(*journal, journal->logScheduleMaintenance(taskId, licensePlate, description, dueDate), error);
+            });
+            if (!ok) {
+                return done(false);
+            }
+            out.putU32(taskId.slot);
+            out.putU32(taskId.generation);
+            return STATUS_OK;
+        }
+        case OP_MAINT_DONE:
+        case OP_MAINT_DELETE:
+            if (!in.getU32(taskId.slot) || !in.getU32(taskId.generation) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            return done(engine.exclusive([&] {
+                if (op == OP_MAINT_DONE) {
+                    if (!completeMaintenance(VehicleList, taskId, error)) {
+                        return false;
+                    }
+                    return !journal || journaled(*journal, journal->logCompleteMaintenance(taskId), error);
+                }
+                if (!cancelMaintenance(VehicleList, taskId, error)) {
+                    return false;
+                }
+                return !journal || journaled(*journal, journal->logCancelMaintenance(taskId), error);
+            }));
+        case OP_MAINT_DUE: {
+            // The cursor is the due day (as days after from) in its high half
+            // and the first task slot of that day in its low half
+            Date from, to;
+            if (!in.getDate(from) || !in.getDate(to) || !in.getU64(cursor) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            ostringstream page;
+            bool more = false;
+            uint64_t next = 0;
+            engine.exclusive([&] {
+                ReportWriter report(page);
+                const MaintenanceScheduler& scheduler = VehicleList.maintenance();
+                Date first(from.days + static_cast<int32_t>(cursor >> 32));
+                uint32_t firstSlot = static_cast<uint32_t>(cursor);
+                size_t shown = 0, bytes = 0;
+                for (const MaintenanceTaskId& due : scheduler.dueBetween(first, to)) {
+                    const MaintenanceTask& task = *scheduler.get(due);
+                    if (task.dueDate == first && due.slot < firstSlot) {
+                        continue;
+                    }
+                    // Stay well inside one frame, whatever the descriptions
+                    bytes += task.description.size() + 128;
+                    if (shown == REPORT_PAGE_SIZE || (shown > 0 && bytes > SERVER_MAX_FRAME / 2)) {
+                        more = true;
+                        next = (uint64_t(task.dueDate - from) << 32) | due.slot;
+                        break;
+                    }
+                    writeMaintenanceTask(report, due, task);
+                    shown++;
+                }
+            });
+            out.putString(page.str());
+            out.putU8(more ? 1 : 0);
+            out.putU64(next);
+            return STATUS_OK;
+        }
+        case OP_PRICING_RULE: {
+            string line;
+            vector<string> fields;
+            if (!in.getString(line) || !in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            splitFields(line, fields);
+            size_t recomputed = 0;
+            bool ok = fields[0] == "rule" && engine.exclusive([&] { return runPricingRuleCommand(fields, recomputed, error); });
+            if (!ok) {
+                error = error.empty() ? "not a rule command" : error;
+                return done(false);
+            }
+            out.putU64(recomputed);
+            return STATUS_OK;
+        }
+        case OP_STATS: {
+            if (!in.atEnd()) {
+                return STATUS_BAD_REQUEST;
+            }
+            ostringstream text;
+            {
+                ReportWriter report(text);
+                writeOperationStats(report);
+            }
+            out.putString(text.str());
+            return STATUS_OK;
+        }
+    }
+    return STATUS_BAD_REQUEST;
+}
+#ifndef _WIN32
+
+atomic<bool> serverStopRequested{false};
+
+void requestServerStop(int) {
+    serverStopRequested = true;
+}
+
+int listenOnUnixSocket(const string& path) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool runServer(const string& socketPath, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal* journal) {
+    int listener = listenOnUnixSocket(socketPath);
+    if (listener < 0) {
+        cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    int poller = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event watch = {};
+    watch.events = EPOLLIN;
+    watch.data.fd = listener;
+    epoll_ctl(poller, EPOLL_CTL_ADD, listener, &watch);
+
+    vector<unique_ptr<ServerConnection>> connections; // by file descriptor
+    vector<ServerConnection*> replied;               // connections with responses this round
+    vector<epoll_event> events(256);
+    char buffer[64 * 1024];
+
+    auto closeConnection = [&](ServerConnection* conn) {
+        epoll_ctl(poller, EPOLL_CTL_DEL, conn->fd, nullptr);
+        close(conn->fd);
+        connections[conn->fd].reset();
+    };
+    // Runs every complete frame received so far; false on a malformed frame
+    auto serve = [&](ServerConnection& conn) {
+        size_t before = conn.out.size();
+        while (conn.in.size() - conn.inUsed >= 5) {
+            uint32_t length;
+            memcpy(&length, conn.in.data() + conn.inUsed, 4);
+            if (length == 0 || length > SERVER_MAX_FRAME) {
+                return false;
+            }
+            if (conn.in.size() - conn.inUsed - 4 < length) {
+                break;
+            }
+            uint8_t op = static_cast<uint8_t>(conn.in[conn.inUsed + 4]);
+            JournalDecoder in(conn.in.data() + conn.inUsed + 5, length - 1);
+            JournalEncoder body;
+            uint8_t status = handleServerRequest(op, in, engine, VehicleList, CustomerList, journal, body);
+            if (conn.roundReplies++ == 0) {
+                conn.roundStart = conn.out.size();
+            }
+            appendFrame(conn.out, status, body.data());
+            conn.inUsed += 4 + length;
+        }
+        if (conn.inUsed == conn.in.size()) {
+            conn.in.clear();
+            conn.inUsed = 0;
+        }
+        if (conn.out.size() > before) {
+            replied.push_back(&conn);
+        }
+        return true;
+    };
+    // Writes what the socket takes, short of responses still waiting for the
+    // round's sync, and watches for writability while a response is left
+    // over; false if the client went away
+    auto flush = [&](ServerConnection& conn) {
+        size_t end = conn.roundReplies > 0 ? conn.roundStart : conn.out.size();
+        while (conn.outSent < end) {
+            ssize_t sent = send(conn.fd, conn.out.data() + conn.outSent, end - conn.outSent, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return false;
+                }
+                break;
+            }
+            conn.outSent += static_cast<size_t>(sent);
+        }
+        if (conn.outSent == conn.out.size()) {
+            conn.out.clear();
+            conn.outSent = 0;
+        }
+        bool pending = !conn.out.empty();
+        if (pending != conn.watchingWrites && !conn.peerClosed) {
+            epoll_event change = {};
+            change.events = EPOLLIN | (pending ? uint32_t(EPOLLOUT) : 0u);
+            change.data.fd = conn.fd;
+            epoll_ctl(poller, EPOLL_CTL_MOD, conn.fd, &change);
+            conn.watchingWrites = pending;
+        }
+        return true;
+    };
+
+    while (!serverStopRequested) {
+        int ready = epoll_wait(poller, events.data(), static_cast<int>(events.size()), SERVER_POLL_MS);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        replied.clear();
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                int client;
+                while ((client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    if (static_cast<size_t>(client) >= connections.size()) {
+                        connections.resize(client + 1);
+                    }
+                    connections[client].reset(new ServerConnection());
+                    connections[client]->fd = client;
+                    epoll_event add = {};
+                    add.events = EPOLLIN;
+                    add.data.fd = client;
+                    epoll_ctl(poller, EPOLL_CTL_ADD, client, &add);
+                }
+                continue;
+            }
+            ServerConnection* conn = connections[fd].get();
+            if (!conn) {
+                continue;
+            }
+            bool open = true;
+            if (!conn->peerClosed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                ssize_t got;
+                while ((got = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                    conn->in.append(buffer, static_cast<size_t>(got));
+                }
+                // A client that shut down its side still gets the answers
+                // to the complete requests it sent before
+                conn->peerClosed = got == 0;
+                open = (conn->peerClosed || errno == EAGAIN || errno == EWOULDBLOCK) && serve(*conn);
+                if (open && conn->peerClosed) {
+                    epoll_event change = {};
+                    change.events = EPOLLOUT;
+                    change.data.fd = fd;
+                    epoll_ctl(poller, EPOLL_CTL_MOD, fd, &change);
+                    conn->watchingWrites = true;
+                    open = !conn->out.empty();
+                }
+            }
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = flush(*conn) && !(conn->peerClosed && conn->out.empty());
+            }
+            if (!open) {
+                closeConnection(conn);
+                replied.erase(std::remove(replied.begin(), replied.end(), conn), replied.end());
+            }
+        }
+        if (journal && !replied.empty() && !engine.exclusive([&] { return journal->sync(); })) {
+            // The round's changes were made but may not be on disk, so none is confirmed
+            JournalEncoder failure;
+            failure.putString("the journal could not be flushed to disk (" + journal->error() + "); the result is not confirmed");
+            for (ServerConnection* conn : replied) {
+                conn->out.resize(conn->roundStart);
+                for (size_t reply = 0; reply < conn->roundReplies; ++reply) {
+                    appendFrame(conn->out, STATUS_REJECTED, failure.data());
+                }
+            }
+        }
+        for (ServerConnection* conn : replied) {
+            conn->roundReplies = 0;
+        }
+        for (ServerConnection* conn : replied) {
+            if (!flush(*conn) || (conn->peerClosed && conn->out.empty())) {
+                closeConnection(conn);
+            }
+        }
+        if (!engine.compactIfNeeded()) {
+            cerr << "Unable to write snapshot file." << endl;
+        }
+    }
+
+    for (auto& conn : connections) {
+        if (conn) {
+            close(conn->fd);
+        }
+    }
+    close(poller);
+    close(listener);
+    unlink(socketPath.c_str());
+    return true;
+}
+
+int runClient(const string& socketPath) {
+    ServerClient client;
+    if (!client.connect(socketPath)) {
+        cout << "Cannot connect to the server at " << socketPath << endl;
+        return 1;
+    }
+    string line, error, response;
+    vector<string> fields;
+    size_t failed = 0;
+    while (getline(cin, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        splitFields(line, fields);
+        const string& command = fields[0];
+        JournalEncoder body;
+        uint8_t op = 0, status;
+        ContractId id;
+        MaintenanceTaskId taskId;
+        Date from, to;
+        BookingRequest req;
+        error.clear();
+        if (command == "add" || command == "addvip") {
+            if (parseBookingCommand(fields, req, error)) {
+                op = OP_BOOK;
+                putBookingRequest(body, req);
+            }
+        } else if ((command == "delete" && fields.size() == 2) || (command == "extend" && fields.size() == 3)) {
+            if (!parseContractId(fields[1], id)) {
+                error = "Invalid customer ID";
+            } else if (command == "extend" && !parseDate(fields[2], to)) {
+                error = "invalid date";
+            } else {
+                op = command == "delete" ? OP_END : OP_EXTEND;
+                body.putU32(id.slot);
+                body.putU32(id.generation);
+                if (op == OP_EXTEND) {
+                    body.putDate(to);
+                }
+            }
+        } else if (command == "stats" && fields.size() == 1) {
+            op = OP_STATS;
+        } else if (command == "rule") {
+            op = OP_PRICING_RULE;
+            body.putString(line);
+        } else if ((command == "cars" || command == "customers") && fields.size() <= 2) {
+            op = command == "cars" ? OP_LIST_CARS : OP_LIST_CONTRACTS;
+        } else if (command == "maint" && fields.size() == 5 && fields[1] == "add") {
+            if (parseDate(fields[4], to)) {
+                op = OP_MAINT_ADD;
+                body.putString(fields[2]);
+                body.putString(fields[3]);
+                body.putDate(to);
+            } else {
+                error = "invalid date";
+            }
+        } else if (command == "maint" && fields.size() == 3 && (fields[1] == "done" || fields[1] == "delete")) {
+            if (parseTaskId(fields[2], taskId)) {
+                op = fields[1] == "done" ? OP_MAINT_DONE : OP_MAINT_DELETE;
+                body.putU32(taskId.slot);
+                body.putU32(taskId.generation);
+            } else {
+                error = "Invalid maintenance task ID";
+            }
+        } else if (command == "maint" && fields.size() == 4 && fields[1] == "due") {
+            if (parseDate(fields[2], from) && parseDate(fields[3], to)) {
+                op = OP_MAINT_DUE;
+            } else {
+                error = "invalid date";
+            }
+        } else {
+            error = "unknown command '" + line + "'";
+        }
+        if (op == 0) {
+            cout << error << endl;
+            failed++;
+            continue;
+        }
+
+        // Listings are fetched a page at a time until the server has no more
+        uint64_t cursor = 0;
+        bool more = true, shownAny = false;
+        while (more) {
+            more = false;
+            if (op == OP_LIST_CARS || op == OP_LIST_CONTRACTS) {
+                body = JournalEncoder();
+                body.putString(fields.size() == 2 ? fields[1] : "");
+                body.putU64(cursor);
+            } else if (op == OP_MAINT_DUE) {
+                body = JournalEncoder();
+                body.putDate(from);
+                body.putDate(to);
+                body.putU64(cursor);
+            }
+            if (!client.call(op, body, status, response)) {
+                cout << "Lost the connection to the server." << endl;
+                return 1;
+            }
+            JournalDecoder in(response.data(), response.size());
+            string text;
+            if (status == STATUS_REJECTED) {
+                in.getString(text);
+                cout << text << endl;
+                failed++;
+            } else if (status != STATUS_OK) {
+                cout << "The server did not understand the request." << endl;
+                failed++;
+            } else if (op == OP_BOOK || op == OP_MAINT_ADD) {
+                uint32_t slot = 0, generation = 0;
+                in.getU32(slot);
+                in.getU32(generation);
+                if (op == OP_BOOK) {
+                    cout << "Booked, customer ID " << formatContractId(ContractId{slot, generation}) << endl;
+                } else {
+                    cout << "Maintenance " << formatTaskId(MaintenanceTaskId{slot, generation}) << " added" << endl;
+                }
+            } else if (op == OP_LIST_CARS || op == OP_LIST_CONTRACTS || op == OP_MAINT_DUE) {
+                uint8_t hasMore = 0;
+                in.getString(text);
+                in.getU8(hasMore);
+                in.getU64(cursor);
+                cout << (op == OP_MAINT_DUE && text.empty() && !hasMore && !shownAny ? "No maintenance due.\n" : text);
+                shownAny = shownAny || !text.empty();
+                more = hasMore != 0;
+            } else if (op == OP_STATS) {
+                in.getString(text);
+                cout << text;
+            } else if (op == OP_PRICING_RULE) {
+                uint64_t recomputed = 0;
+                in.getU64(recomputed);
+                cout << "Pricing rules changed, " << recomputed << " day prices recomputed" << endl;
+            } else {
+                cout << "OK" << endl;
+            }
+        }
+    }
+    return failed == 0 ? 0 : 2;
+}
+#endif
+
+string syntheticPlate(size_t index) {
+    char plate[16];
+    snprintf(plate, sizeof(plate), "%02u%c-%05u", static_cast<unsigned>(11 + index / 2600000), static_cast<char>('A' + index / 100000 % 26),
+        static_cast<unsigned>(index % 100000));
+    return plate;
+}
+
+void generateFleet(FleetRegistry& fleet, const SyntheticConfig& config, vector<string>* plates) {
+    static const char* const brands[] = {"Toyota", "Honda", "Ford", "Chevrolet", "Hyundai", "Kia", "Mazda", "VinFast"};
+    static const char* const colors[] = {"Red", "Blue", "Black", "White", "Silver", "Grey"};
+    static const char* const conditions[] = {"Good", "Good", "Good", "Fair", "New"};
+    SyntheticRandom random(config.seed);
+    fleet.reserve(fleet.size() + config.cars);
+    for (size_t i = 0; i < config.cars; ++i) {
+        string plate = syntheticPlate(i);
+        CarTypeId type = (i * 2654435761u >> 8) % 10 < 7 ? CAR_4_SEATER : CAR_7_SEATER; // ~70% 4-seaters
+        fleet.addVehicle(Vehicle(plate, brands[random.below(8)], colors[random.below(6)], conditions[random.below(5)], type));
+        if (plates) {
+            plates->push_back(std::move(plate));
+        }
+    }
+}
+
+size_t generateContracts(FleetRegistry& fleet, ContractStore& contracts, const SyntheticConfig& config, vector<ContractId>* ids) {
+    static const char* const firstNames[] = {"An", "Binh", "Chi", "Dung", "Giang", "Hoa", "Khanh", "Linh", "Minh", "Nam", "Phuong", "Quang"};
+    static const char* const lastNames[] = {"Nguyen", "Tran", "Le", "Pham", "Hoang", "Vo", "Dang", "Bui"};
+    static const char* const streets[] = {"Nguyen Luong Bang", "Le Duan", "Tran Phu", "Bach Dang", "Hung Vuong"};
+    static const char* const reasons[] = {"Business", "Holiday", "Family visit", "Wedding", "Airport transfer"};
+    if (config.cars == 0) {
+        return 0;
+    }
+    SyntheticRandom random(config.seed ^ 0x5eedULL);
+    int32_t firstDay = Date::fromYMD(config.year, 1, 1).days;
+    vector<int32_t> nextFreeDay(config.cars);
+    for (int32_t& day : nextFreeDay) {
+        day = firstDay + static_cast<int32_t>(random.below(30));
+    }
+    contracts.reserve(contracts.size() + config.contracts);
+    BookingRequest req;
+    string error;
+    size_t booked = 0;
+    for (size_t k = 0; k < config.contracts; ++k) {
+        size_t car = k % config.cars;
+        const Vehicle* vehicle = fleet.find(syntheticPlate(car));
+        if (!vehicle) {
+            continue;
+        }
+        req.name = string(lastNames[random.below(8)]) + " " + firstNames[random.below(12)];
+        req.address = to_string(1 + random.below(300)) + " " + streets[random.below(5)];
+        req.phoneNumber = "09" + to_string(10000000 + k * 7919 % 90000000); // distinct for every contract
+        req.brand = vehicle->brand;
+        req.reason = reasons[random.below(5)];
+        req.carType = carTypes().get(vehicle->carType).name;
+        req.licensePlate = vehicle->licensePlate();
+        // Mostly short rentals with a tail of long ones
+        int32_t days = random.below(10) == 0 ? 7 + static_cast<int32_t>(random.below(24)) : 1 + static_cast<int32_t>(random.below(4));
+        req.rentalDate = Date(nextFreeDay[car] + static_cast<int32_t>(random.below(5)));
+        req.returnDate = Date(req.rentalDate.days + days);
+        nextFreeDay[car] = req.returnDate.days;
+        req.vip = random.below(100) < config.vipPercent;
+        req.discountRate = req.vip ? 0.05 * (1 + random.below(4)) : 0;
+        ContractId id;
+        if (bookCustomer(fleet, contracts, req, id, error)) {
+            booked++;
+            if (ids) {
+                ids->push_back(id);
+            }
+        }
+    }
+    return booked;
+}
+
+size_t generateMaintenance(FleetRegistry& fleet, const SyntheticConfig& config) {
+    static const char* const tasks[] = {"Oil change", "Tire rotation", "Brake inspection", "Battery check", "Air filter", "Wheel alignment"};
+    SyntheticRandom random(config.seed ^ 0xfeedULL);
+    int32_t firstDay = Date::fromYMD(config.year, 1, 1).days;
+    fleet.maintenance().reserve(fleet.maintenance().size() + config.cars * config.tasksPerCar);
+    MaintenanceTaskId id;
+    string error;
+    size_t scheduled = 0;
+    for (size_t car = 0; car < config.cars; ++car) {
+        string plate = syntheticPlate(car);
+        for (size_t t = 0; t < config.tasksPerCar; ++t) {
+            Date due(firstDay + static_cast<int32_t>(random.below(365)));
+            if (scheduleMaintenance(fleet, plate, tasks[random.below(6)], due, id, error)) {
+                scheduled++;
+            }
+        }
+    }
+    return scheduled;
+}
@@ -0,0 +1,5209 @@
+// Core of the car rental contract manager: dates, fleet, contracts,
+// maintenance, billing, journal, snapshots, rental history, the reservation
+// engine and server mode. Shared by the program and the benchmark suite.
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ctime> // For handling dates
+#include <fstream> // For file handling
+#include <limits> // For numeric limits
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <tuple>
+#include <array>
+#include <memory>
+#include <cctype>
+#include <chrono> // For benchmarks
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <unordered_map>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <atomic>
+#ifndef _WIN32
+#include <fcntl.h> // For memory-mapped snapshots
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h> // For server mode
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#else
+#include <io.h> // For the journal file
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+// fsync, which Windows calls _commit
+inline int syncFile(int fd) {
+#ifdef _WIN32
+    return _commit(fd);
+#else
+    return fsync(fd);
+#endif
+}
+
+// Calendar date stored as a day number (days since 1/1/1970) in 32 bits.
+// Day differences are plain subtraction, independent of time zone and DST.
+// Conversions use the days-from-civil / civil-from-days algorithms.
+struct Date {
+    int32_t days = 0;
+
+    constexpr Date() = default;
+    constexpr explicit Date(int32_t dayNumber) : days(dayNumber) {}
+
+    // Out-of-range days roll over into the next month, like mktime
+    static constexpr Date fromYMD(int year, int month, int day) {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        int yoe = year - era * 400;
+        int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return Date(era * 146097 + doe - 719468);
+    }
+
+    static constexpr bool isLeapYear(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    static constexpr int daysInMonth(int year, int month) {
+        return month == 2 ? (isLeapYear(year) ? 29 : 28) : (month == 4 || month == 6 || month == 9 || month == 11) ? 30 : 31;
+    }
+
+    // True when the day exists in that month; fromYMD itself rolls over
+    static constexpr bool isValid(int year, int month, int day) {
+        return month >= 1 && month <= 12 && day >= 1 && day <= daysInMonth(year, month);
+    }
+
+    constexpr void toYMD(int& year, int& month, int& day) const {
+        int z = days + 719468;
+        int era = (z >= 0 ? z : z - 146096) / 146097;
+        int doe = z - era * 146097;
+        int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int mp = (5 * doy + 2) / 153;
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = yoe + era * 400 + (month <= 2);
+    }
+
+    constexpr int year() const { int y = 0, m = 0, d = 0; toYMD(y, m, d); return y; }
+    constexpr int month() const { int y = 0, m = 0, d = 0; toYMD(y, m, d); return m; }
+    constexpr int day() const { int y = 0, m = 0, d = 0; toYMD(y, m, d); return d; }
+
+    constexpr bool operator==(const Date& other) const { return days == other.days; }
+    constexpr bool operator!=(const Date& other) const { return days != other.days; }
+    constexpr bool operator<(const Date& other) const { return days < other.days; }
+    constexpr bool operator<=(const Date& other) const { return days <= other.days; }
+};
+
+static_assert(sizeof(Date) == 4, "Date must stay 32 bits");
+static_assert(Date::fromYMD(1970, 1, 1).days == 0, "epoch");
+static_assert(Date::fromYMD(2024, 3, 1).days - Date::fromYMD(2024, 2, 28).days == 2, "leap year");
+static_assert(Date::isValid(2024, 2, 29) && !Date::isValid(2025, 2, 29) && !Date::isValid(2025, 2, 31), "month length");
+static_assert(Date::fromYMD(2025, 12, 31).day() == 31 && Date::fromYMD(2025, 12, 31).month() == 12, "round trip");
+
+// Number of days from 'from' to 'to'
+constexpr int32_t operator-(const Date& to, const Date& from) { return to.days - from.days; }
+
+// Prints d/m/yyyy, the format used on every screen and in the archive
+std::ostream& operator<<(std::ostream& out, const Date& date);
+
+// Formats listings into one reusable buffer and hands it to the stream in
+// large chunks, instead of flushing every line with endl. Output reaches the
+// stream when the buffer fills, on flush() and on destruction; flush before
+// prompting the user. Numbers are formatted as cout formats them by default.
+class ReportWriter {
+private:
+    static const size_t FLUSH_BYTES = 64 * 1024;
+
+    std::ostream& out;
+    std::string buffer;
+
+    void flushIfFull() {
+        if (buffer.size() >= FLUSH_BYTES) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    template <typename Int>
+    ReportWriter& putInteger(Int value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        flushIfFull();
+        return *this;
+    }
+
+public:
+    explicit ReportWriter(std::ostream& out) : out(out) { buffer.reserve(FLUSH_BYTES + 4096); }
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    ReportWriter& operator<<(const std::string& text) { buffer += text; flushIfFull(); return *this; }
+    ReportWriter& operator<<(const char* text) { buffer += text; flushIfFull(); return *this; }
+    ReportWriter& operator<<(char c) { buffer += c; flushIfFull(); return *this; }
+    ReportWriter& operator<<(int value) { return putInteger(value); }
+    ReportWriter& operator<<(long value) { return putInteger(value); }
+    ReportWriter& operator<<(long long value) { return putInteger(value); }
+    ReportWriter& operator<<(unsigned value) { return putInteger(value); }
+    ReportWriter& operator<<(unsigned long value) { return putInteger(value); }
+    ReportWriter& operator<<(unsigned long long value) { return putInteger(value); }
+
+    ReportWriter& operator<<(double value) {
+        char digits[32];
+        int length = snprintf(digits, sizeof(digits), "%g", value);
+        buffer.append(digits, length);
+        flushIfFull();
+        return *this;
+    }
+
+    ReportWriter& operator<<(const Date& date) {
+        int y, m, d;
+        date.toYMD(y, m, d);
+        return *this << d << '/' << m << '/' << y;
+    }
+
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+        out.flush();
+    }
+
+    ~ReportWriter() { flush(); }
+};
+
+// Operation statistics: a call count and a latency histogram per operation,
+// for the menu commands and the internal hot paths. Each thread records into
+// its own counters with plain relaxed stores, so recording takes no lock and
+// no atomic read-modify-write; a report sums every thread's counters.
+// Histogram buckets are log-linear: exact below 16 ns, then four buckets per
+// power of two, so a reported percentile is within 25% of the true value.
+// Operations called millions of times per second are timed on a sample of
+// calls (their count stays exact); the rest are timed on every call.
+enum StatOperation {
+    STAT_MENU_ADD_CUSTOMER,     // menu commands, in menu order
+    STAT_MENU_ADD_VIP,
+    STAT_MENU_DELETE_CUSTOMER,
+    STAT_MENU_LIST_CUSTOMERS,
+    STAT_MENU_LIST_CARS,
+    STAT_MENU_ADD_MAINTENANCE,
+    STAT_MENU_DELETE_MAINTENANCE,
+    STAT_MENU_LIST_MAINTENANCE,
+    STAT_MENU_EXTEND,
+    STAT_MENU_CHANGE_INFO,
+    STAT_MENU_SAVE_SNAPSHOT,
+    STAT_MENU_BILL_ALL,
+    STAT_MENU_FIND_PHONE,
+    STAT_MENU_FIND_ID,
+    STAT_MENU_HISTORY,
+    STAT_MENU_COMPLETE_MAINTENANCE,
+    STAT_MENU_MAINTENANCE_DUE,
+    STAT_MENU_STATISTICS,
+    STAT_MENU_REVENUE_CUBE,
+    STAT_MENU_MEMORY,
+    STAT_MENU_PRICING_RULES,
+    STAT_FIND_CAR,              // internal hot paths
+    STAT_ASSIGN_CAR,
+    STAT_RENTAL_COST,
+    STAT_BOOK,
+    STAT_END_RENTAL,
+    STAT_EXTEND_RENTAL,
+    STAT_ARCHIVE_SUBMIT,
+    STAT_ARCHIVE_WRITE,
+    STAT_ARCHIVE_SYNC,
+    STAT_OPERATION_COUNT
+};
+
+const size_t STAT_MENU_COMMANDS = STAT_MENU_PRICING_RULES + 1; // menu choices 1..STAT_MENU_COMMANDS
+const size_t STAT_BUCKETS = 16 + 60 * 4;
+
+struct StatOperationInfo {
+    const char* name;
+    uint32_t sampleEvery; // time one call in this many (a power of two)
+};
+
+const StatOperationInfo STAT_OPERATIONS[STAT_OPERATION_COUNT] = {
+    {"menu: add customer", 1}, {"menu: add VIP customer", 1}, {"menu: delete customer", 1}, {"menu: customer list", 1},
+    {"menu: car list", 1}, {"menu: add maintenance", 1}, {"menu: delete maintenance", 1}, {"menu: maintenance list", 1},
+    {"menu: extend rental", 1}, {"menu: change customer info", 1}, {"menu: save snapshot", 1}, {"menu: bill all contracts", 1},
+    {"menu: find by phone", 1}, {"menu: find by ID", 1}, {"menu: rental history", 1}, {"menu: complete maintenance", 1},
+    {"menu: maintenance due", 1}, {"menu: statistics", 1}, {"menu: revenue cube", 1}, {"menu: memory footprint", 1},
+    {"menu: pricing rules", 1},
+    {"find car", 64}, {"assign free car", 64}, {"rental cost", 64}, {"book", 8}, {"end rental", 8}, {"extend rental", 8},
+    {"archive submit", 8}, {"archive write", 1}, {"archive sync", 1}};
+
+// One thread's counters. Only the owning thread writes them.
+struct ThreadStats {
+    std::atomic<uint64_t> calls[STAT_OPERATION_COUNT];
+    std::atomic<uint64_t> maxNs[STAT_OPERATION_COUNT];
+    std::atomic<uint64_t> buckets[STAT_OPERATION_COUNT][STAT_BUCKETS];
+    uint64_t inputWaitNs = 0; // time spent blocked on the operator, see InputWaitBuffer
+
+    ThreadStats() {
+        for (size_t op = 0; op < STAT_OPERATION_COUNT; ++op) {
+            calls[op].store(0, std::memory_order_relaxed);
+            maxNs[op].store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& bucket : buckets[op]) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void bump(std::atomic<uint64_t>& counter) { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+};
+
+inline int popcount64(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Index of the lowest set bit; word must not be zero
+inline int lowestBit64(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Index of the highest set bit; word must not be zero
+inline int highestBit64(uint64_t word) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    int bit = 63;
+    while (!(word >> bit)) {
+        bit--;
+    }
+    return bit;
+#endif
+}
+
+inline size_t latencyBucket(uint64_t ns) {
+    if (ns < 16) {
+        return static_cast<size_t>(ns);
+    }
+    int octave = highestBit64(ns); // 4..63
+    return 16 + (octave - 4) * 4 + ((ns >> (octave - 2)) & 3);
+}
+
+// Smallest latency that falls in a bucket
+inline uint64_t latencyBucketStart(size_t bucket) {
+    if (bucket < 16) {
+        return bucket;
+    }
+    int octave = static_cast<int>((bucket - 16) / 4) + 4;
+    return (uint64_t(4) + (bucket - 16) % 4) << (octave - 2);
+}
+
+// Hands out per-thread counters. A thread's counters are returned to a free
+// list when it exits and reused by the next new thread, so totals survive
+// short-lived threads without growing memory.
+class StatsRegistry {
+private:
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadStats>> all;
+    std::vector<ThreadStats*> unused;
+
+    struct Owner {
+        ThreadStats* stats = nullptr;
+        ~Owner() {
+            if (stats) {
+                StatsRegistry& registry = StatsRegistry::instance();
+                std::lock_guard<std::mutex> guard(registry.lock);
+                registry.unused.push_back(stats);
+            }
+        }
+    };
+
+    ThreadStats* acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!unused.empty()) {
+            ThreadStats* stats = unused.back();
+            unused.pop_back();
+            return stats;
+        }
+        all.emplace_back(new ThreadStats());
+        return all.back().get();
+    }
+
+public:
+    static StatsRegistry& instance() {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    // The calling thread's counters
+    static ThreadStats& local() {
+        thread_local Owner owner;
+        if (!owner.stats) {
+            owner.stats = instance().acquire();
+        }
+        return *owner.stats;
+    }
+
+    // Sums every thread's counters for one operation
+    void collect(size_t op, uint64_t& calls, uint64_t& maxNs, std::vector<uint64_t>& buckets) {
+        std::lock_guard<std::mutex> guard(lock);
+        calls = 0;
+        maxNs = 0;
+        buckets.assign(STAT_BUCKETS, 0);
+        for (const auto& stats : all) {
+            calls += stats->calls[op].load(std::memory_order_relaxed);
+            maxNs = std::max(maxNs, stats->maxNs[op].load(std::memory_order_relaxed));
+            for (size_t b = 0; b < STAT_BUCKETS; ++b) {
+                buckets[b] += stats->buckets[op][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Counts one call of an operation and, on sampled calls, records how long
+// the object lived. Time the thread spent waiting for operator input is not
+// counted, so menu commands report their own work.
+class OperationTimer {
+private:
+    ThreadStats& stats;
+    StatOperation op;
+    bool timed;
+    std::chrono::steady_clock::time_point start;
+    uint64_t inputWaitAtStart = 0;
+
+public:
+    explicit OperationTimer(StatOperation op) : stats(StatsRegistry::local()), op(op) {
+        uint64_t calls = stats.calls[op].load(std::memory_order_relaxed);
+        stats.calls[op].store(calls + 1, std::memory_order_relaxed);
+        timed = (calls & (STAT_OPERATIONS[op].sampleEvery - 1)) == 0;
+        if (timed) {
+            inputWaitAtStart = stats.inputWaitNs;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+    ~OperationTimer() {
+        if (!timed) {
+            return;
+        }
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0, elapsed - static_cast<int64_t>(stats.inputWaitNs - inputWaitAtStart)));
+        ThreadStats::bump(stats.buckets[op][latencyBucket(ns)]);
+        if (ns > stats.maxNs[op].load(std::memory_order_relaxed)) {
+            stats.maxNs[op].store(ns, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Sits between cin and its buffer and adds the time spent blocked on the
+// terminal to the thread's inputWaitNs
+class InputWaitBuffer : public std::streambuf {
+private:
+    std::streambuf* source;
+
+    template <typename Read>
+    int timedRead(Read read) {
+        if (source->in_avail() > 0) {
+            return read();
+        }
+        auto start = std::chrono::steady_clock::now();
+        int c = read();
+        StatsRegistry::local().inputWaitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return c;
+    }
+
+protected:
+    int underflow() override { return timedRead([&] { return source->sgetc(); }); }
+    int uflow() override { return timedRead([&] { return source->sbumpc(); }); }
+    int pbackfail(int c) override { return c == traits_type::eof() ? source->sungetc() : source->sputbackc(traits_type::to_char_type(c)); }
+
+public:
+    explicit InputWaitBuffer(std::streambuf* source) : source(source) {}
+};
+
+// Latency with a unit that keeps three significant digits readable
+std::string formatLatency(uint64_t ns);
+
+// Table of count, p50, p99, p99.9 and max for every operation called so far
+void writeOperationStats(ReportWriter& report);
+
+struct Vehicle;
+
+// Maintenance tasks are identified by their slot in the fleet's scheduler and
+// that slot's generation, which changes whenever a task is removed
+struct MaintenanceTaskId {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+
+    bool operator==(const MaintenanceTaskId& other) const { return slot == other.slot && generation == other.generation; }
+};
+
+// Define structure for maintenance tasks
+struct MaintenanceTask {
+    std::string description;
+    Date dueDate;
+    bool completed;
+    Vehicle* vehicle = nullptr; // the car the task belongs to
+
+    MaintenanceTask(std::string desc, Date due) : description(desc), dueDate(due), completed(false) {}
+};
+
+// Reservation calendar of one vehicle: disjoint [from, to) day ranges ordered
+// by their first day, so every query touches O(log k) bookings
+class ReservationCalendar {
+private:
+    std::map<int32_t, int32_t> bookings; // first day -> day after the last one
+
+public:
+    // True if no booking overlaps [from, to)
+    bool isFree(int32_t from, int32_t to) const {
+        auto next = bookings.lower_bound(to); // first booking starting at or after 'to'
+        if (next == bookings.begin()) {
+            return true;
+        }
+        --next; // last booking starting before 'to', the only one that can overlap
+        return next->second <= from;
+    }
+
+    bool reserve(int32_t from, int32_t to) {
+        if (from >= to || !isFree(from, to)) {
+            return false;
+        }
+        bookings.emplace(from, to);
+        return true;
+    }
+
+    bool release(int32_t from) { return bookings.erase(from) > 0; }
+
+    // Moves the end of the booking that starts on 'from', unless it would
+    // run into the next booking
+    bool changeEnd(int32_t from, int32_t newTo) {
+        auto it = bookings.find(from);
+        if (it == bookings.end() || newTo <= from) {
+            return false;
+        }
+        auto next = std::next(it);
+        if (next != bookings.end() && next->first < newTo) {
+            return false;
+        }
+        it->second = newTo;
+        return true;
+    }
+
+    bool empty() const { return bookings.empty(); }
+    size_t size() const { return bookings.size(); }
+};
+
+// Interned text. Attributes that repeat across millions of records (a
+// vehicle's brand, color and condition, the brand a customer asked for) are
+// stored as a 4-byte symbol naming one shared copy of the text, so equal
+// values compare by id. Texts are never freed. They live in blocks that
+// double in size and never move, so text() takes no lock: a symbol can only
+// be read after intern() has returned it.
+typedef uint32_t Symbol;
+
+class SymbolTable {
+private:
+    static const unsigned FIRST_BLOCK_BITS = 6; // block k holds 64 << k texts
+
+    std::unique_ptr<std::string[]> blocks[32 - FIRST_BLOCK_BITS];
+    Symbol count = 0;
+    std::unordered_map<std::string_view, Symbol> ids; // views of the stored texts
+    mutable std::shared_mutex lock;
+
+    static void locate(Symbol symbol, unsigned& block, size_t& offset) {
+        uint64_t position = uint64_t(symbol) + (uint64_t(1) << FIRST_BLOCK_BITS);
+        unsigned width = static_cast<unsigned>(highestBit64(position));
+        block = width - FIRST_BLOCK_BITS;
+        offset = static_cast<size_t>(position - (uint64_t(1) << width));
+    }
+
+public:
+    Symbol intern(std::string_view text) {
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            auto found = ids.find(text);
+            if (found != ids.end()) {
+                return found->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> guard(lock);
+        auto found = ids.find(text);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        Symbol symbol = count++;
+        unsigned block;
+        size_t offset;
+        locate(symbol, block, offset);
+        if (!blocks[block]) {
+            blocks[block].reset(new std::string[size_t(1) << (block + FIRST_BLOCK_BITS)]);
+        }
+        std::string& stored = blocks[block][offset];
+        stored.assign(text.data(), text.size());
+        ids.emplace(std::string_view(stored), symbol);
+        return symbol;
+    }
+
+    // Finds the symbol of a text without interning it
+    bool lookup(std::string_view text, Symbol& symbol) const {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        auto found = ids.find(text);
+        if (found == ids.end()) {
+            return false;
+        }
+        symbol = found->second;
+        return true;
+    }
+
+    const std::string& text(Symbol symbol) const {
+        unsigned block;
+        size_t offset;
+        locate(symbol, block, offset);
+        return blocks[block][offset];
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        return count;
+    }
+
+    // Texts, their blocks and the lookup table
+    size_t memoryBytes() const {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        size_t bytes = sizeof(*this) + ids.bucket_count() * sizeof(void*) + ids.size() * (sizeof(std::pair<std::string_view, Symbol>) + sizeof(void*));
+        for (unsigned block = 0; block < 32 - FIRST_BLOCK_BITS && blocks[block]; ++block) {
+            bytes += (size_t(1) << (block + FIRST_BLOCK_BITS)) * sizeof(std::string);
+        }
+        for (Symbol symbol = 0; symbol < count; ++symbol) {
+            const std::string& stored = text(symbol);
+            bytes += stored.capacity() > 15 ? stored.capacity() + 1 : 0; // longer than the inline buffer
+        }
+        return bytes;
+    }
+};
+
+SymbolTable& symbols();
+
+// Define structure for vehicle
+// Car types are shared, immutable flyweights: a contract or a vehicle keeps
+// only the small id of its type, and the name and rate are looked up in the
+// registry.
+typedef uint8_t CarTypeId;
+
+const CarTypeId CAR_4_SEATER = 0; // ids of BUILTIN_CAR_TYPES, in order
+const CarTypeId CAR_7_SEATER = 1;
+
+// License plate packed into a fixed 16-byte key (zero padded), so the index
+// compares two integers instead of two strings
+struct PlateKey {
+    uint64_t lo;
+    uint64_t hi;
+
+    bool operator==(const PlateKey& other) const { return lo == other.lo && hi == other.hi; }
+};
+
+const size_t MAX_PLATE_LENGTH = 16;
+
+// Returns false if the plate is empty or too long to be packed
+bool packPlate(std::string_view plate, PlateKey& key);
+
+// Text of a packed plate
+std::string unpackPlate(const PlateKey& key);
+
+uint64_t hashPlate(const PlateKey& key);
+
+class FleetIndex;
+
+// A vehicle's record: its descriptive fields, maintenance task list and
+// bookings. What fleet-wide scans read (whether the car is in service and
+// free, and its type) is kept per slot in the fleet's FleetIndex instead, so
+// they do not pull the records through the cache.
+struct Vehicle {
+    PlateKey plate;   // packed; all zero if the plate could not be packed
+    Symbol brand;     // interned, see symbols(); brandText() etc. give the text
+    Symbol color;
+    Symbol condition;
+    CarTypeId carType;
+    uint32_t slot = 0;                    // set by the fleet that holds the car
+    FleetIndex* attributeIndex = nullptr; // that fleet's slot data and search index
+    std::vector<MaintenanceTaskId> maintenanceTasks; // tasks in the fleet's scheduler, in the order added
+    ReservationCalendar reservations;
+
+    Vehicle(std::string_view lp, std::string_view b, std::string_view c, std::string_view cond, CarTypeId type = CAR_4_SEATER)
+        : plate{0, 0}, brand(symbols().intern(b)), color(symbols().intern(c)), condition(symbols().intern(cond)), carType(type) {
+        if (!packPlate(lp, plate)) {
+            plate = PlateKey{0, 0};
+        }
+    }
+
+    std::string licensePlate() const { return unpackPlate(plate); }
+    const std::string& brandText() const { return symbols().text(brand); }
+    const std::string& colorText() const { return symbols().text(color); }
+    const std::string& conditionText() const { return symbols().text(condition); }
+
+    // False while the car has any booking; a car outside a fleet is free
+    // while its calendar is empty
+    bool isAvailable() const;
+
+    // Updates the fleet's slot data and availability bitmap
+    void setAvailable(bool av);
+
+    // Calendar changes that also keep the fleet's day free sets current:
+    // book [from, to), drop the booking [from, to), move a booking's end
+    bool reserve(int32_t from, int32_t to);
+    void release(int32_t from, int32_t to);
+    bool changeEnd(int32_t from, int32_t oldTo, int32_t newTo);
+};
+
+// Fleet-wide maintenance calendar. Tasks live in slots addressed by a stable
+// ID (slot + generation, as for contracts), so completion and removal find
+// their task in O(1). Pending tasks are also filed in a calendar queue: one
+// bucket of slots per due day, with the days kept in order. Each task
+// remembers its place in its bucket, so taking it out is a swap with the
+// bucket's last entry, and a due-window query reads only the buckets of the
+// days in the window.
+class MaintenanceScheduler {
+private:
+    static constexpr uint32_t NOT_LIVE = 0xFFFFFFFF;
+    static constexpr uint32_t NOT_QUEUED = 0xFFFFFFFE; // live but completed
+
+    std::vector<MaintenanceTask> tasks;    // per slot
+    std::vector<uint32_t> generations;     // per slot
+    std::vector<uint32_t> bucketPosition;  // per slot: index in its due day's bucket, NOT_QUEUED or NOT_LIVE
+    std::vector<uint32_t> freeSlots;       // may hold slots taken since by addAt; skipped on reuse
+    std::map<int32_t, std::vector<uint32_t>> calendar; // due day -> pending slots; no empty buckets
+    size_t liveCount = 0;
+    size_t pendingCount = 0;
+
+    void enqueue(uint32_t slot) {
+        std::vector<uint32_t>& bucket = calendar[tasks[slot].dueDate.days];
+        bucketPosition[slot] = static_cast<uint32_t>(bucket.size());
+        bucket.push_back(slot);
+        pendingCount++;
+    }
+
+    void unqueue(uint32_t slot) {
+        auto day = calendar.find(tasks[slot].dueDate.days);
+        std::vector<uint32_t>& bucket = day->second;
+        uint32_t pos = bucketPosition[slot];
+        bucket[pos] = bucket.back();
+        bucketPosition[bucket[pos]] = pos;
+        bucket.pop_back();
+        if (bucket.empty()) {
+            calendar.erase(day);
+        }
+        bucketPosition[slot] = NOT_QUEUED;
+        pendingCount--;
+    }
+
+    // Makes sure slots [0, count) exist; new slots start free at generation 0
+    void growTo(size_t count) {
+        size_t old = generations.size();
+        if (count <= old) {
+            return;
+        }
+        tasks.resize(count, MaintenanceTask("", Date()));
+        generations.resize(count, 0);
+        bucketPosition.resize(count, NOT_LIVE);
+        for (size_t slot = count; slot > old; --slot) {
+            freeSlots.push_back(static_cast<uint32_t>(slot - 1)); // lowest slot is reused first
+        }
+    }
+
+    uint32_t takeFreeSlot() {
+        while (!freeSlots.empty()) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            if (bucketPosition[slot] == NOT_LIVE) {
+                return slot;
+            }
+        }
+        size_t slot = generations.size();
+        growTo(slot + 1);
+        freeSlots.pop_back(); // that is 'slot' itself
+        return static_cast<uint32_t>(slot);
+    }
+
+    void fill(uint32_t slot, Vehicle* car, std::string description, Date dueDate, bool completed) {
+        MaintenanceTask& task = tasks[slot];
+        task.description = std::move(description);
+        task.dueDate = dueDate;
+        task.completed = completed;
+        task.vehicle = car;
+        car->maintenanceTasks.push_back(MaintenanceTaskId{slot, generations[slot]});
+        liveCount++;
+        if (completed) {
+            bucketPosition[slot] = NOT_QUEUED;
+        } else {
+            enqueue(slot);
+        }
+    }
+
+    bool isLive(const MaintenanceTaskId& id) const {
+        return id.slot < generations.size() && bucketPosition[id.slot] != NOT_LIVE && generations[id.slot] == id.generation;
+    }
+
+public:
+    // Schedules a task for car and returns its ID
+    MaintenanceTaskId add(Vehicle* car, std::string description, Date dueDate, bool completed = false) {
+        uint32_t slot = takeFreeSlot();
+        fill(slot, car, std::move(description), dueDate, completed);
+        return MaintenanceTaskId{slot, generations[slot]};
+    }
+
+    // Schedules a task under a known ID (snapshot load and journal replay);
+    // fails if that slot is taken or has moved on to another generation
+    bool addAt(const MaintenanceTaskId& id, Vehicle* car, std::string description, Date dueDate, bool completed = false) {
+        growTo(static_cast<size_t>(id.slot) + 1);
+        if (bucketPosition[id.slot] != NOT_LIVE || generations[id.slot] != id.generation) {
+            return false;
+        }
+        fill(id.slot, car, std::move(description), dueDate, completed);
+        return true;
+    }
+
+    const MaintenanceTask* get(const MaintenanceTaskId& id) const {
+        return isLive(id) ? &tasks[id.slot] : nullptr;
+    }
+
+    // Marks a pending task done; it stays on its car's schedule until removed
+    bool complete(const MaintenanceTaskId& id) {
+        if (!isLive(id) || tasks[id.slot].completed) {
+            return false;
+        }
+        unqueue(id.slot);
+        tasks[id.slot].completed = true;
+        return true;
+    }
+
+    // Drops a task from its car's schedule and retires the ID
+    bool remove(const MaintenanceTaskId& id) {
+        if (!isLive(id)) {
+            return false;
+        }
+        MaintenanceTask& task = tasks[id.slot];
+        if (!task.completed) {
+            unqueue(id.slot);
+        }
+        std::vector<MaintenanceTaskId>& own = task.vehicle->maintenanceTasks;
+        own.erase(std::find(own.begin(), own.end(), id));
+        std::string().swap(task.description);
+        task.vehicle = nullptr;
+        bucketPosition[id.slot] = NOT_LIVE;
+        generations[id.slot]++;
+        freeSlots.push_back(id.slot);
+        liveCount--;
+        return true;
+    }
+
+    // Removes every task of a car leaving the fleet
+    void removeAll(Vehicle& car) {
+        while (!car.maintenanceTasks.empty()) {
+            remove(car.maintenanceTasks.back());
+        }
+    }
+
+    // Pending tasks due in [from, to], ordered by due date (then by slot)
+    std::vector<MaintenanceTaskId> dueBetween(Date from, Date to) const {
+        std::vector<MaintenanceTaskId> ids;
+        for (auto day = calendar.lower_bound(from.days); day != calendar.end() && day->first <= to.days; ++day) {
+            size_t first = ids.size();
+            for (uint32_t slot : day->second) {
+                ids.push_back(MaintenanceTaskId{slot, generations[slot]});
+            }
+            std::sort(ids.begin() + first, ids.end(), [](const MaintenanceTaskId& a, const MaintenanceTaskId& b) { return a.slot < b.slot; });
+        }
+        return ids;
+    }
+
+    size_t size() const { return liveCount; }
+    size_t pending() const { return pendingCount; }
+
+    void reserve(size_t count) {
+        tasks.reserve(count);
+        generations.reserve(count);
+        bucketPosition.reserve(count);
+    }
+
+    // Slot generations, saved with snapshots so IDs stay unique across restarts
+    const std::vector<uint32_t>& slotGenerations() const { return generations; }
+
+    // Prepares an empty scheduler to receive tasks saved with these generations
+    void restoreGenerations(const std::vector<uint32_t>& saved) {
+        growTo(saved.size());
+        for (size_t slot = 0; slot < saved.size(); ++slot) {
+            generations[slot] = saved[slot];
+        }
+    }
+};
+
+const size_t BITMAP_ARRAY_MAX = 4096;       // a container turns into a bitmap above this many values
+const size_t BITMAP_CONTAINER_WORDS = 1024; // 65536 bits
+
+// out = a AND b (or a OR b) over count words; returns the bits set in out.
+// Uses AVX2 when the CPU has it.
+size_t andBitmapWords(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count);
+size_t orBitmapWords(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count);
+
+// Compressed set of 32-bit values in the roaring layout: values are grouped by
+// their high 16 bits into containers, each holding the low 16 bits either as a
+// sorted array (up to BITMAP_ARRAY_MAX values) or as a 65536-bit bitmap. A
+// sparse set costs two bytes a value, a dense one an eighth of a byte, and two
+// bitmap containers combine a word at a time.
+class RoaringBitmap {
+private:
+    struct Container {
+        uint16_t key = 0;        // high 16 bits shared by every value in it
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values; // sorted, while an array
+        std::vector<uint64_t> words;  // BITMAP_CONTAINER_WORDS words, once a bitmap
+
+        bool isBitmap() const { return !words.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (isBitmap()) {
+                return (words[low >> 6] >> (low & 63)) & 1;
+            }
+            return std::binary_search(values.begin(), values.end(), low);
+        }
+
+        // Picks the representation that suits the current cardinality
+        void normalize() {
+            if (!isBitmap() && cardinality > BITMAP_ARRAY_MAX) {
+                words.assign(BITMAP_CONTAINER_WORDS, 0);
+                for (uint16_t low : values) {
+                    words[low >> 6] |= uint64_t(1) << (low & 63);
+                }
+                std::vector<uint16_t>().swap(values);
+            } else if (isBitmap() && cardinality <= BITMAP_ARRAY_MAX) {
+                values.clear();
+                values.reserve(cardinality);
+                for (size_t w = 0; w < BITMAP_CONTAINER_WORDS; ++w) {
+                    for (uint64_t word = words[w]; word; word &= word - 1) {
+                        values.push_back(static_cast<uint16_t>(w * 64 + lowestBit64(word)));
+                    }
+                }
+                std::vector<uint64_t>().swap(words);
+            }
+        }
+    };
+
+    std::vector<Container> containers; // sorted by key, none empty
+    size_t count = 0;
+
+    // Position of the container for key, or where it would be inserted
+    size_t findContainer(uint16_t key) const {
+        size_t lo = 0, hi = containers.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (containers[mid].key < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    void append(Container&& container) {
+        if (container.cardinality > 0) {
+            container.normalize();
+            count += container.cardinality;
+            containers.push_back(std::move(container));
+        }
+    }
+
+public:
+    // Returns false if value was already present
+    bool add(uint32_t value) {
+        uint16_t key = static_cast<uint16_t>(value >> 16);
+        uint16_t low = static_cast<uint16_t>(value);
+        size_t i = findContainer(key);
+        if (i == containers.size() || containers[i].key != key) {
+            containers.insert(containers.begin() + i, Container());
+            containers[i].key = key;
+        }
+        Container& c = containers[i];
+        if (c.isBitmap()) {
+            uint64_t bit = uint64_t(1) << (low & 63);
+            if (c.words[low >> 6] & bit) {
+                return false;
+            }
+            c.words[low >> 6] |= bit;
+        } else {
+            auto pos = std::lower_bound(c.values.begin(), c.values.end(), low);
+            if (pos != c.values.end() && *pos == low) {
+                return false;
+            }
+            c.values.insert(pos, low);
+        }
+        c.cardinality++;
+        c.normalize();
+        count++;
+        return true;
+    }
+
+    // Returns false if value was not present
+    bool remove(uint32_t value) {
+        uint16_t key = static_cast<uint16_t>(value >> 16);
+        uint16_t low = static_cast<uint16_t>(value);
+        size_t i = findContainer(key);
+        if (i == containers.size() || containers[i].key != key || !containers[i].contains(low)) {
+            return false;
+        }
+        Container& c = containers[i];
+        if (c.isBitmap()) {
+            c.words[low >> 6] &= ~(uint64_t(1) << (low & 63));
+        } else {
+            c.values.erase(std::lower_bound(c.values.begin(), c.values.end(), low));
+        }
+        c.cardinality--;
+        count--;
+        if (c.cardinality == 0) {
+            containers.erase(containers.begin() + i);
+        } else {
+            c.normalize();
+        }
+        return true;
+    }
+
+    bool contains(uint32_t value) const {
+        size_t i = findContainer(static_cast<uint16_t>(value >> 16));
+        return i < containers.size() && containers[i].key == (value >> 16) && containers[i].contains(static_cast<uint16_t>(value));
+    }
+
+    size_t cardinality() const { return count; }
+    bool empty() const { return count == 0; }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this) + containers.capacity() * sizeof(Container);
+        for (const auto& c : containers) {
+            bytes += c.values.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() && j < b.containers.size()) {
+            const Container& x = a.containers[i];
+            const Container& y = b.containers[j];
+            if (x.key != y.key) {
+                (x.key < y.key ? i : j)++;
+                continue;
+            }
+            Container out;
+            out.key = x.key;
+            if (x.isBitmap() && y.isBitmap()) {
+                out.words.resize(BITMAP_CONTAINER_WORDS);
+                out.cardinality = static_cast<uint32_t>(andBitmapWords(x.words.data(), y.words.data(), out.words.data(), BITMAP_CONTAINER_WORDS));
+            } else if (x.isBitmap() || y.isBitmap()) {
+                const Container& array = x.isBitmap() ? y : x;
+                const Container& bitmap = x.isBitmap() ? x : y;
+                for (uint16_t low : array.values) {
+                    if (bitmap.contains(low)) {
+                        out.values.push_back(low);
+                    }
+                }
+                out.cardinality = static_cast<uint32_t>(out.values.size());
+            } else {
+                std::set_intersection(x.values.begin(), x.values.end(), y.values.begin(), y.values.end(), std::back_inserter(out.values));
+                out.cardinality = static_cast<uint32_t>(out.values.size());
+            }
+            result.append(std::move(out));
+            i++;
+            j++;
+        }
+        return result;
+    }
+
+    static RoaringBitmap unite(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() || j < b.containers.size()) {
+            if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key)) {
+                result.append(Container(a.containers[i++]));
+                continue;
+            }
+            if (i == a.containers.size() || b.containers[j].key < a.containers[i].key) {
+                result.append(Container(b.containers[j++]));
+                continue;
+            }
+            const Container& x = a.containers[i++];
+            const Container& y = b.containers[j++];
+            Container out;
+            out.key = x.key;
+            if (x.isBitmap() && y.isBitmap()) {
+                out.words.resize(BITMAP_CONTAINER_WORDS);
+                out.cardinality = static_cast<uint32_t>(orBitmapWords(x.words.data(), y.words.data(), out.words.data(), BITMAP_CONTAINER_WORDS));
+            } else if (x.isBitmap() || y.isBitmap()) {
+                const Container& array = x.isBitmap() ? y : x;
+                out.words = (x.isBitmap() ? x : y).words;
+                for (uint16_t low : array.values) {
+                    out.words[low >> 6] |= uint64_t(1) << (low & 63);
+                }
+                for (uint64_t word : out.words) {
+                    out.cardinality += popcount64(word);
+                }
+            } else {
+                std::set_union(x.values.begin(), x.values.end(), y.values.begin(), y.values.end(), std::back_inserter(out.values));
+                out.cardinality = static_cast<uint32_t>(out.values.size());
+            }
+            result.append(std::move(out));
+        }
+        return result;
+    }
+
+    // Values of a that are not in b
+    static RoaringBitmap subtract(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        size_t j = 0;
+        for (const Container& x : a.containers) {
+            while (j < b.containers.size() && b.containers[j].key < x.key) {
+                j++;
+            }
+            if (j == b.containers.size() || b.containers[j].key != x.key) {
+                result.append(Container(x));
+                continue;
+            }
+            const Container& y = b.containers[j];
+            Container out;
+            out.key = x.key;
+            if (x.isBitmap()) {
+                out.words = x.words;
+                out.cardinality = x.cardinality;
+                for (size_t w = 0; w < BITMAP_CONTAINER_WORDS; ++w) {
+                    uint64_t removed = out.words[w] & (y.isBitmap() ? y.words[w] : 0);
+                    out.words[w] &= ~removed;
+                    out.cardinality -= popcount64(removed);
+                }
+                if (!y.isBitmap()) {
+                    for (uint16_t low : y.values) {
+                        uint64_t bit = uint64_t(1) << (low & 63);
+                        if (out.words[low >> 6] & bit) {
+                            out.words[low >> 6] &= ~bit;
+                            out.cardinality--;
+                        }
+                    }
+                }
+            } else {
+                for (uint16_t low : x.values) {
+                    if (!y.contains(low)) {
+                        out.values.push_back(low);
+                    }
+                }
+                out.cardinality = static_cast<uint32_t>(out.values.size());
+            }
+            result.append(std::move(out));
+        }
+        return result;
+    }
+
+    // Calls fn for each value from start on, in increasing order, until fn
+    // returns false; returns the value after the last one visited (a page
+    // cursor), or 2^32 once every value has been visited
+    template <typename Fn>
+    size_t visitFrom(size_t start, Fn fn) const {
+        const size_t end = size_t(1) << 32;
+        if (start >= end) {
+            return end;
+        }
+        for (size_t i = findContainer(static_cast<uint16_t>(start >> 16)); i < containers.size(); ++i) {
+            const Container& c = containers[i];
+            size_t base = size_t(c.key) << 16;
+            size_t from = start > base ? start - base : 0;
+            if (c.isBitmap()) {
+                for (size_t w = from / 64; w < BITMAP_CONTAINER_WORDS; ++w) {
+                    uint64_t word = c.words[w];
+                    if (w == from / 64) {
+                        word &= ~uint64_t(0) << (from % 64);
+                    }
+                    for (; word; word &= word - 1) {
+                        size_t value = base + w * 64 + lowestBit64(word);
+                        if (!fn(static_cast<uint32_t>(value))) {
+                            return value + 1;
+                        }
+                    }
+                }
+            } else {
+                for (auto it = std::lower_bound(c.values.begin(), c.values.end(), from); it != c.values.end(); ++it) {
+                    size_t value = base + *it;
+                    if (!fn(static_cast<uint32_t>(value))) {
+                        return value + 1;
+                    }
+                }
+            }
+        }
+        return end;
+    }
+};
+
+// Set of slots as a plain bitset with summary levels above it: bit i of
+// levels[k + 1] is set while word i of levels[k] is non-zero, up to a single
+// top word. Finding the next member climbs to the first summary word with a
+// set bit and walks back down, a few lowest-bit steps per level however
+// sparse the set is. The member count is kept as the running sum of the
+// popcount changes, so reading it costs nothing.
+class SlotBitset {
+private:
+    std::vector<std::vector<uint64_t>> levels; // levels[0] has one bit per slot
+    size_t count = 0;
+
+    // Makes levels[0] at least words long, adding summary levels as needed
+    void grow(size_t words) {
+        for (size_t k = 0;; ++k) {
+            if (k == levels.size()) {
+                levels.emplace_back(words, 0);
+                const std::vector<uint64_t>& below = levels[k - 1];
+                for (size_t w = 0; w < below.size(); ++w) {
+                    if (below[w]) {
+                        levels[k][w >> 6] |= uint64_t(1) << (w & 63);
+                    }
+                }
+            } else if (levels[k].size() < words) {
+                levels[k].resize(words, 0);
+            } else {
+                return;
+            }
+            if (words == 1) {
+                return;
+            }
+            words = (words + 63) / 64;
+        }
+    }
+
+public:
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    bool contains(uint32_t slot) const {
+        return !levels.empty() && (slot >> 6) < levels[0].size() && (levels[0][slot >> 6] >> (slot & 63) & 1) != 0;
+    }
+
+    void insert(uint32_t slot) {
+        if (contains(slot)) {
+            return;
+        }
+        if (levels.empty()) {
+            levels.emplace_back(1, 0);
+        }
+        grow((slot >> 6) + 1);
+        size_t pos = slot;
+        for (std::vector<uint64_t>& level : levels) {
+            uint64_t& word = level[pos >> 6];
+            bool wasEmpty = word == 0;
+            word |= uint64_t(1) << (pos & 63);
+            if (!wasEmpty) {
+                break;
+            }
+            pos >>= 6;
+        }
+        count++;
+    }
+
+    void erase(uint32_t slot) {
+        if (!contains(slot)) {
+            return;
+        }
+        size_t pos = slot;
+        for (std::vector<uint64_t>& level : levels) {
+            uint64_t& word = level[pos >> 6];
+            word &= ~(uint64_t(1) << (pos & 63));
+            if (word != 0) {
+                break;
+            }
+            pos >>= 6;
+        }
+        count--;
+    }
+
+    // The smallest member at or after from, or NONE
+    uint32_t findFrom(size_t from) const {
+        size_t pos = from;
+        size_t k = 0;
+        while (true) {
+            if (k == levels.size() || (pos >> 6) >= levels[k].size()) {
+                return NONE;
+            }
+            uint64_t word = levels[k][pos >> 6] & (~uint64_t(0) << (pos & 63));
+            if (word) {
+                pos = (pos & ~size_t(63)) + lowestBit64(word);
+                break;
+            }
+            pos = (pos >> 6) + 1; // the next word of this level, as a bit of the level above
+            k++;
+        }
+        while (k > 0) {
+            k--;
+            pos = (pos << 6) + lowestBit64(levels[k][pos]);
+        }
+        return static_cast<uint32_t>(pos);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // The smallest slot at or after from in every one of sets, or NONE. Each
+    // set in turn jumps to its next member at or after the current candidate
+    // until all of them agree, so runs of slots missing from any set are
+    // skipped whole.
+    static uint32_t findInAll(const std::vector<const SlotBitset*>& sets, uint32_t from) {
+        if (sets.empty()) {
+            return NONE;
+        }
+        uint32_t candidate = from;
+        size_t agreed = 0;
+        for (size_t i = 0; agreed < sets.size(); i = (i + 1) % sets.size()) {
+            uint32_t next = sets[i]->findFrom(candidate);
+            if (next == NONE) {
+                return NONE;
+            }
+            if (next == candidate) {
+                agreed++;
+            } else {
+                candidate = next;
+                agreed = 1;
+            }
+        }
+        return candidate;
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this) + levels.capacity() * sizeof(std::vector<uint64_t>);
+        for (const std::vector<uint64_t>& level : levels) {
+            bytes += level.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+};
+
+std::string lowerCase(const std::string& text);
+
+enum class Availability { Any, Available, Rented };
+
+// Attribute search over the fleet. Values given for one attribute are
+// alternatives (OR); the attributes are all required (AND).
+struct FleetQuery {
+    std::vector<std::string> brands;     // lower case
+    std::vector<std::string> colors;     // lower case
+    std::vector<std::string> conditions; // lower case
+    std::vector<CarTypeId> carTypes;
+    Availability availability = Availability::Available;
+    std::vector<std::string> textFilters; // other words, each matched as part of the plate, brand or color
+};
+
+// Per-slot fleet data: a status byte and the car type of every slot in two
+// dense arrays, for lookups and whole-fleet scans that would otherwise read
+// each Vehicle record, and bitmaps of slots by brand, color, condition, car
+// type and availability for searches. The free cars of each type, and of
+// each type and brand, are also kept as SlotBitsets, so picking one or
+// counting them does not depend on how much of the fleet is out. For bookings
+// of given dates, each type also has a SlotBitset per day of the cars not
+// booked that day, so a car free for a period is found by ANDing the sets of
+// its days. Days on which every car of the type is free have no set, so the
+// sets take room only for the days that have bookings. Kept up to date by
+// FleetRegistry and the Vehicle booking functions; bookings on different cars
+// share the sets, so those functions take a lock of the index's own for the
+// few bit flips each makes. Text values are compared without regard to case.
+class FleetIndex {
+public:
+    static const uint8_t SLOT_IN_SERVICE = 1;
+    static const uint8_t SLOT_AVAILABLE = 2;
+
+private:
+    typedef std::unordered_map<Symbol, RoaringBitmap> ValueBitmaps; // by interned lower-case value
+    static constexpr Symbol NOT_LOWERED = 0xFFFFFFFF;
+
+    std::vector<Symbol> lowered;  // by Symbol: the symbol of its lower-case text, once looked up
+    std::vector<uint8_t> status;  // per slot: SLOT_IN_SERVICE | SLOT_AVAILABLE, 0 when retired
+    std::vector<CarTypeId> types; // per slot
+    std::vector<Symbol> brandKeys; // per slot: the lower-case brand, interned
+    ValueBitmaps byBrand;
+    ValueBitmaps byColor;
+    ValueBitmaps byCondition;
+    std::vector<RoaringBitmap> byType; // by CarTypeId
+    RoaringBitmap available;
+    RoaringBitmap inService;
+    std::vector<SlotBitset> freeByType;                 // by CarTypeId
+    std::unordered_map<uint64_t, SlotBitset> freeByBrand; // by freeKey(type, brand key)
+    std::vector<SlotBitset> ofType;                     // by CarTypeId: cars in service
+    std::unordered_map<uint64_t, SlotBitset> ofBrand;   // by freeKey(type, brand key): cars in service
+    std::vector<std::unordered_map<int32_t, SlotBitset>> freeByDay; // by CarTypeId, then day: cars not booked that day
+    mutable std::mutex setsLock; // the bitmaps and sets above
+
+    static uint64_t freeKey(CarTypeId type, Symbol brandKey) { return uint64_t(brandKey) << 32 | type; }
+
+    // The free set of a day, made from the cars of the type on first use
+    SlotBitset& daySet(CarTypeId type, int32_t day) {
+        auto it = freeByDay[type].find(day);
+        if (it == freeByDay[type].end()) {
+            it = freeByDay[type].emplace(day, ofType[type]).first;
+        }
+        return it->second;
+    }
+
+    // The cars of a type in service, of a brand unless it is "", or null if
+    // no such car was ever in the fleet
+    const SlotBitset* typeSet(CarTypeId type, const std::string& brand) const {
+        if (brand.empty()) {
+            return type < ofType.size() ? &ofType[type] : nullptr;
+        }
+        Symbol brandKey;
+        if (!symbols().lookup(lowerCase(brand), brandKey)) {
+            return nullptr;
+        }
+        auto it = ofBrand.find(freeKey(type, brandKey));
+        return it == ofBrand.end() ? nullptr : &it->second;
+    }
+
+    // Adds or removes a car in the in-service sets of its type, and in every
+    // day set of the type (a car joining the fleet has no bookings)
+    void setInService(uint32_t slot, bool inService) {
+        CarTypeId type = types[slot];
+        if (type >= ofType.size()) {
+            ofType.resize(type + 1);
+            freeByDay.resize(type + 1);
+        }
+        SlotBitset& sameBrand = ofBrand[freeKey(type, brandKeys[slot])];
+        for (SlotBitset* set : {&ofType[type], &sameBrand}) {
+            if (inService) {
+                set->insert(slot);
+            } else {
+                set->erase(slot);
+            }
+        }
+        for (auto& day : freeByDay[type]) {
+            if (inService) {
+                day.second.insert(slot);
+            } else {
+                day.second.erase(slot);
+            }
+        }
+    }
+
+    void setFree(uint32_t slot, bool free) {
+        if (types[slot] >= freeByType.size()) {
+            freeByType.resize(types[slot] + 1);
+        }
+        SlotBitset& ofBrand = freeByBrand[freeKey(types[slot], brandKeys[slot])];
+        if (free) {
+            freeByType[types[slot]].insert(slot);
+            ofBrand.insert(slot);
+        } else {
+            freeByType[types[slot]].erase(slot);
+            ofBrand.erase(slot);
+        }
+    }
+
+    // The free set for a type and brand ("" for any brand), or null if no car
+    // of that brand was ever in the fleet
+    const SlotBitset* freeSet(CarTypeId type, const std::string& brand) const {
+        if (brand.empty()) {
+            return type < freeByType.size() ? &freeByType[type] : nullptr;
+        }
+        Symbol brandKey;
+        if (!symbols().lookup(lowerCase(brand), brandKey)) {
+            return nullptr;
+        }
+        auto it = freeByBrand.find(freeKey(type, brandKey));
+        return it == freeByBrand.end() ? nullptr : &it->second;
+    }
+
+    // Brands, colors and conditions repeat across the fleet, so each is
+    // lower-cased and interned once rather than for every car
+    Symbol lowerSymbol(Symbol value) {
+        if (value >= lowered.size()) {
+            lowered.resize(value + 1, NOT_LOWERED);
+        }
+        if (lowered[value] == NOT_LOWERED) {
+            lowered[value] = symbols().intern(lowerCase(symbols().text(value)));
+        }
+        return lowered[value];
+    }
+
+    static bool hasValue(const ValueBitmaps& bitmaps, const std::string& lower) {
+        Symbol key;
+        return symbols().lookup(lower, key) && bitmaps.count(key) != 0;
+    }
+
+    static void removeValue(ValueBitmaps& bitmaps, Symbol key, uint32_t slot) {
+        auto it = bitmaps.find(key);
+        if (it != bitmaps.end() && it->second.remove(slot) && it->second.empty()) {
+            bitmaps.erase(it);
+        }
+    }
+
+    // OR of the bitmaps for values; a single known value needs no copy, so it
+    // is returned through the pointer and unions are kept in scratch
+    static const RoaringBitmap* anyOf(const ValueBitmaps& bitmaps, const std::vector<std::string>& values, std::deque<RoaringBitmap>& scratch) {
+        static const RoaringBitmap none;
+        const RoaringBitmap* result = &none;
+        for (const std::string& value : values) {
+            Symbol key;
+            auto it = symbols().lookup(value, key) ? bitmaps.find(key) : bitmaps.end();
+            if (it == bitmaps.end()) {
+                continue;
+            }
+            if (result == &none) {
+                result = &it->second;
+            } else {
+                scratch.push_back(RoaringBitmap::unite(*result, it->second));
+                result = &scratch.back();
+            }
+        }
+        return result;
+    }
+
+    static size_t memoryBytes(const ValueBitmaps& bitmaps) {
+        size_t bytes = 0;
+        for (const auto& entry : bitmaps) {
+            bytes += sizeof(entry) + entry.second.memoryBytes();
+        }
+        return bytes;
+    }
+
+public:
+    // A vehicle joining the fleet has no bookings, so it starts available
+    void add(const Vehicle& vehicle) {
+        std::lock_guard<std::mutex> hold(setsLock);
+        if (vehicle.slot >= status.size()) {
+            status.resize(vehicle.slot + 1, 0);
+            types.resize(vehicle.slot + 1, CAR_4_SEATER);
+            brandKeys.resize(vehicle.slot + 1, 0);
+        }
+        status[vehicle.slot] = SLOT_IN_SERVICE | SLOT_AVAILABLE;
+        types[vehicle.slot] = vehicle.carType;
+        brandKeys[vehicle.slot] = lowerSymbol(vehicle.brand);
+        setFree(vehicle.slot, true);
+        setInService(vehicle.slot, true);
+        byBrand[brandKeys[vehicle.slot]].add(vehicle.slot);
+        byColor[lowerSymbol(vehicle.color)].add(vehicle.slot);
+        byCondition[lowerSymbol(vehicle.condition)].add(vehicle.slot);
+        if (vehicle.carType >= byType.size()) {
+            byType.resize(vehicle.carType + 1);
+        }
+        byType[vehicle.carType].add(vehicle.slot);
+        available.add(vehicle.slot);
+        inService.add(vehicle.slot);
+    }
+
+    void remove(const Vehicle& vehicle) {
+        std::lock_guard<std::mutex> hold(setsLock);
+        status[vehicle.slot] = 0;
+        setFree(vehicle.slot, false);
+        setInService(vehicle.slot, false);
+        removeValue(byBrand, brandKeys[vehicle.slot], vehicle.slot);
+        removeValue(byColor, lowerSymbol(vehicle.color), vehicle.slot);
+        removeValue(byCondition, lowerSymbol(vehicle.condition), vehicle.slot);
+        byType[vehicle.carType].remove(vehicle.slot);
+        available.remove(vehicle.slot);
+        inService.remove(vehicle.slot);
+    }
+
+    void setAvailable(uint32_t slot, bool av) {
+        std::lock_guard<std::mutex> hold(setsLock);
+        if (av) {
+            status[slot] |= SLOT_AVAILABLE;
+            available.add(slot);
+        } else {
+            status[slot] &= ~SLOT_AVAILABLE;
+            available.remove(slot);
+        }
+        setFree(slot, av);
+    }
+
+    // Lowest free slot of a type, of a brand unless it is "", or
+    // SlotBitset::NONE
+    uint32_t findFree(CarTypeId type, const std::string& brand) const {
+        std::lock_guard<std::mutex> hold(setsLock);
+        const SlotBitset* free = freeSet(type, brand);
+        return free ? free->findFrom(0) : SlotBitset::NONE;
+    }
+
+    // A booking of [from, to) on a car: it is no longer free on those days
+    void booked(uint32_t slot, int32_t from, int32_t to) {
+        std::lock_guard<std::mutex> hold(setsLock);
+        for (int32_t day = from; day < to; ++day) {
+            daySet(types[slot], day).erase(slot);
+        }
+    }
+
+    // [from, to) was released from a car's calendar, whose bookings never
+    // overlap, so the car is free on those days again
+    void unbooked(uint32_t slot, int32_t from, int32_t to) {
+        std::lock_guard<std::mutex> hold(setsLock);
+        CarTypeId type = types[slot];
+        for (int32_t day = from; day < to; ++day) {
+            auto it = freeByDay[type].find(day);
+            if (it == freeByDay[type].end()) {
+                continue;
+            }
+            it->second.insert(slot);
+            if (it->second.size() == ofType[type].size()) {
+                freeByDay[type].erase(it); // nothing booked that day any more
+            }
+        }
+    }
+
+    // Lowest slot of a type, of a brand unless it is "", that is not booked
+    // on any day of [from, to), or SlotBitset::NONE
+    uint32_t findFree(CarTypeId type, const std::string& brand, int32_t from, int32_t to) const {
+        std::lock_guard<std::mutex> hold(setsLock);
+        const SlotBitset* cars = typeSet(type, brand);
+        if (!cars) {
+            return SlotBitset::NONE;
+        }
+        std::vector<const SlotBitset*> terms{cars};
+        for (int32_t day = from; day < to; ++day) {
+            auto it = freeByDay[type].find(day);
+            if (it != freeByDay[type].end()) {
+                terms.push_back(&it->second);
+            }
+        }
+        // Smallest first, so the candidates jump furthest early on
+        std::sort(terms.begin(), terms.end(), [](const SlotBitset* a, const SlotBitset* b) { return a->size() < b->size(); });
+        return SlotBitset::findInAll(terms, 0);
+    }
+
+    size_t countFree(CarTypeId type, const std::string& brand) const {
+        std::lock_guard<std::mutex> hold(setsLock);
+        const SlotBitset* free = freeSet(type, brand);
+        return free ? free->size() : 0;
+    }
+
+    void reserve(size_t slots) {
+        status.reserve(slots);
+        types.reserve(slots);
+        brandKeys.reserve(slots);
+    }
+
+    bool isInService(uint32_t slot) const { return slot < status.size() && (status[slot] & SLOT_IN_SERVICE) != 0; }
+    bool isAvailable(uint32_t slot) const { return (status[slot] & SLOT_AVAILABLE) != 0; }
+    CarTypeId typeOf(uint32_t slot) const { return types[slot]; }
+    const std::vector<uint8_t>& slotStatus() const { return status; }
+    const std::vector<CarTypeId>& slotTypes() const { return types; }
+
+    bool isBrand(const std::string& lower) const { return hasValue(byBrand, lower); }
+    bool isColor(const std::string& lower) const { return hasValue(byColor, lower); }
+    bool isCondition(const std::string& lower) const { return hasValue(byCondition, lower); }
+
+    // Slots matching every indexed attribute of the query (its text filters
+    // are left to the caller). The attribute bitmaps are intersected
+    // smallest first, so the work shrinks with each step.
+    RoaringBitmap match(const FleetQuery& query) const {
+        std::deque<RoaringBitmap> scratch;
+        std::vector<const RoaringBitmap*> terms;
+        if (!query.brands.empty()) {
+            terms.push_back(anyOf(byBrand, query.brands, scratch));
+        }
+        if (!query.colors.empty()) {
+            terms.push_back(anyOf(byColor, query.colors, scratch));
+        }
+        if (!query.conditions.empty()) {
+            terms.push_back(anyOf(byCondition, query.conditions, scratch));
+        }
+        if (!query.carTypes.empty()) {
+            scratch.emplace_back();
+            for (CarTypeId type : query.carTypes) {
+                if (type < byType.size()) {
+                    scratch.back() = RoaringBitmap::unite(scratch.back(), byType[type]);
+                }
+            }
+            terms.push_back(&scratch.back());
+        }
+        if (query.availability == Availability::Available) {
+            terms.push_back(&available);
+        }
+        if (terms.empty()) {
+            terms.push_back(&inService);
+        }
+        std::sort(terms.begin(), terms.end(), [](const RoaringBitmap* a, const RoaringBitmap* b) { return a->cardinality() < b->cardinality(); });
+        RoaringBitmap result = *terms[0];
+        for (size_t i = 1; i < terms.size() && !result.empty(); ++i) {
+            result = RoaringBitmap::intersect(result, *terms[i]);
+        }
+        if (query.availability == Availability::Rented) {
+            result = RoaringBitmap::subtract(result, available);
+        }
+        return result;
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this) + status.capacity() + types.capacity() * sizeof(CarTypeId) + memoryBytes(byBrand) + memoryBytes(byColor)
+            + memoryBytes(byCondition) + available.memoryBytes() + inService.memoryBytes() + brandKeys.capacity() * sizeof(Symbol)
+            + lowered.capacity() * sizeof(Symbol);
+        for (const auto& bitmap : byType) {
+            bytes += bitmap.memoryBytes();
+        }
+        for (const auto& free : freeByType) {
+            bytes += free.memoryBytes();
+        }
+        for (const auto& entry : freeByBrand) {
+            bytes += sizeof(entry) + entry.second.memoryBytes();
+        }
+        for (const auto& cars : ofType) {
+            bytes += cars.memoryBytes();
+        }
+        for (const auto& entry : ofBrand) {
+            bytes += sizeof(entry) + entry.second.memoryBytes();
+        }
+        for (const auto& days : freeByDay) {
+            for (const auto& entry : days) {
+                bytes += sizeof(entry) + entry.second.memoryBytes();
+            }
+        }
+        return bytes;
+    }
+};
+
+inline bool Vehicle::isAvailable() const {
+    return attributeIndex ? attributeIndex->isAvailable(slot) : reservations.empty();
+}
+
+inline void Vehicle::setAvailable(bool av) {
+    if (attributeIndex) {
+        attributeIndex->setAvailable(slot, av);
+    }
+}
+
+inline bool Vehicle::reserve(int32_t from, int32_t to) {
+    if (!reservations.reserve(from, to)) {
+        return false;
+    }
+    if (attributeIndex) {
+        attributeIndex->booked(slot, from, to);
+    }
+    return true;
+}
+
+inline void Vehicle::release(int32_t from, int32_t to) {
+    if (reservations.release(from) && attributeIndex) {
+        attributeIndex->unbooked(slot, from, to);
+    }
+}
+
+inline bool Vehicle::changeEnd(int32_t from, int32_t oldTo, int32_t newTo) {
+    if (!reservations.changeEnd(from, newTo)) {
+        return false;
+    }
+    if (attributeIndex && newTo > oldTo) {
+        attributeIndex->booked(slot, oldTo, newTo);
+    } else if (attributeIndex && newTo < oldTo) {
+        attributeIndex->unbooked(slot, newTo, oldTo);
+    }
+    return true;
+}
+
+// Fleet of vehicles with an open-addressing (linear probing) hash index from
+// packed plate to vehicle slot. Vehicles live in a deque so the Vehicle*
+// handed to customers stays valid when the fleet grows; retired slots are
+// recycled for later additions. The attribute index is held by pointer for
+// the same reason: vehicles point at it, and moving the fleet must not move it.
+class FleetRegistry {
+private:
+    static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+    static const uint32_t DELETED_SLOT = 0xFFFFFFFE;
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    struct IndexEntry {
+        PlateKey key;
+        uint32_t slot;
+    };
+
+    std::deque<Vehicle> vehicles;
+    std::vector<uint32_t> freeSlots;   // retired slots waiting for reuse
+    std::vector<IndexEntry> table;     // capacity is always a power of two
+    size_t liveCount = 0;
+    size_t usedEntries = 0;       // live + deleted entries in the table
+    MaintenanceScheduler tasks;   // refers to vehicles by address, which the deque keeps stable
+    std::unique_ptr<FleetIndex> attributes = std::unique_ptr<FleetIndex>(new FleetIndex());
+
+    // Returns the table position holding key, or NOT_FOUND if it is not indexed
+    size_t probe(const PlateKey& key) const {
+        if (table.empty()) {
+            return NOT_FOUND;
+        }
+        size_t mask = table.size() - 1;
+        size_t pos = hashPlate(key) & mask;
+        while (table[pos].slot != EMPTY_SLOT) {
+            if (table[pos].slot != DELETED_SLOT && table[pos].key == key) {
+                return pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return NOT_FOUND;
+    }
+
+    // Returns the position where key should be inserted (the first deleted
+    // entry on its probe path, else the empty entry ending it), or NOT_FOUND
+    // if key is already indexed. The table must not be full.
+    size_t probeForInsert(const PlateKey& key) const {
+        size_t mask = table.size() - 1;
+        size_t pos = hashPlate(key) & mask;
+        size_t firstDeleted = NOT_FOUND;
+        while (table[pos].slot != EMPTY_SLOT) {
+            if (table[pos].slot == DELETED_SLOT) {
+                if (firstDeleted == NOT_FOUND) {
+                    firstDeleted = pos;
+                }
+            } else if (table[pos].key == key) {
+                return NOT_FOUND;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return firstDeleted != NOT_FOUND ? firstDeleted : pos;
+    }
+
+    void insertEntry(size_t pos, const PlateKey& key, uint32_t slot) {
+        if (table[pos].slot == EMPTY_SLOT) {
+            usedEntries++;
+        }
+        table[pos].key = key;
+        table[pos].slot = slot;
+    }
+
+    // Keep the table at most half full, counting deleted entries
+    void rehash(size_t minLive) {
+        size_t capacity = 16;
+        while (capacity < minLive * 2) {
+            capacity *= 2;
+        }
+        std::vector<IndexEntry> old;
+        old.swap(table);
+        table.assign(capacity, IndexEntry{PlateKey{0, 0}, EMPTY_SLOT});
+        usedEntries = 0;
+        for (const auto& entry : old) {
+            if (entry.slot != EMPTY_SLOT && entry.slot != DELETED_SLOT) {
+                insertEntry(probeForInsert(entry.key), entry.key, entry.slot);
+            }
+        }
+    }
+
+public:
+    // Adds a vehicle to the fleet; fails on a duplicate or unpackable plate
+    Vehicle* addVehicle(Vehicle vehicle) {
+        PlateKey key = vehicle.plate;
+        if (key.lo == 0 && key.hi == 0) {
+            return nullptr;
+        }
+        if ((usedEntries + 1) * 2 > table.size()) {
+            rehash(liveCount + 1);
+        }
+        size_t pos = probeForInsert(key);
+        if (pos == NOT_FOUND) {
+            return nullptr; // duplicate plate
+        }
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            vehicles[slot] = std::move(vehicle);
+        } else {
+            slot = static_cast<uint32_t>(vehicles.size());
+            vehicles.push_back(std::move(vehicle));
+        }
+        insertEntry(pos, key, slot);
+        liveCount++;
+        Vehicle& added = vehicles[slot];
+        added.slot = slot;
+        added.attributeIndex = attributes.get();
+        attributes->add(added);
+        return &added;
+    }
+
+    // Removes a vehicle from service; a rented car cannot be retired
+    bool retireVehicle(const std::string& licensePlate) {
+        PlateKey key;
+        if (!packPlate(licensePlate, key)) {
+            return false;
+        }
+        size_t pos = probe(key);
+        if (pos == NOT_FOUND) {
+            return false;
+        }
+        uint32_t slot = table[pos].slot;
+        if (!attributes->isAvailable(slot)) {
+            return false;
+        }
+        table[pos].slot = DELETED_SLOT;
+        tasks.removeAll(vehicles[slot]);
+        attributes->remove(vehicles[slot]);
+        freeSlots.push_back(slot);
+        liveCount--;
+        return true;
+    }
+
+    // Looks up the slot of a plate without reading its vehicle record
+    bool findSlot(const std::string& licensePlate, uint32_t& slot) const {
+        PlateKey key;
+        if (!packPlate(licensePlate, key)) {
+            return false;
+        }
+        size_t pos = probe(key);
+        if (pos == NOT_FOUND) {
+            return false;
+        }
+        slot = table[pos].slot;
+        return true;
+    }
+
+    // Looks up a vehicle by license plate regardless of availability
+    Vehicle* find(const std::string& licensePlate) {
+        PlateKey key;
+        if (!packPlate(licensePlate, key)) {
+            return nullptr;
+        }
+        size_t pos = probe(key);
+        return pos == NOT_FOUND ? nullptr : &vehicles[table[pos].slot];
+    }
+
+    const Vehicle* find(const std::string& licensePlate) const {
+        return const_cast<FleetRegistry*>(this)->find(licensePlate);
+    }
+
+    // Sizes the index for expectedVehicles without further rehashing
+    void reserve(size_t expectedVehicles) {
+        if (expectedVehicles * 2 > table.size()) {
+            rehash(expectedVehicles);
+        }
+        attributes->reserve(expectedVehicles);
+    }
+
+    size_t size() const { return liveCount; }
+
+    MaintenanceScheduler& maintenance() { return tasks; }
+    const MaintenanceScheduler& maintenance() const { return tasks; }
+
+    const FleetIndex& index() const { return *attributes; }
+
+    // Slot data, read from the dense per-slot arrays
+    bool isAvailable(uint32_t slot) const { return attributes->isAvailable(slot); }
+    CarTypeId typeOf(uint32_t slot) const { return attributes->typeOf(slot); }
+
+    // Cars of a type in service and free, of a brand (any case) unless it is ""
+    size_t countAvailable(CarTypeId type, const std::string& brand = "") const { return attributes->countFree(type, brand); }
+
+    // A car of a type that has no bookings, of a brand unless it is "", or
+    // null if there is none; the lowest free slot is taken
+    Vehicle* findFree(CarTypeId type, const std::string& brand = "") {
+        uint32_t slot = attributes->findFree(type, brand);
+        return slot == SlotBitset::NONE ? nullptr : &vehicles[slot];
+    }
+
+    // The lowest car of a type free for the whole period, of a brand unless
+    // it is "", or null; found by ANDing the fleet's day free sets, without
+    // reading any calendar
+    Vehicle* findFree(CarTypeId type, const std::string& brand, Date from, Date to) {
+        uint32_t slot = attributes->findFree(type, brand, from.days, to.days);
+        return slot == SlotBitset::NONE ? nullptr : &vehicles[slot];
+    }
+
+    // Vehicle in a slot handed out by the index
+    const Vehicle& at(uint32_t slot) const { return vehicles[slot]; }
+
+    // Calls fn for every vehicle in service, in slot order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < vehicles.size(); ++i) {
+            if (attributes->isInService(static_cast<uint32_t>(i))) {
+                fn(vehicles[i]);
+            }
+        }
+    }
+
+    // Calls fn for vehicles in service from slot start on until fn returns
+    // false; returns the slot after the last vehicle visited (a page cursor)
+    template <typename Fn>
+    size_t visitFrom(size_t start, Fn fn) const {
+        size_t i = start;
+        while (i < vehicles.size()) {
+            size_t slot = i++;
+            if (attributes->isInService(static_cast<uint32_t>(slot)) && !fn(vehicles[slot])) {
+                break;
+            }
+        }
+        return i;
+    }
+};
+
+struct CarType {
+    std::string name;
+    double dailyRentalRate;
+};
+
+// Built-in types, known at compile time; ids follow this order
+struct BuiltinCarType {
+    const char* name;
+    double dailyRentalRate;
+};
+
+constexpr BuiltinCarType BUILTIN_CAR_TYPES[] = {
+    {"4-seater", 1000},
+    {"7-seater", 2000},
+};
+
+const size_t MAX_CAR_TYPES = 256;
+const std::string CAR_TYPES_PATH = "D:\\pb\\cartypes.txt";
+
+// Registry of car types: the built-in table plus types (vans, buses, ...)
+// registered at load time. Types are only added during startup, before any
+// contract refers to them, and never change afterwards.
+class CarTypeRegistry {
+private:
+    std::vector<CarType> types;
+    std::unordered_map<std::string, CarTypeId> idsByName;
+
+public:
+    CarTypeRegistry() {
+        for (const auto& builtin : BUILTIN_CAR_TYPES) {
+            CarTypeId id;
+            add(builtin.name, builtin.dailyRentalRate, id);
+        }
+    }
+
+    // Registers a new type; fails on a duplicate name or a full registry
+    bool add(const std::string& name, double dailyRentalRate, CarTypeId& id) {
+        if (name.empty() || types.size() >= MAX_CAR_TYPES || idsByName.count(name)) {
+            return false;
+        }
+        id = static_cast<CarTypeId>(types.size());
+        types.push_back(CarType{name, dailyRentalRate});
+        idsByName.emplace(name, id);
+        return true;
+    }
+
+    bool find(const std::string& name, CarTypeId& id) const {
+        auto it = idsByName.find(name);
+        if (it == idsByName.end()) {
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    const CarType& get(CarTypeId id) const { return types[id]; }
+    size_t size() const { return types.size(); }
+
+    // "4-seater/7-seater/..." for prompts
+    std::string namesForPrompt() const {
+        std::string names;
+        for (const auto& type : types) {
+            names += (names.empty() ? "" : "/") + type.name;
+        }
+        return names;
+    }
+};
+
+CarTypeRegistry& carTypes();
+
+// Registers extra car types from a text file with one "name|daily rate" per
+// line. A missing file is fine; bad lines are reported and skipped.
+void loadCarTypes(const std::string& filePath);
+
+bool isKnownCarType(const std::string& typeName);
+
+const std::string PRICING_PATH = "D:\\pb\\pricing.txt";
+const int PRICING_FIRST_YEAR = 2000; // compiled calendars cover these years;
+const int PRICING_LAST_YEAR = 2049;  // other days are priced one at a time
+
+enum PricingRuleKind { RULE_SEASON, RULE_WEEKEND, RULE_HOLIDAY, RULE_LONG_RENTAL };
+
+// A pricing rule for one car type, or every type with allTypes. Season,
+// weekend and holiday rules multiply the daily rate of the days they cover
+// by factor, and the factors of overlapping rules multiply. A long rental
+// rule takes discount off the whole rental once it lasts minDays days; the
+// longest tier reached applies.
+struct PricingRule {
+    PricingRuleKind kind = RULE_SEASON;
+    bool allTypes = true;
+    CarTypeId carType = CAR_4_SEATER;
+    int fromMonth = 1, fromDay = 1; // season start; holiday date
+    int toMonth = 12, toDay = 31;   // season end, inclusive; may wrap past new year
+    int year = 0;                   // holiday year, 0 for every year
+    int32_t minDays = 0;
+    double factor = 1;
+    double discount = 0;
+
+    bool appliesTo(CarTypeId type) const { return allTypes || carType == type; }
+
+    bool coversDay(const Date& date) const {
+        int y, m, d;
+        date.toYMD(y, m, d);
+        switch (kind) {
+            case RULE_WEEKEND: {
+                int weekday = ((date.days % 7) + 11) % 7; // 0 = Sunday; 1/1/1970 was a Thursday
+                return weekday == 0 || weekday == 6;
+            }
+            case RULE_SEASON: {
+                int day = m * 100 + d, first = fromMonth * 100 + fromDay, last = toMonth * 100 + toDay;
+                return first <= last ? day >= first && day <= last : day >= first || day <= last;
+            }
+            case RULE_HOLIDAY:
+                return m == fromMonth && d == fromDay && (year == 0 || y == year);
+            case RULE_LONG_RENTAL:
+                break;
+        }
+        return false;
+    }
+};
+
+// Rental prices. The rules are compiled into one calendar per car type: the
+// price of every day from PRICING_FIRST_YEAR to PRICING_LAST_YEAR and its
+// running total, so a quote for any period is a difference of two totals
+// however long the rental. Adding or removing a rule only marks the days it
+// can change; compile() then recomputes those days, for the types the rule
+// applies to, and the running totals after the first of them.
+class PricingEngine {
+private:
+    struct Calendar {
+        int64_t baseCents = 0;                         // the type's daily rate
+        std::vector<int64_t> dayCents;                      // per window day
+        std::vector<int64_t> runningCents;                  // [i]: window days before i
+        std::vector<std::pair<int32_t, double>> longRentalTiers; // (min days, discount), by min days
+        std::vector<std::pair<int32_t, int32_t>> dirty; // window day ranges [from, to) to recompute
+    };
+
+    std::vector<PricingRule> rules;
+    std::vector<Calendar> calendars; // by CarTypeId, for the types known at the last compile
+    int32_t windowStart = Date::fromYMD(PRICING_FIRST_YEAR, 1, 1).days;
+    int32_t windowEnd = Date::fromYMD(PRICING_LAST_YEAR + 1, 1, 1).days;
+
+    int64_t dayPrice(CarTypeId type, int64_t baseCents, const Date& day) const {
+        double factor = 1;
+        for (const PricingRule& rule : rules) {
+            if (rule.kind != RULE_LONG_RENTAL && rule.appliesTo(type) && rule.coversDay(day)) {
+                factor *= rule.factor;
+            }
+        }
+        return llround(baseCents * factor);
+    }
+
+    double tierDiscount(CarTypeId type, int32_t days) const {
+        double discount = 0;
+        int32_t reached = 0;
+        for (const PricingRule& rule : rules) {
+            if (rule.kind == RULE_LONG_RENTAL && rule.appliesTo(type) && days >= rule.minDays && rule.minDays >= reached) {
+                reached = rule.minDays;
+                discount = rule.discount;
+            }
+        }
+        return discount;
+    }
+
+    const Calendar* compiled(CarTypeId type) const {
+        return type < calendars.size() && calendars[type].dirty.empty() ? &calendars[type] : nullptr;
+    }
+
+    void rebuildTiers(Calendar& calendar, CarTypeId type) {
+        calendar.longRentalTiers.clear();
+        for (const PricingRule& rule : rules) {
+            if (rule.kind == RULE_LONG_RENTAL && rule.appliesTo(type)) {
+                calendar.longRentalTiers.emplace_back(rule.minDays, 0);
+            }
+        }
+        std::sort(calendar.longRentalTiers.begin(), calendar.longRentalTiers.end());
+        for (auto& tier : calendar.longRentalTiers) {
+            tier.second = tierDiscount(type, tier.first);
+        }
+    }
+
+    // Window day ranges a season, weekend or holiday rule covers: every
+    // weekend, the season's span in each year, the holiday's date in each
+    // year or its one year. They may cover a few days more, never fewer.
+    std::vector<std::pair<int32_t, int32_t>> coveredRanges(const PricingRule& rule) const {
+        std::vector<std::pair<int32_t, int32_t>> ranges;
+        auto add = [&](int32_t from, int32_t to) {
+            from = std::max(from, windowStart);
+            to = std::min(to, windowEnd);
+            if (from < to) {
+                ranges.emplace_back(from - windowStart, to - windowStart);
+            }
+        };
+        switch (rule.kind) {
+            case RULE_WEEKEND:
+                for (int32_t day = windowStart - 1; day < windowEnd; ++day) {
+                    if (((day % 7) + 11) % 7 == 6) { // Saturday, as in coversDay
+                        add(day, day + 2);
+                        day += 6;
+                    }
+                }
+                break;
+            case RULE_SEASON: {
+                bool wraps = rule.fromMonth * 100 + rule.fromDay > rule.toMonth * 100 + rule.toDay;
+                for (int year = PRICING_FIRST_YEAR - 1; year <= PRICING_LAST_YEAR; ++year) {
+                    // A start day past the month's end covers from the next month
+                    int fromDay = std::min(rule.fromDay, Date::daysInMonth(year, rule.fromMonth));
+                    add(Date::fromYMD(year, rule.fromMonth, fromDay).days,
+                        Date::fromYMD(wraps ? year + 1 : year, rule.toMonth, rule.toDay).days + 1);
+                }
+                break;
+            }
+            case RULE_HOLIDAY:
+                for (int year = PRICING_FIRST_YEAR; year <= PRICING_LAST_YEAR; ++year) {
+                    if (rule.year == 0 || rule.year == year) {
+                        int32_t day = Date::fromYMD(year, rule.fromMonth, rule.fromDay).days;
+                        add(day, day + 1);
+                    }
+                }
+                break;
+            case RULE_LONG_RENTAL:
+                break;
+        }
+        return ranges;
+    }
+
+    // Marks what a rule added or removed can change
+    void touch(const PricingRule& rule) {
+        std::vector<std::pair<int32_t, int32_t>> ranges;
+        if (rule.kind != RULE_LONG_RENTAL) {
+            ranges = coveredRanges(rule);
+        }
+        for (size_t type = 0; type < calendars.size(); ++type) {
+            Calendar& calendar = calendars[type];
+            if (!rule.appliesTo(static_cast<CarTypeId>(type))) {
+                continue;
+            }
+            if (rule.kind == RULE_LONG_RENTAL) {
+                rebuildTiers(calendar, static_cast<CarTypeId>(type));
+            } else {
+                calendar.dirty.insert(calendar.dirty.end(), ranges.begin(), ranges.end());
+            }
+        }
+    }
+
+public:
+    void addRule(const PricingRule& rule) {
+        rules.push_back(rule);
+        touch(rule);
+    }
+
+    bool removeRule(size_t index) {
+        if (index >= rules.size()) {
+            return false;
+        }
+        PricingRule removed = rules[index];
+        rules.erase(rules.begin() + index);
+        touch(removed);
+        return true;
+    }
+
+    const std::vector<PricingRule>& ruleList() const { return rules; }
+
+    // Brings the calendars up to date with the rules and the registered car
+    // types; returns the number of day prices recomputed
+    size_t compile() {
+        size_t recomputed = 0;
+        int32_t windowDays = windowEnd - windowStart;
+        while (calendars.size() < carTypes().size()) {
+            CarTypeId type = static_cast<CarTypeId>(calendars.size());
+            calendars.emplace_back();
+            Calendar& calendar = calendars.back();
+            calendar.baseCents = llround(carTypes().get(type).dailyRentalRate * 100);
+            calendar.dayCents.assign(windowDays, 0);
+            calendar.runningCents.assign(windowDays + 1, 0);
+            calendar.dirty.emplace_back(0, windowDays);
+            rebuildTiers(calendar, type);
+        }
+        for (size_t type = 0; type < calendars.size(); ++type) {
+            Calendar& calendar = calendars[type];
+            if (calendar.dirty.empty()) {
+                continue;
+            }
+            // Ranges of several rules overlap; each day is priced once
+            std::sort(calendar.dirty.begin(), calendar.dirty.end());
+            int32_t done = 0;
+            for (const auto& range : calendar.dirty) {
+                for (int32_t i = std::max(range.first, done); i < range.second; ++i) {
+                    calendar.dayCents[i] = dayPrice(static_cast<CarTypeId>(type), calendar.baseCents, Date(windowStart + i));
+                    recomputed++;
+                }
+                done = std::max(done, range.second);
+            }
+            for (int32_t i = calendar.dirty.front().first; i < windowDays; ++i) {
+                calendar.runningCents[i + 1] = calendar.runningCents[i] + calendar.dayCents[i];
+            }
+            calendar.dirty.clear();
+        }
+        return recomputed;
+    }
+
+    // Sum in cents of the day prices of [from, to), before any long rental
+    // discount. Types or days not compiled yet are priced from the rules
+    // directly, with the same result.
+    int64_t dayTotal(CarTypeId type, const Date& from, const Date& to) const {
+        if (to <= from) {
+            return 0;
+        }
+        const Calendar* calendar = compiled(type);
+        int64_t baseCents = calendar ? calendar->baseCents : llround(carTypes().get(type).dailyRentalRate * 100);
+        int32_t first = std::max(from.days, windowStart), last = std::min(to.days, windowEnd);
+        int64_t cents = 0;
+        if (calendar && first < last) {
+            cents = calendar->runningCents[last - windowStart] - calendar->runningCents[first - windowStart];
+        } else {
+            first = last = to.days;
+        }
+        for (int32_t day = from.days; day < first; ++day) {
+            cents += dayPrice(type, baseCents, Date(day));
+        }
+        for (int32_t day = std::max(last, from.days); day < to.days; ++day) {
+            cents += dayPrice(type, baseCents, Date(day));
+        }
+        return cents;
+    }
+
+    // Discount of the longest long rental tier a rental of this many days reaches
+    double longRentalDiscount(CarTypeId type, int32_t days) const {
+        const Calendar* calendar = compiled(type);
+        if (!calendar) {
+            return tierDiscount(type, days);
+        }
+        auto tier = std::upper_bound(calendar->longRentalTiers.begin(), calendar->longRentalTiers.end(), std::make_pair(days, 2.0));
+        return tier == calendar->longRentalTiers.begin() ? 0 : std::prev(tier)->second;
+    }
+
+    // Price in cents of a car of this type for [from, to), long rental discount included
+    int64_t quote(CarTypeId type, const Date& from, const Date& to) const {
+        int64_t cents = dayTotal(type, from, to);
+        double discount = longRentalDiscount(type, to - from);
+        return discount == 0 ? cents : llround(cents * (1 - discount));
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this) + rules.capacity() * sizeof(PricingRule);
+        for (const Calendar& calendar : calendars) {
+            bytes += sizeof(Calendar) + (calendar.dayCents.capacity() + calendar.runningCents.capacity()) * sizeof(int64_t)
+                + calendar.longRentalTiers.capacity() * sizeof(std::pair<int32_t, double>);
+        }
+        return bytes;
+    }
+};
+
+PricingEngine& pricing();
+
+const int64_t QUOTE_FROM_RULES = -1; // no stored quote: price from the current rules
+
+// Adds the rules of a text file, one per line:
+//   season|<car type or *>|dd/mm|dd/mm|factor
+//   weekend|<car type or *>|factor
+//   holiday|<car type or *>|dd/mm[/yyyy]|factor
+//   long|<car type or *>|min days|discount (0.1 for 10%)
+// then compiles them. A missing file leaves the flat daily rates; bad lines
+// are reported and skipped.
+void loadPricingRules(const std::string& filePath);
+
+// A rule as one line of the rules file
+std::string formatPricingRule(const PricingRule& rule);
+
+// Lists the rules, numbered from 1 as rule|delete addresses them
+void writePricingRules(ReportWriter& report);
+
+// Changes the rules at run time:
+//   rule|add|<rule as in the rules file>
+//   rule|delete|<rule number>
+// The rules file is rewritten first, so a change that cannot be saved is not
+// made; compile() then recomputes only the days the change can affect, and
+// recomputed says how many. Open contracts keep the price they were quoted.
+bool runPricingRuleCommand(const std::vector<std::string>& fields, size_t& recomputed, std::string& error);
+
+uint64_t hashPhone(const std::string& phone);
+
+// Secondary index of active contracts by customer phone number. Exact lookups
+// go through an open-addressing table of (phone hash, contract slot) laid out
+// like the fleet index; it holds no strings, so callers confirm a candidate
+// against the customer's phone. Prefix lookups, as the clerk types, use sorted
+// vectors of (phone, slot) that are only built on the first prefix query, so
+// loading and batch runs that never search by prefix do not pay for it. Later
+// additions go to a short vector of their own; once it fills up it is merged
+// into the one before it, and a vector merges into its predecessor once it
+// grows past an eighth of it, so each entry is moved a few times however
+// large the index. Removals leave tombstones that merges drop. Several
+// contracts may share a phone number. The index is split into shards by
+// phone hash, each with its own lock, so bookings made at the same time
+// update it side by side; a prefix query merges the runs of every shard.
+class PhoneIndex {
+private:
+    static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+    static const uint32_t DELETED_SLOT = 0xFFFFFFFE;
+    static const size_t SHORT_RUN = 128; // additions kept before a merge
+    static const size_t RUN_RATIO = 8;   // a run merges once it holds 1/RUN_RATIO of the one before it
+    static const unsigned SHARD_BITS = 4;
+
+    struct IndexEntry {
+        uint32_t hash;
+        uint32_t slot;
+    };
+
+    typedef std::pair<std::string, uint32_t> PhoneEntry;
+
+    struct SortedRun {
+        std::vector<PhoneEntry> entries; // by (phone, slot)
+        std::vector<bool> removed;       // tombstones
+        size_t removedCount = 0;
+
+        // Drops the tombstones in place
+        void compact() {
+            if (removedCount == 0) {
+                return;
+            }
+            size_t kept = 0;
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (!removed[i]) {
+                    if (kept != i) {
+                        entries[kept] = std::move(entries[i]);
+                    }
+                    kept++;
+                }
+            }
+            entries.resize(kept);
+            removed.assign(kept, false);
+            removedCount = 0;
+        }
+    };
+
+    // The numbers whose hash starts with the shard's bits, behind a lock of
+    // their own
+    struct Shard {
+        mutable std::mutex lock;
+        std::vector<IndexEntry> table; // capacity is always a power of two
+        size_t liveCount = 0;
+        size_t usedEntries = 0;        // live + deleted entries in the table
+        std::vector<SortedRun> runs;   // oldest and largest first; empty until the first prefix query
+
+        void insertEntry(uint64_t h, uint32_t slot) {
+            size_t mask = table.size() - 1;
+            size_t pos = h & mask;
+            while (table[pos].slot != EMPTY_SLOT && table[pos].slot != DELETED_SLOT) {
+                pos = (pos + 1) & mask;
+            }
+            if (table[pos].slot == EMPTY_SLOT) {
+                usedEntries++;
+            }
+            table[pos].hash = static_cast<uint32_t>(h);
+            table[pos].slot = slot;
+        }
+
+        // Keep the table at most half full, counting deleted entries. Only the low
+        // 32 bits of each hash are kept, so positions are drawn from those.
+        void rehash(size_t minLive) {
+            size_t capacity = 16;
+            while (capacity < minLive * 2) {
+                capacity *= 2;
+            }
+            std::vector<IndexEntry> old;
+            old.swap(table);
+            table.assign(capacity, IndexEntry{0, EMPTY_SLOT});
+            usedEntries = 0;
+            for (const auto& entry : old) {
+                if (entry.slot != EMPTY_SLOT && entry.slot != DELETED_SLOT) {
+                    insertEntry(entry.hash, entry.slot);
+                }
+            }
+        }
+
+        // Merges the last run into the one before it, in place from the back,
+        // so no second copy of the larger run is allocated
+        void mergeLastRun() {
+            SortedRun added = std::move(runs.back());
+            runs.pop_back();
+            SortedRun& into = runs.back();
+            added.compact();
+            into.compact();
+            size_t kept = into.entries.size(), next = added.entries.size();
+            into.entries.resize(kept + next);
+            size_t out = into.entries.size();
+            while (next > 0) {
+                if (kept > 0 && added.entries[next - 1] < into.entries[kept - 1]) {
+                    into.entries[--out] = std::move(into.entries[--kept]);
+                } else {
+                    into.entries[--out] = std::move(added.entries[--next]);
+                }
+            }
+            into.removed.assign(into.entries.size(), false);
+        }
+
+        void mergeIfDue() {
+            while (runs.size() > 1 && runs.back().entries.size() * RUN_RATIO > runs[runs.size() - 2].entries.size()
+                   && runs.back().entries.size() >= SHORT_RUN) {
+                mergeLastRun();
+            }
+            SortedRun& last = runs.back();
+            if (last.removedCount * 2 > last.entries.size()) {
+                last.compact();
+            }
+            if (runs.back().entries.size() >= SHORT_RUN) {
+                runs.emplace_back();
+            }
+        }
+
+        void add(const std::string& phone, uint32_t h, uint32_t slot) {
+            if ((usedEntries + 1) * 2 > table.size()) {
+                rehash(liveCount + 1);
+            }
+            insertEntry(h, slot);
+            liveCount++;
+            if (!runs.empty()) {
+                SortedRun& last = runs.back();
+                PhoneEntry entry(phone, slot);
+                size_t pos = std::upper_bound(last.entries.begin(), last.entries.end(), entry) - last.entries.begin();
+                last.entries.insert(last.entries.begin() + pos, std::move(entry));
+                last.removed.insert(last.removed.begin() + pos, false);
+                mergeIfDue();
+            }
+        }
+
+        void remove(const std::string& phone, uint32_t h, uint32_t slot) {
+            if (table.empty()) {
+                return;
+            }
+            size_t mask = table.size() - 1;
+            for (size_t pos = h & mask; table[pos].slot != EMPTY_SLOT; pos = (pos + 1) & mask) {
+                if (table[pos].slot == slot && table[pos].hash == h) {
+                    table[pos].slot = DELETED_SLOT;
+                    liveCount--;
+                    break;
+                }
+            }
+            // A removed pair added again has a tombstone in an older run
+            PhoneEntry entry(phone, slot);
+            for (SortedRun& run : runs) {
+                auto it = std::lower_bound(run.entries.begin(), run.entries.end(), entry);
+                for (; it != run.entries.end() && *it == entry; ++it) {
+                    if (!run.removed[it - run.entries.begin()]) {
+                        run.removed[it - run.entries.begin()] = true;
+                        run.removedCount++;
+                        mergeIfDue();
+                        return;
+                    }
+                }
+            }
+        }
+    };
+
+    Shard shards[1 << SHARD_BITS];
+
+    Shard& shardOf(uint64_t h) { return shards[h >> (64 - SHARD_BITS)]; }
+    const Shard& shardOf(uint64_t h) const { return shards[h >> (64 - SHARD_BITS)]; }
+
+public:
+    void reserve(size_t count) {
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> hold(shard.lock);
+            size_t share = (count >> SHARD_BITS) + 1;
+            if (share * 2 > shard.table.size()) {
+                shard.rehash(share);
+            }
+        }
+    }
+
+    void add(const std::string& phone, uint32_t slot) {
+        uint64_t h = hashPhone(phone);
+        Shard& shard = shardOf(h);
+        std::lock_guard<std::mutex> hold(shard.lock);
+        shard.add(phone, static_cast<uint32_t>(h), slot);
+    }
+
+    void remove(const std::string& phone, uint32_t slot) {
+        uint64_t h = hashPhone(phone);
+        Shard& shard = shardOf(h);
+        std::lock_guard<std::mutex> hold(shard.lock);
+        shard.remove(phone, static_cast<uint32_t>(h), slot);
+    }
+
+    // Calls fn(slot) for every contract whose phone may equal phone
+    template <typename Fn>
+    void forEachCandidate(const std::string& phone, Fn fn) const {
+        uint64_t h64 = hashPhone(phone);
+        const Shard& shard = shardOf(h64);
+        std::lock_guard<std::mutex> hold(shard.lock);
+        const std::vector<IndexEntry>& table = shard.table;
+        if (table.empty()) {
+            return;
+        }
+        uint32_t h = static_cast<uint32_t>(h64);
+        size_t mask = table.size() - 1;
+        for (size_t pos = h & mask; table[pos].slot != EMPTY_SLOT; pos = (pos + 1) & mask) {
+            if (table[pos].slot != DELETED_SLOT && table[pos].hash == h) {
+                fn(table[pos].slot);
+            }
+        }
+    }
+
+    bool hasPrefixIndex() const {
+        std::lock_guard<std::mutex> hold(shards[0].lock);
+        return !shards[0].runs.empty();
+    }
+
+    // Builds the prefix index from every (phone, slot) pair, given in any order
+    void buildPrefixIndex(std::vector<std::pair<std::string, uint32_t>> entries) {
+        std::vector<PhoneEntry> parts[1 << SHARD_BITS];
+        for (PhoneEntry& entry : entries) {
+            parts[hashPhone(entry.first) >> (64 - SHARD_BITS)].push_back(std::move(entry));
+        }
+        for (size_t s = 0; s < (1u << SHARD_BITS); ++s) {
+            std::sort(parts[s].begin(), parts[s].end());
+            std::lock_guard<std::mutex> hold(shards[s].lock);
+            std::vector<SortedRun>& runs = shards[s].runs;
+            runs.clear();
+            runs.emplace_back();
+            runs.back().entries.swap(parts[s]);
+            runs.back().removed.assign(runs.back().entries.size(), false);
+            runs.emplace_back();
+        }
+    }
+
+    // Calls fn(phone, slot) in phone order for up to limit contracts whose
+    // phone number starts with prefix, merging the runs of every shard
+    template <typename Fn>
+    void forEachPrefix(const std::string& prefix, size_t limit, Fn fn) const {
+        std::vector<std::unique_lock<std::mutex>> held;
+        std::vector<const SortedRun*> runs;
+        for (const Shard& shard : shards) {
+            held.emplace_back(shard.lock);
+            for (const SortedRun& run : shard.runs) {
+                runs.push_back(&run);
+            }
+        }
+        PhoneEntry first(prefix, 0);
+        std::vector<size_t> next(runs.size());
+        for (size_t r = 0; r < runs.size(); ++r) {
+            next[r] = std::lower_bound(runs[r]->entries.begin(), runs[r]->entries.end(), first) - runs[r]->entries.begin();
+        }
+        for (; limit > 0; --limit) {
+            const PhoneEntry* best = nullptr;
+            size_t bestRun = 0;
+            for (size_t r = 0; r < runs.size(); ++r) {
+                const SortedRun& run = *runs[r];
+                while (next[r] < run.entries.size() && run.removed[next[r]]) {
+                    ++next[r];
+                }
+                if (next[r] < run.entries.size() && (!best || run.entries[next[r]] < *best)) {
+                    best = &run.entries[next[r]];
+                    bestRun = r;
+                }
+            }
+            if (!best || best->first.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            fn(best->first, best->second);
+            ++next[bestRun];
+        }
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> hold(shard.lock);
+            count += shard.liveCount;
+        }
+        return count;
+    }
+};
+
+// Contract figures kept by the revenue cube
+struct CubeMeasures {
+    int64_t contracts = 0;
+    int64_t rentalDays = 0;
+    int64_t revenueCents = 0; // after any VIP discount, without damage fees
+
+    void add(const CubeMeasures& other) {
+        contracts += other.contracts;
+        rentalDays += other.rentalDays;
+        revenueCents += other.revenueCents;
+    }
+
+    bool operator==(const CubeMeasures& other) const {
+        return contracts == other.contracts && rentalDays == other.rentalDays && revenueCents == other.revenueCents;
+    }
+};
+
+struct RevenueCubeCell {
+    CubeMeasures active;     // contracts in the store
+    CubeMeasures checkedOut; // contracts closed at the counter
+    int64_t damageCents = 0; // insurance fees charged on those
+
+    void add(const RevenueCubeCell& other) {
+        active.add(other.active);
+        checkedOut.add(other.checkedOut);
+        damageCents += other.damageCents;
+    }
+};
+
+// One contract's place and weight in the cube
+struct CubeEntry {
+    Symbol brand;        // the rented car's brand
+    CarTypeId carType;
+    bool vip;
+    Date rentalDate;     // a contract counts in the month it starts
+    int32_t days;
+    int64_t revenueCents;
+};
+
+// Roll-up levels: any combination of these, 0 for the grand total
+enum CubeDimension : unsigned {
+    CUBE_BRAND = 1,
+    CUBE_CAR_TYPE = 2,
+    CUBE_CLASS = 4,
+    CUBE_MONTH = 8
+};
+
+// Revenue and rental days by brand x car type x customer class x month,
+// kept current by the contract store as contracts are booked, extended and
+// closed, so reports never walk the contracts. Each change touches one cell.
+// The cells are spread over shards by key, each with its own lock, so
+// terminals booking at the same time rarely wait for each other.
+// Checked-out figures survive restarts: the snapshot keeps them per cell and
+// the journal's end-of-contract records carry the damage fee.
+class RevenueCube {
+private:
+    static const unsigned SHARD_BITS = 4;
+
+    struct Shard {
+        mutable std::mutex lock;
+        std::unordered_map<uint64_t, RevenueCubeCell> cells; // brand symbol, type, class, month packed in the key
+    };
+
+    Shard shards[1 << SHARD_BITS];
+
+    // Calls fn(cell) for the entry's cell, with its shard locked
+    template <typename Fn>
+    void withCell(const CubeEntry& entry, Fn fn) {
+        int year = 0, month = 0, day = 0;
+        entry.rentalDate.toYMD(year, month, day);
+        uint32_t monthIndex = static_cast<uint32_t>(year * 12 + month - 1) & 0x7FFFFF;
+        uint64_t key = uint64_t(entry.brand) << 32 | uint64_t(entry.carType) << 24 | uint64_t(entry.vip) << 23 | monthIndex;
+        Shard& shard = shards[(key * 0x9E3779B97F4A7C15ULL) >> (64 - SHARD_BITS)];
+        std::lock_guard<std::mutex> hold(shard.lock);
+        fn(shard.cells[key]);
+    }
+
+    static CubeMeasures measuresOf(const CubeEntry& entry) {
+        CubeMeasures m;
+        m.contracts = 1;
+        m.rentalDays = entry.days;
+        m.revenueCents = entry.revenueCents;
+        return m;
+    }
+
+    static void subtract(CubeMeasures& measures, const CubeEntry& entry) {
+        CubeMeasures m = measuresOf(entry);
+        measures.contracts -= m.contracts;
+        measures.rentalDays -= m.rentalDays;
+        measures.revenueCents -= m.revenueCents;
+    }
+
+public:
+    void addActive(const CubeEntry& entry) {
+        withCell(entry, [&](RevenueCubeCell& cell) { cell.active.add(measuresOf(entry)); });
+    }
+
+    void removeActive(const CubeEntry& entry) {
+        withCell(entry, [&](RevenueCubeCell& cell) { subtract(cell.active, entry); });
+    }
+
+    // Moves a contract from the active to the checked-out figures
+    void checkOut(const CubeEntry& entry, int64_t damageCents) {
+        withCell(entry, [&](RevenueCubeCell& cell) {
+            subtract(cell.active, entry);
+            cell.checkedOut.add(measuresOf(entry));
+            cell.damageCents += damageCents;
+        });
+    }
+
+    // Adds checked-out figures saved by a snapshot to the cell of key
+    void restoreCheckedOut(const CubeEntry& key, const CubeMeasures& checkedOut, int64_t damageCents) {
+        withCell(key, [&](RevenueCubeCell& cell) {
+            cell.checkedOut.add(checkedOut);
+            cell.damageCents += damageCents;
+        });
+    }
+
+    // Calls fn(brand, carType, vip, year, month, cell) for every cell
+    template <typename Fn>
+    void forEachCell(Fn fn) const {
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> hold(shard.lock);
+            for (const auto& entry : shard.cells) {
+                uint32_t monthIndex = static_cast<uint32_t>(entry.first) & 0x7FFFFF;
+                fn(symbols().text(static_cast<Symbol>(entry.first >> 32)), static_cast<CarTypeId>(entry.first >> 24), ((entry.first >> 23) & 1) != 0,
+                    static_cast<int>(monthIndex / 12), static_cast<int>(monthIndex % 12 + 1), entry.second);
+            }
+        }
+    }
+
+    size_t cellCount() const {
+        size_t count = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> hold(shard.lock);
+            count += shard.cells.size();
+        }
+        return count;
+    }
+};
+
+// Base class to represent a customer
+class Customer {
+protected:
+    std::string Name;
+    std::string Address;
+    std::string PhoneNumber;
+    Symbol Brand; // interned
+    std::string Reason;
+    CarTypeId carType; // Shared car type, see carTypes()
+    Date RentalDate;
+    Date ReturnDate;
+    Vehicle* car;
+    double discountRate = 0; // VIP discount; kept here so billing needs no downcast
+    int64_t quotedCents;     // price before discount, fixed when booked or extended
+    PhoneIndex* phoneIndex = nullptr; // set while the contract store holds this customer
+    RevenueCube* revenue = nullptr;   // likewise
+    uint32_t contractSlot = 0;
+public:
+        
+    // Constructor to initialize customer details
+    // quotedCents is the price a replayed or reloaded contract was quoted;
+    // a new booking is quoted from the current pricing rules
+    Customer(std::string Name, std::string Address, std::string PhoneNumber, std::string_view Brand,std::string Reason, CarTypeId carType, Date RentalDate, Date ReturnDate, Vehicle* car,
+        int64_t quotedCents = QUOTE_FROM_RULES) {
+        this->Name = std::move(Name);
+        this->Address = std::move(Address);
+        this->PhoneNumber = std::move(PhoneNumber);
+        this->Brand = symbols().intern(Brand);
+        this->Reason = std::move(Reason);
+        this->carType = carType;
+        this->RentalDate = RentalDate;
+        this->ReturnDate = ReturnDate;
+        this->car = car;
+        this->quotedCents = quotedCents == QUOTE_FROM_RULES ? pricing().quote(carType, RentalDate, ReturnDate) : quotedCents;
+        this->car->reserve(RentalDate.days, ReturnDate.days);
+        this->car->setAvailable(false);
+    }
+
+    // Public member functions to access member variables
+    std::string getName() const { return Name; }
+    std::string getAddress() const { return Address; }
+    std::string getPhoneNumber() const { return PhoneNumber; }
+    const std::string& getBrand() const { return symbols().text(Brand); }
+    Symbol getBrandSymbol() const { return Brand; }
+    std::string getReason() const { return Reason; }
+    const CarType& getCarType() const { return carTypes().get(carType); }
+    CarTypeId getCarTypeId() const { return carType; }
+    Date getRentalDate() const { return RentalDate; }
+    Date getReturnDate() const { return ReturnDate; }
+    Vehicle* getCar() const { return car; }
+    double getDiscountRate() const { return discountRate; }
+    int64_t getQuotedCents() const { return quotedCents; }
+
+     // Setter methods
+    void setName(const std::string& name) { Name = name; }
+    void setAddress(const std::string& address) { Address = address; }
+    void setPhoneNumber(const std::string& phoneNumber) {
+        if (phoneIndex) {
+            phoneIndex->remove(PhoneNumber, contractSlot);
+            phoneIndex->add(phoneNumber, contractSlot);
+        }
+        PhoneNumber = phoneNumber;
+    }
+    void setReason(const std::string& reason) { Reason = reason; }
+    // Moves the return date if the car is free until then. The new period is
+    // quoted from the current rules unless its quote is given (replay, undo).
+    bool setReturnDate(const Date& returnDate, int64_t quoted = QUOTE_FROM_RULES) {
+        CubeEntry before = cubeEntry();
+        if (quoted == QUOTE_FROM_RULES) {
+            quoted = pricing().quote(carType, RentalDate, returnDate);
+        }
+        if (!car->changeEnd(RentalDate.days, ReturnDate.days, returnDate.days)) {
+            return false;
+        }
+        ReturnDate = returnDate;
+        quotedCents = quoted;
+        if (revenue) {
+            revenue->removeActive(before);
+            revenue->addActive(cubeEntry());
+        }
+        return true;
+    }
+
+    // Called by the contract store once the customer is in its slot
+    void attachIndexes(PhoneIndex* index, RevenueCube* cube, uint32_t slot) {
+        phoneIndex = index;
+        contractSlot = slot;
+        phoneIndex->add(PhoneNumber, slot);
+        revenue = cube;
+        revenue->addActive(cubeEntry());
+    }
+
+    virtual bool isVip() const { return false; }
+
+    // This contract's figures for the revenue cube
+    CubeEntry cubeEntry() const {
+        return CubeEntry{car->brand, carType, isVip(), RentalDate, RentalDays(), llround(calculateRentalCost() * 100)};
+    }
+
+    // Method to display customer information
+    void GetCustomerInfo() const {
+        ReportWriter report(std::cout);
+        writeInfo(report);
+    }
+
+    // Renders the customer information into a report
+    virtual void writeInfo(ReportWriter& report) const {
+        report << "Name: " << Name << '\n';
+        report << "Address: " << Address << '\n';
+        report << "Phone number: " << PhoneNumber << '\n';
+        report << "Brand: " << getBrand() << '\n';
+        report << "Reason for renting: " << Reason << '\n';
+        report << "Car type: " << getCarType().name << '\n';
+        report << "License plate: " << car->licensePlate() << '\n';
+        report << "Rental Date: " << RentalDate << '\n';
+        report << "Return Date: " << ReturnDate << '\n';
+        report << "Number of rental days: " << RentalDays() << '\n';
+        report << "Total rental cost: $" << calculateRentalCost() << '\n';
+    }
+
+    // Method to calculate the number of rental days
+    int RentalDays() const {
+        return ReturnDate - RentalDate;
+    }
+
+    bool extendRentalPeriod(const Date& newReturnDate) {
+        if (!setReturnDate(newReturnDate)) {
+            std::cout << "The car is already booked for part of that period, or the date is before the rental date." << std::endl;
+            return false;
+        }
+        std::cout << "Rental period extended successfully." << std::endl;
+        return true;
+    }
+
+    // Method to calculate the rental cost
+    virtual double calculateRentalCost() const {
+        return calculateBaseRentalCost();
+    }
+
+    // Method to calculate the original rental cost before any discount: the
+    // quote the contract was booked or last extended with, so later rule
+    // changes move neither the bill nor the revenue cube
+    double calculateBaseRentalCost() const {
+        OperationTimer timer(STAT_RENTAL_COST);
+        return quotedCents / 100.0;
+    }
+
+    virtual ~Customer() {
+        if (phoneIndex) {
+            phoneIndex->remove(PhoneNumber, contractSlot);
+        }
+        car->release(RentalDate.days, ReturnDate.days);
+        car->setAvailable(car->reservations.empty());
+    } // Virtual destructor for proper cleanup
+
+    void changeCustomerInfo(const std::string& newName, const std::string& newAddress, const std::string& newPhoneNumber, const std::string& newReason) {
+        setName(newName);
+        setAddress(newAddress);
+        setPhoneNumber(newPhoneNumber);
+        setReason(newReason);
+        std::cout << "Customer information updated successfully." << std::endl;
+    }
+};
+
+// Derived class to represent a VIP customer
+class CustomerVIP : public Customer {
+public:
+    CustomerVIP(std::string Name, std::string Address, std::string PhoneNumber, std::string_view Brand,std::string Reason, CarTypeId carType, Date RentalDate, Date ReturnDate, Vehicle* car, double discountRate,
+        int64_t quotedCents = QUOTE_FROM_RULES)
+        : Customer(std::move(Name), std::move(Address), std::move(PhoneNumber), Brand, std::move(Reason), carType, RentalDate, ReturnDate, car, quotedCents) {
+        this->discountRate = discountRate;
+    }
+
+    bool isVip() const override { return true; }
+
+    // Overridden method to display VIP customer information
+    void writeInfo(ReportWriter& report) const override {
+        Customer::writeInfo(report);
+        report << "Customer type: VIP" << '\n';
+        report << "Discount rate: " << discountRate * 100 << "%" << '\n';
+        report << "Total rental cost after discount: $" << calculateRentalCost() << '\n';
+    }
+
+    // Overridden method to calculate the rental cost with discount
+    double calculateRentalCost() const override {
+        return calculateBaseRentalCost() * (1 - discountRate);
+    }
+};
+
+// Stable identifier of a contract: its slot in the contract store plus the
+// slot's generation, which changes every time the slot is freed. A stale ID
+// therefore never reaches the contract that later reuses the slot.
+struct ContractId {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+
+    bool operator==(const ContractId& other) const { return slot == other.slot && generation == other.generation; }
+};
+
+// Operators see "<slot + 1>" for a slot's first contract and
+// "<slot + 1>-<generation>" after the slot has been reused
+std::string formatContractId(const ContractId& id);
+
+bool parseContractId(const std::string& text, ContractId& id);
+
+// Maintenance task IDs read like customer IDs with an M in front: "M12", "M12-3"
+std::string formatTaskId(const MaintenanceTaskId& id);
+
+bool parseTaskId(const std::string& text, MaintenanceTaskId& id);
+
+// Slab storage for active contracts. Customers and VIP customers are built in
+// place in fixed-size slots carved from blocks that double in size and never
+// move, so a booking costs no allocation of its own. Insert, lookup and
+// removal are O(1); a dense array of live slots gives contiguous iteration
+// for listings (removal swaps the last entry into the hole, so listing order
+// is not insertion order). Customers keep the store's phone index up to date
+// themselves, and the ID itself is the contract-ID index.
+//
+// Contracts on different cars can be booked and ended at the same time: a
+// customer is built and torn down under its car's lock only, the phone
+// index and revenue cube lock their own shards, and the free list and dense
+// array sit behind a lock held for a few pointer moves. Lookups take no lock;
+// the customer found stays put while its car's lock is held or nothing else
+// uses the store. Listings and the phone searches run while nothing else does.
+class ContractStore {
+private:
+    static const unsigned FIRST_BLOCK_BITS = 10; // block k holds 1024 << k slots
+    static const unsigned BLOCKS = 32 - FIRST_BLOCK_BITS;
+    static const size_t SLOTS_PER_GROWTH = 1024;
+    static constexpr size_t SLOT_SIZE = sizeof(Customer) > sizeof(CustomerVIP) ? sizeof(Customer) : sizeof(CustomerVIP);
+    static constexpr size_t SLOT_ALIGN = alignof(Customer) > alignof(CustomerVIP) ? alignof(Customer) : alignof(CustomerVIP);
+    static constexpr uint32_t NOT_LIVE = 0xFFFFFFFF;
+    static constexpr uint32_t BEING_BUILT = 0xFFFFFFFE; // taken, not yet in the dense array
+
+    struct alignas(SLOT_ALIGN) Slot {
+        unsigned char bytes[SLOT_SIZE];
+    };
+
+    struct SlotState {
+        std::atomic<Vehicle*> car{nullptr};    // of the live contract; null while the slot is free or being built
+        std::atomic<uint32_t> generation{0};
+        uint32_t densePosition = NOT_LIVE;     // index into dense, NOT_LIVE or BEING_BUILT; under listLock
+    };
+
+    std::unique_ptr<Slot[]> slotBlocks[BLOCKS];
+    std::unique_ptr<SlotState[]> stateBlocks[BLOCKS];
+    std::atomic<size_t> slotCount{0};  // slots made so far; their blocks exist before it is raised
+    mutable std::mutex listLock;       // the free list, the dense array and growth
+    std::vector<uint32_t> dense;       // live slots
+    std::vector<uint32_t> freeSlots;   // may hold slots taken since by emplaceAt; skipped on reuse
+    std::unique_ptr<PhoneIndex> phones{new PhoneIndex}; // customers point at it, so it moves with swap()
+    std::unique_ptr<RevenueCube> revenue{new RevenueCube}; // likewise
+
+    static void locate(uint32_t slot, unsigned& block, size_t& offset) {
+        uint64_t position = uint64_t(slot) + (uint64_t(1) << FIRST_BLOCK_BITS);
+        unsigned width = static_cast<unsigned>(highestBit64(position));
+        block = width - FIRST_BLOCK_BITS;
+        offset = static_cast<size_t>(position - (uint64_t(1) << width));
+    }
+
+    Customer* at(uint32_t slot) const {
+        unsigned block;
+        size_t offset;
+        locate(slot, block, offset);
+        return reinterpret_cast<Customer*>(slotBlocks[block][offset].bytes);
+    }
+
+    SlotState& stateOf(uint32_t slot) const {
+        unsigned block;
+        size_t offset;
+        locate(slot, block, offset);
+        return stateBlocks[block][offset];
+    }
+
+    // Makes the blocks that hold slots [0, count)
+    void allocateBlocks(size_t count) {
+        for (unsigned block = 0; block < BLOCKS && (size_t(1) << (block + FIRST_BLOCK_BITS)) - (size_t(1) << FIRST_BLOCK_BITS) < count; ++block) {
+            if (!slotBlocks[block]) {
+                slotBlocks[block].reset(new Slot[size_t(1) << (block + FIRST_BLOCK_BITS)]);
+                stateBlocks[block].reset(new SlotState[size_t(1) << (block + FIRST_BLOCK_BITS)]);
+            }
+        }
+    }
+
+    // Makes sure slots [0, count) exist; new slots start free at generation
+    // 0. Called under listLock.
+    void growTo(size_t count) {
+        size_t old = slotCount.load(std::memory_order_relaxed);
+        if (count <= old) {
+            return;
+        }
+        allocateBlocks(count);
+        slotCount.store(count, std::memory_order_release);
+        for (size_t slot = count; slot > old; --slot) {
+            freeSlots.push_back(static_cast<uint32_t>(slot - 1)); // lowest slot is reused first
+        }
+    }
+
+    // Called under listLock
+    uint32_t takeFreeSlot() {
+        while (!freeSlots.empty()) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            if (stateOf(slot).densePosition == NOT_LIVE) {
+                return slot;
+            }
+        }
+        size_t slot = slotCount.load(std::memory_order_relaxed);
+        growTo(slot + SLOTS_PER_GROWTH);
+        freeSlots.pop_back(); // that is 'slot' itself
+        return static_cast<uint32_t>(slot);
+    }
+
+    // Builds the customer in a slot marked BEING_BUILT, outside listLock,
+    // then lists it and makes it visible to lookups
+    template <typename T, typename... Args>
+    T* construct(uint32_t slot, Args&&... args) {
+        SlotState& state = stateOf(slot);
+        T* cus;
+        try {
+            cus = new (at(slot)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            std::lock_guard<std::mutex> hold(listLock);
+            state.densePosition = NOT_LIVE;
+            freeSlots.push_back(slot);
+            throw;
+        }
+        cus->attachIndexes(phones.get(), revenue.get(), slot);
+        {
+            std::lock_guard<std::mutex> hold(listLock);
+            state.densePosition = static_cast<uint32_t>(dense.size());
+            dense.push_back(slot);
+        }
+        state.car.store(cus->getCar(), std::memory_order_release);
+        return cus;
+    }
+
+public:
+    ContractStore() = default;
+    ContractStore(const ContractStore&) = delete;
+    ContractStore& operator=(const ContractStore&) = delete;
+
+    // Builds a Customer or CustomerVIP in a free slot and returns its ID
+    template <typename T, typename... Args>
+    T* emplace(ContractId& id, Args&&... args) {
+        uint32_t slot;
+        {
+            std::lock_guard<std::mutex> hold(listLock);
+            slot = takeFreeSlot();
+            stateOf(slot).densePosition = BEING_BUILT;
+        }
+        T* cus = construct<T>(slot, std::forward<Args>(args)...);
+        id.slot = slot;
+        id.generation = stateOf(slot).generation.load(std::memory_order_relaxed);
+        return cus;
+    }
+
+    // Builds a contract under a known ID (snapshot load and journal replay);
+    // fails if that slot is taken or has moved on to another generation
+    template <typename T, typename... Args>
+    T* emplaceAt(const ContractId& id, Args&&... args) {
+        {
+            std::lock_guard<std::mutex> hold(listLock);
+            growTo(static_cast<size_t>(id.slot) + 1);
+            SlotState& state = stateOf(id.slot);
+            if (state.densePosition != NOT_LIVE || state.generation.load(std::memory_order_relaxed) != id.generation) {
+                return nullptr;
+            }
+            state.densePosition = BEING_BUILT;
+        }
+        return construct<T>(id.slot, std::forward<Args>(args)...);
+    }
+
+    Customer* get(const ContractId& id) const {
+        if (id.slot >= slotCount.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        const SlotState& state = stateOf(id.slot);
+        if (!state.car.load(std::memory_order_acquire) || state.generation.load(std::memory_order_acquire) != id.generation) {
+            return nullptr;
+        }
+        return at(id.slot);
+    }
+
+    // The car of a live contract, or null; a contract ending meanwhile may
+    // still show its car, so check again under that car's lock
+    Vehicle* carOf(const ContractId& id) const {
+        if (id.slot >= slotCount.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        const SlotState& state = stateOf(id.slot);
+        Vehicle* car = state.car.load(std::memory_order_acquire);
+        return state.generation.load(std::memory_order_acquire) == id.generation ? car : nullptr;
+    }
+
+    // Ends a contract: destroys the customer (freeing its booking) and retires the ID
+    bool remove(const ContractId& id) {
+        Customer* cus = get(id);
+        if (!cus) {
+            return false;
+        }
+        revenue->removeActive(cus->cubeEntry());
+        destroy(id);
+        return true;
+    }
+
+    // Ends a contract at the counter: as remove, but its revenue and the
+    // damage fee move to the cube's checked-out figures
+    bool checkOut(const ContractId& id, double damageFee) {
+        Customer* cus = get(id);
+        if (!cus) {
+            return false;
+        }
+        revenue->checkOut(cus->cubeEntry(), llround(damageFee * 100));
+        destroy(id);
+        return true;
+    }
+
+    const RevenueCube& revenueCube() const { return *revenue; }
+    RevenueCube& revenueCube() { return *revenue; }
+
+private:
+    void destroy(const ContractId& id) {
+        SlotState& state = stateOf(id.slot);
+        state.car.store(nullptr, std::memory_order_release);
+        at(id.slot)->~Customer();
+        state.generation.store(id.generation + 1, std::memory_order_release);
+        std::lock_guard<std::mutex> hold(listLock);
+        uint32_t pos = state.densePosition;
+        dense[pos] = dense.back();
+        stateOf(dense[pos]).densePosition = pos;
+        dense.pop_back();
+        state.densePosition = NOT_LIVE;
+        freeSlots.push_back(id.slot);
+    }
+
+public:
+    size_t size() const {
+        std::lock_guard<std::mutex> hold(listLock);
+        return dense.size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Sizes the slot blocks and indexes for count contracts in all
+    void reserve(size_t count) {
+        {
+            std::lock_guard<std::mutex> hold(listLock);
+            allocateBlocks(count);
+            dense.reserve(count);
+        }
+        phones->reserve(count);
+    }
+
+    // Calls fn(id, customer) for contracts from listing position start on
+    // until fn returns false; returns the position after the last contract
+    // visited (a page cursor, valid while no contract is added or removed)
+    template <typename Fn>
+    size_t visitFrom(size_t start, Fn fn) const {
+        size_t pos = start;
+        while (pos < dense.size()) {
+            uint32_t slot = dense[pos++];
+            if (!fn(idOf(slot), static_cast<const Customer*>(at(slot)))) {
+                break;
+            }
+        }
+        return pos;
+    }
+
+    // Calls fn(id, customer) for every contract with exactly this phone number
+    template <typename Fn>
+    void forEachWithPhone(const std::string& phone, Fn fn) const {
+        phones->forEachCandidate(phone, [&](uint32_t slot) {
+            Customer* cus = at(slot);
+            if (cus->getPhoneNumber() == phone) {
+                fn(idOf(slot), cus);
+            }
+        });
+    }
+
+    // Calls fn(id, customer) in phone order for up to limit contracts whose
+    // phone number starts with prefix
+    template <typename Fn>
+    void forEachWithPhonePrefix(const std::string& prefix, size_t limit, Fn fn) {
+        if (!phones->hasPrefixIndex()) {
+            std::vector<std::pair<std::string, uint32_t>> entries;
+            entries.reserve(dense.size());
+            for (uint32_t slot : dense) {
+                entries.emplace_back(at(slot)->getPhoneNumber(), slot);
+            }
+            phones->buildPrefixIndex(std::move(entries));
+        }
+        phones->forEachPrefix(prefix, limit, [&](const std::string&, uint32_t slot) {
+            fn(idOf(slot), at(slot));
+        });
+    }
+
+    // Calls fn(id, customer) for every active contract
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (uint32_t slot : dense) {
+            fn(idOf(slot), at(slot));
+        }
+    }
+
+    // Slot generations, saved with snapshots so IDs stay unique across restarts
+    std::vector<uint32_t> slotGenerations() const {
+        std::vector<uint32_t> generations(slotCount.load(std::memory_order_acquire));
+        for (size_t slot = 0; slot < generations.size(); ++slot) {
+            generations[slot] = stateOf(static_cast<uint32_t>(slot)).generation.load(std::memory_order_relaxed);
+        }
+        return generations;
+    }
+
+    // Prepares an empty store to receive contracts saved with these generations
+    void restoreGenerations(const std::vector<uint32_t>& saved) {
+        std::lock_guard<std::mutex> hold(listLock);
+        growTo(saved.size());
+        for (size_t slot = 0; slot < saved.size(); ++slot) {
+            stateOf(static_cast<uint32_t>(slot)).generation.store(saved[slot], std::memory_order_relaxed);
+        }
+    }
+
+    void clear() {
+        for (uint32_t slot : dense) {
+            SlotState& state = stateOf(slot);
+            revenue->removeActive(at(slot)->cubeEntry());
+            state.car.store(nullptr, std::memory_order_relaxed);
+            at(slot)->~Customer();
+            state.densePosition = NOT_LIVE;
+            state.generation.fetch_add(1, std::memory_order_relaxed);
+            freeSlots.push_back(slot);
+        }
+        dense.clear();
+    }
+
+    void swap(ContractStore& other) {
+        for (unsigned block = 0; block < BLOCKS; ++block) {
+            slotBlocks[block].swap(other.slotBlocks[block]);
+            stateBlocks[block].swap(other.stateBlocks[block]);
+        }
+        slotCount.store(other.slotCount.exchange(slotCount.load()));
+        dense.swap(other.dense);
+        freeSlots.swap(other.freeSlots);
+        phones.swap(other.phones);
+        revenue.swap(other.revenue);
+    }
+
+    ~ContractStore() { clear(); }
+
+private:
+    ContractId idOf(uint32_t slot) const {
+        return ContractId{slot, stateOf(slot).generation.load(std::memory_order_relaxed)};
+    }
+};
+
+// Reads roll-up levels such as "brand month" (any of brand, type, class and
+// month) into CubeDimension flags; empty text is the grand total
+bool parseCubeDimensions(const std::string& text, unsigned& dimensions);
+
+// Prints the revenue cube rolled up to the given CubeDimension flags
+void writeRevenueCube(ReportWriter& report, const RevenueCube& cube, unsigned dimensions);
+
+// Recomputes the active figures from every contract and compares them with
+// the cube, reporting the cells that differ
+bool checkRevenueCube(const ContractStore& CustomerList, ReportWriter& report);
+
+// Bytes per vehicle and per contract with the repeated attributes interned,
+// against what the same records would take with a string in each of them
+void writeMemoryFootprint(ReportWriter& report, const FleetRegistry& VehicleList, const ContractStore& CustomerList);
+
+// Batch billing over contract data kept as columns (structure of arrays).
+// The base cost is the pricing engine's quote for the rental; every bill is
+// base cost * (1 - discount), evaluated in the same order as
+// CustomerVIP::calculateRentalCost, so the results are bit-for-bit identical
+// to the per-object path (a regular customer simply has discount 0).
+struct BillingColumns {
+    std::vector<double> baseCost;
+    std::vector<double> discountRate;
+
+    void reserve(size_t contracts) {
+        baseCost.reserve(contracts);
+        discountRate.reserve(contracts);
+    }
+
+    void add(double base, double discount) {
+        baseCost.push_back(base);
+        discountRate.push_back(discount);
+    }
+
+    size_t size() const { return baseCost.size(); }
+};
+
+BillingColumns collectBillingColumns(const ContractStore& CustomerList);
+
+void computeBillsScalar(const double* base, const double* discount, double* bills, size_t count);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BILLING_HAS_AVX2 1
+
+// Four contracts per step. Only multiply and subtract are used (no FMA), so
+// rounding matches the scalar expression exactly.
+__attribute__((target("avx2")))
+void computeBillsAvx2(const double* base, const double* discount, double* bills, size_t count);
+
+bool cpuHasAvx2();
+#endif
+
+// Fills bills[i] for every contract, using AVX2 when the CPU has it
+void computeBills(const BillingColumns& columns, std::vector<double>& bills, bool allowSimd = true);
+
+// Everything needed to book a customer, as entered in cases 1/2 or read back
+// from the journal
+struct BookingRequest {
+    std::string name;
+    std::string address;
+    std::string phoneNumber;
+    std::string brand;
+    std::string reason;
+    std::string carType;
+    std::string licensePlate; // "" to book any free car of carType and brand
+    Date rentalDate;
+    Date returnDate;
+    bool vip = false;
+    double discountRate = 0;
+    int64_t quotedCents = QUOTE_FROM_RULES; // the journaled quote when replayed
+};
+
+// Fields that case 10 can change, numbered as in its sub-menu
+enum CustomerField { FIELD_NAME = 1, FIELD_ADDRESS = 2, FIELD_PHONE = 3, FIELD_REASON = 4 };
+
+// Write-ahead journal of every mutation made from the menu. Each record is
+//   u32 payload length | u32 CRC-32 | u64 sequence | u8 type | payload
+// where the CRC covers sequence, type and payload. Records reach the OS as
+// soon as they are appended, so a crash of the program loses nothing; fsync
+// is batched over groups of syncEvery records (group commit), which bounds
+// what a power failure can lose.
+const std::string JOURNAL_PATH = "D:\\pb\\journal.wal";
+const size_t JOURNAL_HEADER_SIZE = 17;
+const size_t JOURNAL_COMPACT_RECORDS = 100000; // fold into the snapshot after this many records
+const size_t BATCH_SYNC_EVERY = 512;           // fsync group size used by batch mode
+const std::string JOURNAL_WRITE_FAILED = "the change could not be written to the journal and was not made";
+
+enum JournalRecordType : uint8_t {
+    JOURNAL_ADD_CUSTOMER = 1,
+    JOURNAL_DELETE_CUSTOMER = 2,
+    JOURNAL_EXTEND_RENTAL = 3,
+    JOURNAL_CHANGE_INFO = 4,
+    JOURNAL_ADD_MAINTENANCE = 5,
+    JOURNAL_DELETE_MAINTENANCE = 6,
+    // Contract records carrying the customer ID; types 1-4 predate IDs
+    JOURNAL_BOOK_CONTRACT = 7,
+    JOURNAL_END_CONTRACT = 8,
+    JOURNAL_EXTEND_CONTRACT = 9,
+    JOURNAL_CHANGE_CONTRACT = 10,
+    // Maintenance records carrying the task ID; types 5-6 predate task IDs
+    JOURNAL_SCHEDULE_MAINTENANCE = 11,
+    JOURNAL_COMPLETE_MAINTENANCE = 12,
+    JOURNAL_CANCEL_MAINTENANCE = 13
+};
+
+uint32_t crc32(const char* data, size_t length, uint32_t crc = 0);
+
+// Appends fixed-width fields to a record payload
+class JournalEncoder {
+private:
+    std::string bytes;
+
+public:
+    void putU8(uint8_t value) { bytes.push_back(static_cast<char>(value)); }
+    void putU32(uint32_t value) { bytes.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void putU64(uint64_t value) { bytes.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void putDouble(double value) { bytes.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void putString(const std::string& text) {
+        putU32(static_cast<uint32_t>(text.size()));
+        bytes += text;
+    }
+    void putDate(const Date& date) {
+        int y, m, d;
+        date.toYMD(y, m, d);
+        putU32(static_cast<uint32_t>(y * 10000 + m * 100 + d));
+    }
+    const std::string& data() const { return bytes; }
+};
+
+// Reads fields back from a payload; every getter fails once the payload is exhausted
+class JournalDecoder {
+private:
+    const char* cursor;
+    const char* end;
+
+    bool take(void* out, size_t length) {
+        if (static_cast<size_t>(end - cursor) < length) {
+            return false;
+        }
+        memcpy(out, cursor, length);
+        cursor += length;
+        return true;
+    }
+
+public:
+    JournalDecoder(const char* data, size_t length) : cursor(data), end(data + length) {}
+
+    bool getU8(uint8_t& value) { return take(&value, sizeof(value)); }
+    bool getU32(uint32_t& value) { return take(&value, sizeof(value)); }
+    bool getU64(uint64_t& value) { return take(&value, sizeof(value)); }
+    bool getDouble(double& value) { return take(&value, sizeof(value)); }
+    bool getString(std::string& text) {
+        uint32_t length;
+        if (!getU32(length) || static_cast<size_t>(end - cursor) < length) {
+            return false;
+        }
+        text.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+    bool getDate(Date& date) {
+        uint32_t packed;
+        if (!getU32(packed)) {
+            return false;
+        }
+        date = Date::fromYMD(static_cast<int>(packed / 10000), static_cast<int>(packed / 100 % 100), static_cast<int>(packed % 100));
+        return true;
+    }
+    bool atEnd() const { return cursor == end; }
+};
+
+class Journal {
+private:
+    int fd = -1;
+    uint64_t nextSequence = 1;
+    size_t syncEvery = 1;
+    size_t unsynced = 0;
+    size_t sinceCompaction = 0;
+    size_t fsyncCount = 0;
+    uint64_t goodBytes = 0; // file length up to the end of the last complete record
+    std::string record; // reused encode buffer
+    std::string lastError;
+    // Terminals append from their own threads. The lock hands out sequence
+    // numbers in file order and covers each write; syncs run outside it, so
+    // records written meanwhile share the next one (group commit).
+    mutable std::mutex lock;
+    std::condition_variable syncDone;
+    bool syncing = false;
+    uint64_t syncedBytes = 0;     // file length covered by the last good sync
+    uint64_t syncedSequence = 1;  // nextSequence as of that sync
+    uint64_t lostSyncs = 0;       // group syncs that failed, each cutting the records it covered
+
+    // Cuts the file back to the last complete record
+    bool cutTorn() {
+#ifdef _WIN32
+        return _chsize_s(fd, static_cast<long long>(goodBytes)) == 0;
+#else
+        return ftruncate(fd, static_cast<off_t>(goodBytes)) == 0;
+#endif
+    }
+
+    bool fail(const std::string& what) {
+        lastError = what + ": " + strerror(errno);
+        return false;
+    }
+
+    // 0 or the errno of the failed sync
+    int flushFile() {
+        int result;
+        do {
+            result = syncFile(fd);
+        } while (result != 0 && errno == EINTR);
+        return result == 0 ? 0 : errno;
+    }
+
+    // Waits for a sync that covers the file up to end, starting one when none
+    // is running. A failed sync cuts everything after the last good one: with
+    // every record synced, all of it belongs to callers waiting here, who all
+    // see the failure.
+    bool groupSync(std::unique_lock<std::mutex>& held, uint64_t end) {
+        uint64_t lost = lostSyncs;
+        while (syncedBytes < end && lostSyncs == lost) {
+            if (syncing) {
+                syncDone.wait(held);
+                continue;
+            }
+            syncing = true;
+            uint64_t target = goodBytes, targetSequence = nextSequence;
+            unsynced = 0;
+            held.unlock();
+            int result = flushFile();
+            held.lock();
+            syncing = false;
+            fsyncCount++;
+            if (result == 0) {
+                syncedBytes = target;
+                syncedSequence = targetSequence;
+            } else {
+                errno = result;
+                fail("unable to flush the journal file to disk");
+                sinceCompaction -= static_cast<size_t>(nextSequence - syncedSequence);
+                nextSequence = syncedSequence;
+                goodBytes = syncedBytes;
+                cutTorn();
+                lostSyncs++;
+            }
+            syncDone.notify_all();
+        }
+        return lostSyncs == lost;
+    }
+
+    // Writes one record; a failed or short write is cut off again, so later
+    // records do not land after torn bytes, and its sequence number is reused.
+    // So is a record whose sync fails, as it may not be on disk.
+    bool append(JournalRecordType type, const JournalEncoder& payload) {
+        std::unique_lock<std::mutex> held(lock);
+        if (fd < 0) {
+            return true; // journaling is off
+        }
+        const std::string& body = payload.data();
+        uint64_t sequence = nextSequence;
+        record.resize(JOURNAL_HEADER_SIZE);
+        uint32_t length = static_cast<uint32_t>(body.size());
+        memcpy(&record[0], &length, 4);
+        memcpy(&record[8], &sequence, 8);
+        record[16] = static_cast<char>(type);
+        record += body;
+        uint32_t checksum = crc32(record.data() + 8, record.size() - 8);
+        memcpy(&record[4], &checksum, 4);
+
+        const char* data = record.data();
+        size_t remaining = record.size();
+        while (remaining > 0) {
+            auto written = ::write(fd, data, static_cast<unsigned int>(remaining));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                fail("unable to write to the journal file");
+                if (!cutTorn()) {
+                    lastError += "; the torn record could not be cut off";
+                }
+                return false;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        if (++unsynced >= syncEvery && syncEvery > 1) {
+            // An occasional sync of a batch; the records before this one
+            // have been acknowledged already, so only this one can be cut
+            unsynced = 0;
+            fsyncCount++;
+            if (flushFile() != 0) {
+                fail("unable to flush the journal file to disk");
+                cutTorn();
+                return false;
+            }
+            syncedBytes = goodBytes + record.size();
+            syncedSequence = nextSequence + 1;
+        }
+        nextSequence++;
+        goodBytes += record.size();
+        sinceCompaction++;
+        return syncEvery > 1 || groupSync(held, goodBytes);
+    }
+
+public:
+    // Opens the journal for appending, dropping anything past validBytes
+    // (a torn record found during replay)
+    bool open(const std::string& filePath, uint64_t firstSequence, uint64_t validBytes) {
+        close();
+        std::lock_guard<std::mutex> held(lock);
+#ifdef _WIN32
+        fd = ::_open(filePath.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd >= 0 && _chsize_s(fd, static_cast<long long>(validBytes)) != 0) {
+#else
+        fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0 && ftruncate(fd, static_cast<off_t>(validBytes)) != 0) {
+#endif
+            close();
+        }
+        nextSequence = firstSequence;
+        goodBytes = validBytes;
+        syncedBytes = validBytes;
+        syncedSequence = firstSequence;
+        sinceCompaction = 0;
+        return fd >= 0;
+    }
+
+    // Flushes every appended record to stable storage. On failure the
+    // records appended since the last sync may not be on disk; the reason
+    // is left in error().
+    bool sync() {
+        std::unique_lock<std::mutex> held(lock);
+        syncDone.wait(held, [&] { return !syncing; });
+        bool ok = true;
+        if (fd >= 0 && unsynced > 0) {
+            int result = flushFile();
+            errno = result;
+            ok = result == 0 || fail("unable to flush the journal file to disk");
+            fsyncCount++;
+        }
+        if (ok) {
+            syncedBytes = goodBytes;
+            syncedSequence = nextSequence;
+        }
+        unsynced = 0;
+        return ok;
+    }
+
+    // Empties the journal once its records are covered by a snapshot
+    bool reset() {
+        if (fd < 0) {
+            return false;
+        }
+        sync();
+        std::lock_guard<std::mutex> held(lock);
+#ifdef _WIN32
+        bool ok = _chsize_s(fd, 0) == 0;
+#else
+        bool ok = ftruncate(fd, 0) == 0;
+#endif
+        syncFile(fd);
+        if (ok) {
+            goodBytes = 0;
+            syncedBytes = 0;
+        }
+        sinceCompaction = 0;
+        return ok;
+    }
+
+    void close() {
+        if (fd >= 0) {
+            sync();
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    void setSyncEvery(size_t records) {
+        std::lock_guard<std::mutex> held(lock);
+        syncEvery = records > 0 ? records : 1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    uint64_t lastSequence() const {
+        std::lock_guard<std::mutex> held(lock);
+        return nextSequence - 1;
+    }
+
+    bool needsCompaction() const {
+        std::lock_guard<std::mutex> held(lock);
+        return sinceCompaction >= JOURNAL_COMPACT_RECORDS;
+    }
+
+    size_t syncCount() const {
+        std::lock_guard<std::mutex> held(lock);
+        return fsyncCount;
+    }
+
+    // Why the last append or sync failed
+    std::string error() const {
+        std::lock_guard<std::mutex> held(lock);
+        return lastError;
+    }
+
+    // The log functions return false when the record could not be written;
+    // the journal is then left as it was before the call
+
+    // The quote follows the request; records written before quotes were kept
+    // end at the discount rate and replay with a quote from the current rules
+    bool logAddCustomer(const ContractId& id, const BookingRequest& req, int64_t quotedCents) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        e.putString(req.name);
+        e.putString(req.address);
+        e.putString(req.phoneNumber);
+        e.putString(req.brand);
+        e.putString(req.reason);
+        e.putString(req.carType);
+        e.putString(req.licensePlate);
+        e.putDate(req.rentalDate);
+        e.putDate(req.returnDate);
+        e.putU8(req.vip ? 1 : 0);
+        e.putDouble(req.discountRate);
+        e.putU64(static_cast<uint64_t>(quotedCents));
+        return append(JOURNAL_BOOK_CONTRACT, e);
+    }
+
+    // The damage fee follows the ID; records written before it was kept end
+    // after the ID and replay with no fee
+    bool logDeleteCustomer(const ContractId& id, double damageFee) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        e.putDouble(damageFee);
+        return append(JOURNAL_END_CONTRACT, e);
+    }
+
+    // Likewise the new quote follows the return date
+    bool logExtendRental(const ContractId& id, const Date& newReturnDate, int64_t quotedCents) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        e.putDate(newReturnDate);
+        e.putU64(static_cast<uint64_t>(quotedCents));
+        return append(JOURNAL_EXTEND_CONTRACT, e);
+    }
+
+    bool logChangeInfo(const ContractId& id, CustomerField field, const std::string& value) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        e.putU8(static_cast<uint8_t>(field));
+        e.putString(value);
+        return append(JOURNAL_CHANGE_CONTRACT, e);
+    }
+
+    bool logScheduleMaintenance(const MaintenanceTaskId& id, const std::string& licensePlate, const std::string& description, const Date& dueDate) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        e.putString(licensePlate);
+        e.putString(description);
+        e.putDate(dueDate);
+        return append(JOURNAL_SCHEDULE_MAINTENANCE, e);
+    }
+
+    bool logCompleteMaintenance(const MaintenanceTaskId& id) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        return append(JOURNAL_COMPLETE_MAINTENANCE, e);
+    }
+
+    bool logCancelMaintenance(const MaintenanceTaskId& id) {
+        JournalEncoder e;
+        e.putU32(id.slot);
+        e.putU32(id.generation);
+        return append(JOURNAL_CANCEL_MAINTENANCE, e);
+    }
+
+    ~Journal() { close(); }
+};
+
+// Renders a contract's bill up to the damage prompt; returns the cost after discount
+double writeBill(ReportWriter& report, const Customer* cus);
+
+// Function to print a bill with beautiful borders; returns the insurance fee charged
+double printBill(const Customer* cus);
+
+bool readStoredPassword(std::string& correctPassword);
+
+// Function to initialize the vehicle list
+void initializeCar(FleetRegistry& VehicleList);
+
+// Function to find a vehicle by license plate; whether it is free is decided
+// by its reservation calendar once the rental dates are known
+Vehicle* findCar(FleetRegistry& VehicleList, const std::string& licensePlate);
+// A car of the type free from 'from' to 'to', of the brand unless it is "";
+// null if none (see FleetRegistry::findFree)
+Vehicle* assignFreeCar(FleetRegistry& VehicleList, CarTypeId carType, const std::string& brand, Date from, Date to);
+
+// Why no car could be assigned for the request
+std::string noFreeCarError(const FleetRegistry& VehicleList, const BookingRequest& req, CarTypeId carType);
+
+// Operations shared by the menu and journal replay. They validate the
+// request, apply it without prompting, and explain a rejection in error.
+// bookCustomer stores the new contract's ID in id; with keepId (journal
+// replay) the contract is instead created under the ID already in id.
+// Without a license plate it books a car of the requested type and brand
+// that is free for the rental dates (see FleetRegistry::findFree); the
+// contract's car tells which.
+Customer* bookCustomer(FleetRegistry& VehicleList, ContractStore& CustomerList, const BookingRequest& req, ContractId& id, std::string& error, bool keepId = false);
+
+// Ends a contract: frees the car and retires the customer's ID
+bool removeCustomer(ContractStore& CustomerList, const ContractId& id);
+
+// Ends a contract at checkout, adding its revenue and damage fee to the
+// checked-out figures of the revenue cube
+bool checkOutCustomer(ContractStore& CustomerList, const ContractId& id, double damageFee);
+
+bool applyCustomerField(Customer* cus, CustomerField field, const std::string& value);
+
+// Adds a task to a car's schedule; with keepId the task gets the given ID
+// (journal replay) instead of a fresh one
+bool scheduleMaintenance(FleetRegistry& VehicleList, const std::string& licensePlate, const std::string& description, const Date& dueDate,
+    MaintenanceTaskId& id, std::string& error, bool keepId = false);
+
+bool completeMaintenance(FleetRegistry& VehicleList, const MaintenanceTaskId& id, std::string& error);
+
+bool cancelMaintenance(FleetRegistry& VehicleList, const MaintenanceTaskId& id, std::string& error);
+
+// Finds a car's task by description, for records and commands that predate
+// task IDs
+bool findMaintenanceByDescription(const FleetRegistry& VehicleList, const std::string& licensePlate, const std::string& description, MaintenanceTaskId& id, std::string& error);
+
+// Listings are shown a page at a time. The cursor remembers where the next
+// page starts, so "next page" renders only the rows it shows.
+const size_t REPORT_PAGE_SIZE = 50;
+
+// An empty filter matches everything; otherwise any listed field containing it
+bool matchesFilter(const std::string& filter, const std::string& a, const std::string& b, const std::string& c);
+
+// Reads a car search such as "toyota red 7-seater": each word is looked up as
+// a brand, color, condition or car type name, "available"/"rented"/"all"
+// pick the availability (available cars by default), and any other word is
+// kept as a text filter.
+FleetQuery parseFleetQuery(const FleetRegistry& VehicleList, const std::string& text);
+
+// Slots of the vehicles matching the query, text filters included
+RoaringBitmap searchFleet(const FleetRegistry& VehicleList, const FleetQuery& query);
+
+void writeVehicle(ReportWriter& report, const Vehicle& xe);
+
+void writeMaintenanceTask(ReportWriter& report, const MaintenanceTaskId& id, const MaintenanceTask& task);
+
+const std::string ARCHIVE_PATH = "D:\\pb\\savedcustomer.txt";
+
+// Columnar history of closed contracts, for analytical queries. The history
+// file is a sequence of blocks of up to HISTORY_BLOCK_ROWS rows:
+//   u32 magic | u32 CRC-32 of body | u64 body length | body
+// The body holds u32 row count, u32 padding, then one section per column.
+// Text columns (plate, car type, brand) keep a per-block dictionary followed
+// by packed codes; numeric columns are frame-of-reference bit-packed:
+//   i64 min | i64 max | u8 bit width | padding | u64 words
+// Every section is padded to 8 bytes, so the packed words of a mapped file
+// can be read in place. The min/max of each column and the dictionaries let
+// a query skip blocks without decoding them. The return day is rental day +
+// days and is not stored. Money is kept in cents.
+// Rows of the block still being filled are appended to a tail file, which
+// names the history length it extends; sealing a block restarts the tail.
+const std::string HISTORY_PATH = "D:\\pb\\history.col";
+const std::string HISTORY_TAIL_PATH = "D:\\pb\\history.tail";
+const uint32_t HISTORY_BLOCK_MAGIC = 0x4B4C4248; // "HBLK"
+const char HISTORY_TAIL_MAGIC[8] = {'P', 'B', 'L', 'H', 'T', 'A', 'I', 'L'};
+const size_t HISTORY_BLOCK_ROWS = 65536;
+const size_t HISTORY_BLOCK_HEADER_SIZE = 16;
+
+enum HistoryColumn {
+    HISTORY_PLATE, HISTORY_CAR_TYPE, HISTORY_BRAND, // dictionary columns
+    HISTORY_RENTAL_DAY, HISTORY_DAYS, HISTORY_BASE_CENTS, HISTORY_DISCOUNT_CENTS, HISTORY_DAMAGE_CENTS, HISTORY_CUSTOMER_CLASS,
+    HISTORY_COLUMN_COUNT
+};
+const int HISTORY_TEXT_COLUMNS = 3;
+
+// One closed contract as the history stores it
+struct HistoryRow {
+    std::string plate;
+    std::string carType;
+    std::string brand;
+    int32_t rentalDay = 0;   // Date::days
+    int32_t days = 0;
+    int64_t baseCents = 0;     // before any discount
+    int64_t discountCents = 0; // amount taken off the base cost
+    int64_t damageCents = 0;   // insurance fee charged at checkout
+    uint8_t customerClass = 0; // 0 regular, 1 VIP
+
+    int64_t revenueCents() const { return baseCents - discountCents + damageCents; }
+    const std::string& text(int column) const { return column == HISTORY_PLATE ? plate : column == HISTORY_CAR_TYPE ? carType : brand; }
+    int64_t number(int column) const {
+        switch (column) {
+            case HISTORY_RENTAL_DAY: return rentalDay;
+            case HISTORY_DAYS: return days;
+            case HISTORY_BASE_CENTS: return baseCents;
+            case HISTORY_DISCOUNT_CENTS: return discountCents;
+            case HISTORY_DAMAGE_CENTS: return damageCents;
+        }
+        return customerClass;
+    }
+};
+
+void padTo8(std::string& out);
+
+// Appends values packed as (value - min) in the fewest bits that hold max - min
+void packColumn(std::string& out, const std::vector<int64_t>& values);
+
+// Encodes rows as one history block, header included
+void encodeHistoryBlock(const std::vector<HistoryRow>& rows, std::string& out);
+
+void encodeHistoryTailRecord(const HistoryRow& row, std::string& out);
+
+// Cuts a file back to length bytes, dropping a torn end
+bool truncateFile(const std::string& filePath, uint64_t length);
+
+uint64_t fileSize(const std::string& filePath);
+
+// Length of the history file up to the end of its last complete block
+uint64_t historyValidLength(const std::string& filePath);
+
+// Reads the rows of the unsealed block; the tail only counts if it extends a
+// history file of exactly historyLength bytes
+void loadHistoryTail(const std::string& tailPath, uint64_t historyLength, std::vector<HistoryRow>& rows);
+
+// Appends closed contracts to the history. Rows collect in memory and in the
+// tail file until a block is full, then the block is written to the history
+// file and the tail restarts. Used from the archive writer thread only.
+class HistoryWriter {
+private:
+    std::string historyPath;
+    std::string tailPath;
+    FILE* history = nullptr;
+    FILE* tail = nullptr;
+    uint64_t historyLength = 0;
+    std::vector<HistoryRow> pending;
+    std::string tailBuffer; // tail records not yet written
+
+    bool restartTail() {
+        if (tail) {
+            fclose(tail);
+        }
+        tail = fopen(tailPath.c_str(), "wb");
+        if (!tail) {
+            return false;
+        }
+        if (fwrite(HISTORY_TAIL_MAGIC, 1, 8, tail) != 8 || fwrite(&historyLength, 8, 1, tail) != 1) {
+            fclose(tail);
+            tail = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool sealBlock() {
+        std::string block;
+        encodeHistoryBlock(pending, block);
+        if (fwrite(block.data(), 1, block.size(), history) != block.size() || fflush(history) != 0) {
+            return false;
+        }
+        syncFile(fileno(history));
+        historyLength += block.size();
+        pending.clear();
+        tailBuffer.clear();
+        return restartTail();
+    }
+
+public:
+    // Opens the history, dropping a torn last block, and reloads the rows of
+    // the unsealed block from the tail
+    bool open(const std::string& historyFile, const std::string& tailFile) {
+        historyPath = historyFile;
+        tailPath = tailFile;
+        historyLength = historyValidLength(historyPath);
+        if (fileSize(historyPath) > historyLength && !truncateFile(historyPath, historyLength)) {
+            return false;
+        }
+        history = fopen(historyPath.c_str(), "ab");
+        if (!history) {
+            return false;
+        }
+        loadHistoryTail(tailPath, historyLength, pending);
+        if (!restartTail()) {
+            return false;
+        }
+        for (const HistoryRow& row : pending) {
+            encodeHistoryTailRecord(row, tailBuffer);
+        }
+        return flush();
+    }
+
+    bool append(HistoryRow row) {
+        if (!history) {
+            return false;
+        }
+        encodeHistoryTailRecord(row, tailBuffer);
+        pending.push_back(std::move(row));
+        return pending.size() < HISTORY_BLOCK_ROWS || sealBlock();
+    }
+
+    // Hands buffered tail records to the OS
+    bool flush() {
+        if (!tail) {
+            // The tail could not be restarted after sealing; retry it with
+            // every row of the unsealed block
+            if (!history || !restartTail()) {
+                return false;
+            }
+            tailBuffer.clear();
+            for (const HistoryRow& row : pending) {
+                encodeHistoryTailRecord(row, tailBuffer);
+            }
+        }
+        bool ok = fwrite(tailBuffer.data(), 1, tailBuffer.size(), tail) == tailBuffer.size() && fflush(tail) == 0;
+        tailBuffer.clear();
+        return ok;
+    }
+
+    void sync() {
+        if (tail) {
+            syncFile(fileno(tail));
+        }
+    }
+
+    void close() {
+        if (tail) {
+            flush();
+            sync();
+            fclose(tail);
+            tail = nullptr;
+        }
+        if (history) {
+            fclose(history);
+            history = nullptr;
+        }
+    }
+
+    ~HistoryWriter() { close(); }
+};
+
+// What the archive keeps of a finished contract, copied at checkout so the
+// customer can be removed at once
+struct ArchiveRecord {
+    std::string name;
+    std::string address;
+    std::string phoneNumber;
+    std::string brand;
+    std::string carType;
+    Date rentalDate;
+    Date returnDate;
+    double totalCost; // rental cost after any discount, without the damage fee
+    // Kept for the history only
+    std::string licensePlate;
+    double baseCost = 0;
+    double damageFee = 0;
+    bool vip = false;
+};
+
+ArchiveRecord makeArchiveRecord(const Customer* customer, double damageFee);
+
+HistoryRow toHistoryRow(const ArchiveRecord& rec);
+
+void writeArchiveEntry(ReportWriter& file, const ArchiveRecord& rec);
+
+// When archived contracts are forced to disk (fsync). Every mode hands
+// finished contracts to the OS within one batch; they differ in what a power
+// failure can lose.
+enum class ArchiveDurability {
+    PerContract, // after every write, i.e. every batch of queued contracts
+    Interval,    // at most every flushIntervalMs
+    OnShutdown   // only when the archive is closed
+};
+
+const size_t ARCHIVE_QUEUE_CAPACITY = 4096; // checkout waits when this many are pending
+const int ARCHIVE_FLUSH_MS = 200;
+
+// Appends finished contracts to the archive file on a background thread, so
+// checkout only copies a record into a bounded queue. The writer takes
+// everything queued at once and appends it with a single write; the file
+// stays open between batches. Each contract also goes to the columnar history
+// when one is given, under the same durability. Contracts that could not be
+// written (the file does not open, or a write fails) are kept and retried
+// every flush interval; a failed write is cut off the file first. Closing (or
+// destroying) the writer drains the queue before it returns.
+class ArchiveWriter {
+private:
+    std::string filePath;
+    ArchiveDurability durability;
+    int flushIntervalMs;
+    std::string historyPath;
+    std::string historyTailPath;
+
+    std::mutex lock;
+    std::condition_variable hasWork;   // signalled to the writer thread
+    std::condition_variable hasRoom;   // signalled to waiting producers
+    std::deque<ArchiveRecord> queue;
+    bool stopping = false;
+    std::thread worker;
+    size_t batchCount = 0;
+    size_t lostCount = 0;
+
+    // Appends the records to the archive file, opening it if needed. On a
+    // failed write the file is cut back to where the batch started.
+    bool writeBatch(FILE*& file, const std::deque<ArchiveRecord>& records) {
+        if (!file) {
+            file = fopen(filePath.c_str(), "ab");
+            if (!file) {
+                return false;
+            }
+        }
+        std::ostringstream text;
+        {
+            ReportWriter report(text);
+            for (const ArchiveRecord& rec : records) {
+                writeArchiveEntry(report, rec);
+            }
+        }
+        const std::string& bytes = text.str();
+        uint64_t length = fileSize(filePath);
+        if (fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && fflush(file) == 0) {
+            return true;
+        }
+        fclose(file);
+        file = nullptr;
+        truncateFile(filePath, length);
+        return false;
+    }
+
+    void run() {
+        FILE* file = nullptr;
+        HistoryWriter history;
+        bool historyOpen = !historyPath.empty() && history.open(historyPath, historyTailPath);
+        if (!historyPath.empty() && !historyOpen) {
+            std::cerr << "Unable to open the rental history file." << std::endl;
+        }
+        auto lastSync = std::chrono::steady_clock::now();
+        bool unsynced = false;
+        std::deque<ArchiveRecord> batch;
+        std::deque<ArchiveRecord> unwritten; // taken from the queue, not yet in the file
+        auto lastAttempt = lastSync;
+        bool reported = false;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                bool timed = durability == ArchiveDurability::Interval && unsynced;
+                auto wakeAt = lastSync + std::chrono::milliseconds(flushIntervalMs);
+                if (!unwritten.empty()) {
+                    auto retryAt = lastAttempt + std::chrono::milliseconds(flushIntervalMs);
+                    wakeAt = timed ? std::min(wakeAt, retryAt) : retryAt;
+                    timed = true;
+                }
+                if (timed) {
+                    hasWork.wait_until(guard, wakeAt, [&] { return stopping || !queue.empty(); });
+                } else {
+                    hasWork.wait(guard, [&] { return stopping || !queue.empty(); });
+                }
+                batch.swap(queue);
+                if (batch.empty() && stopping) {
+                    break;
+                }
+            }
+            hasRoom.notify_all();
+
+            if (!batch.empty() && historyOpen) {
+                for (const ArchiveRecord& rec : batch) {
+                    history.append(toHistoryRow(rec));
+                }
+                history.flush();
+                unsynced = true;
+            }
+            for (ArchiveRecord& rec : batch) {
+                unwritten.push_back(std::move(rec));
+            }
+            batch.clear();
+            if (!unwritten.empty()) {
+                OperationTimer timer(STAT_ARCHIVE_WRITE);
+                lastAttempt = std::chrono::steady_clock::now();
+                if (writeBatch(file, unwritten)) {
+                    unwritten.clear();
+                    unsynced = true;
+                    batchCount++;
+                    reported = false;
+                } else if (!reported) {
+                    std::cerr << "Unable to save deleted customer information; it will be retried." << std::endl;
+                    reported = true;
+                }
+            }
+
+            bool due = durability == ArchiveDurability::PerContract
+                || (durability == ArchiveDurability::Interval && std::chrono::steady_clock::now() - lastSync >= std::chrono::milliseconds(flushIntervalMs));
+            if (unsynced && due) {
+                OperationTimer timer(STAT_ARCHIVE_SYNC);
+                if (file) {
+                    syncFile(fileno(file));
+                }
+                if (historyOpen) {
+                    history.sync();
+                }
+                unsynced = false;
+                lastSync = std::chrono::steady_clock::now();
+            }
+        }
+        if (!unwritten.empty() && !writeBatch(file, unwritten)) {
+            lostCount = unwritten.size();
+            std::cerr << "Unable to save the information of " << lostCount << " deleted customers." << std::endl;
+        }
+        if (file) {
+            fflush(file);
+            syncFile(fileno(file));
+            fclose(file);
+        }
+    }
+
+public:
+    ArchiveWriter(const std::string& filePath, ArchiveDurability durability, int flushIntervalMs = ARCHIVE_FLUSH_MS,
+                  const std::string& historyPath = "", const std::string& historyTailPath = "")
+        : filePath(filePath), durability(durability), flushIntervalMs(flushIntervalMs), historyPath(historyPath), historyTailPath(historyTailPath) {
+        worker = std::thread(&ArchiveWriter::run, this);
+    }
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // Queues a finished contract; waits only while the queue is full
+    void submit(ArchiveRecord rec) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            hasRoom.wait(guard, [&] { return queue.size() < ARCHIVE_QUEUE_CAPACITY; });
+            queue.push_back(std::move(rec));
+        }
+        hasWork.notify_one();
+    }
+
+    // Writes out everything queued and stops the writer thread
+    void close() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (stopping) {
+                return;
+            }
+            stopping = true;
+        }
+        hasWork.notify_one();
+        worker.join();
+    }
+
+    size_t batches() const { return batchCount; } // valid after close()
+    size_t lost() const { return lostCount; }      // never written; valid after close()
+
+    ~ArchiveWriter() { close(); }
+};
+
+// Archive durability from PBL_ARCHIVE_SYNC: "contract", "shutdown", or a
+// flush interval in milliseconds (the default is every ARCHIVE_FLUSH_MS)
+ArchiveDurability archiveDurabilityFromEnv(int& flushIntervalMs);
+
+// Archives a finished contract; damageFee is the insurance fee charged at checkout
+void saveDeletedCustomerInfo(const Customer* customer, ArchiveWriter& archive, double damageFee = 0);
+
+// Binary snapshot of the fleet, maintenance schedules and active contracts.
+// Layout: header, vehicle records, task records, customer records, string pool.
+// Records are fixed size and refer to text by (offset, length) in the pool, so
+// loading is a single pass over a mapped file with no text parsing. Integers
+// are stored in native byte order.
+// Customer and maintenance task records carry their slot and generation, and
+// the generations of every contract and task slot follow the customer records,
+// so IDs survive a restart. The revenue cube's checked-out cells come next, so
+// closed revenue and damage fees survive compaction. A file of any other
+// version is rejected.
+const std::string SNAPSHOT_PATH = "D:\\pb\\fleet.snap";
+const char SNAPSHOT_MAGIC[8] = {'P', 'B', 'L', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SnapshotDate {
+    int16_t year;
+    uint8_t month; // 1-12
+    uint8_t day;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vehicleCount;
+    uint32_t taskCount;
+    uint32_t customerCount;
+    uint64_t stringBytes;
+    uint64_t lastJournalSequence;
+    uint32_t contractSlotCount;
+    uint32_t taskSlotCount;
+    uint32_t closedCellCount;
+    uint32_t padding;
+};
+
+struct SnapshotVehicle {
+    SnapshotString licensePlate;
+    SnapshotString brand;
+    SnapshotString color;
+    SnapshotString condition;
+    uint32_t firstTask;
+    uint32_t taskCount;
+    uint8_t available;
+    uint8_t padding[7];
+    SnapshotString carType;
+};
+
+struct SnapshotTask {
+    SnapshotString description;
+    SnapshotDate dueDate;
+    uint8_t completed;
+    uint8_t padding[3];
+    uint32_t taskSlot;
+    uint32_t taskGeneration;
+};
+
+struct SnapshotCustomer {
+    SnapshotString name;
+    SnapshotString address;
+    SnapshotString phoneNumber;
+    SnapshotString brand;
+    SnapshotString reason;
+    SnapshotString carType;
+    uint32_t vehicleIndex;
+    SnapshotDate rentalDate;
+    SnapshotDate returnDate;
+    uint8_t vip;
+    uint8_t padding[3];
+    double discountRate;
+    uint32_t contractSlot;
+    uint32_t contractGeneration;
+    int64_t quotedCents;
+};
+
+// Checked-out figures of one revenue cube cell
+struct SnapshotCubeCell {
+    SnapshotString brand;
+    SnapshotString carType;
+    uint8_t vip;
+    uint8_t padding[3];
+    int32_t month; // year * 12 + month - 1
+    int64_t contracts;
+    int64_t rentalDays;
+    int64_t revenueCents;
+    int64_t damageCents;
+};
+
+static_assert(sizeof(SnapshotHeader) == 56, "snapshot header layout changed");
+static_assert(sizeof(SnapshotVehicle) == 56, "snapshot vehicle layout changed");
+static_assert(sizeof(SnapshotTask) == 24, "snapshot task layout changed");
+static_assert(sizeof(SnapshotCustomer) == 88, "snapshot customer layout changed");
+static_assert(sizeof(SnapshotCubeCell) == 56, "snapshot cube cell layout changed");
+
+SnapshotDate toSnapshotDate(const Date& date);
+
+Date fromSnapshotDate(const SnapshotDate& d);
+
+// Collects records and the string pool, then writes them out in one go
+class SnapshotWriter {
+private:
+    std::string pool;
+    std::vector<SnapshotVehicle> vehicles;
+    std::vector<SnapshotTask> tasks;
+    std::vector<SnapshotCustomer> customers;
+    std::vector<SnapshotCubeCell> closedCells;
+
+    std::unordered_map<Symbol, SnapshotString> symbolRefs; // each interned text is stored once
+    std::vector<SnapshotString> carTypeRefs;                // by CarTypeId; length 0 until stored
+
+    SnapshotString addString(const std::string& text) {
+        SnapshotString ref;
+        ref.offset = static_cast<uint32_t>(pool.size());
+        ref.length = static_cast<uint32_t>(text.size());
+        pool += text;
+        return ref;
+    }
+
+    SnapshotString addSymbol(Symbol symbol) {
+        auto stored = symbolRefs.find(symbol);
+        if (stored != symbolRefs.end()) {
+            return stored->second;
+        }
+        SnapshotString ref = addString(symbols().text(symbol));
+        symbolRefs.emplace(symbol, ref);
+        return ref;
+    }
+
+    SnapshotString addCarType(CarTypeId type) {
+        if (type >= carTypeRefs.size()) {
+            carTypeRefs.resize(type + 1, SnapshotString{0, 0});
+        }
+        if (carTypeRefs[type].length == 0) {
+            carTypeRefs[type] = addString(carTypes().get(type).name);
+        }
+        return carTypeRefs[type];
+    }
+
+public:
+    bool save(const FleetRegistry& fleet, const ContractStore& customerList, const std::string& filePath, uint64_t lastJournalSequence) {
+        std::vector<uint32_t> vehicleIndex(fleet.index().slotStatus().size()); // by slot
+        vehicles.reserve(fleet.size());
+        fleet.forEach([&](const Vehicle& v) {
+            SnapshotVehicle rec = {};
+            rec.licensePlate = addString(v.licensePlate());
+            rec.brand = addSymbol(v.brand);
+            rec.color = addSymbol(v.color);
+            rec.condition = addSymbol(v.condition);
+            rec.firstTask = static_cast<uint32_t>(tasks.size());
+            rec.taskCount = static_cast<uint32_t>(v.maintenanceTasks.size());
+            rec.available = v.isAvailable() ? 1 : 0;
+            rec.carType = addCarType(v.carType);
+            for (const MaintenanceTaskId& id : v.maintenanceTasks) {
+                const MaintenanceTask& task = *fleet.maintenance().get(id);
+                SnapshotTask t = {};
+                t.description = addString(task.description);
+                t.dueDate = toSnapshotDate(task.dueDate);
+                t.completed = task.completed ? 1 : 0;
+                t.taskSlot = id.slot;
+                t.taskGeneration = id.generation;
+                tasks.push_back(t);
+            }
+            vehicleIndex[v.slot] = static_cast<uint32_t>(vehicles.size());
+            vehicles.push_back(rec);
+        });
+
+        customers.reserve(customerList.size());
+        customerList.forEach([&](const ContractId& id, const Customer* cus) {
+            SnapshotCustomer rec = {};
+            rec.name = addString(cus->getName());
+            rec.address = addString(cus->getAddress());
+            rec.phoneNumber = addString(cus->getPhoneNumber());
+            rec.brand = addSymbol(cus->getBrandSymbol());
+            rec.reason = addString(cus->getReason());
+            rec.carType = addCarType(cus->getCarTypeId());
+            rec.vehicleIndex = vehicleIndex[cus->getCar()->slot];
+            rec.rentalDate = toSnapshotDate(cus->getRentalDate());
+            rec.returnDate = toSnapshotDate(cus->getReturnDate());
+            rec.vip = cus->isVip() ? 1 : 0;
+            rec.discountRate = cus->getDiscountRate();
+            rec.contractSlot = id.slot;
+            rec.contractGeneration = id.generation;
+            rec.quotedCents = cus->getQuotedCents();
+            customers.push_back(rec);
+        });
+        customerList.revenueCube().forEachCell([&](const std::string& brand, CarTypeId carType, bool vip, int year, int month, const RevenueCubeCell& cell) {
+            if (cell.checkedOut == CubeMeasures() && cell.damageCents == 0) {
+                return;
+            }
+            SnapshotCubeCell rec = {};
+            rec.brand = addString(brand);
+            rec.carType = addCarType(carType);
+            rec.vip = vip ? 1 : 0;
+            rec.month = year * 12 + month - 1;
+            rec.contracts = cell.checkedOut.contracts;
+            rec.rentalDays = cell.checkedOut.rentalDays;
+            rec.revenueCents = cell.checkedOut.revenueCents;
+            rec.damageCents = cell.damageCents;
+            closedCells.push_back(rec);
+        });
+        const std::vector<uint32_t>& generations = customerList.slotGenerations();
+        const std::vector<uint32_t>& taskGenerations = fleet.maintenance().slotGenerations();
+
+        SnapshotHeader header = {};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.vehicleCount = static_cast<uint32_t>(vehicles.size());
+        header.taskCount = static_cast<uint32_t>(tasks.size());
+        header.customerCount = static_cast<uint32_t>(customers.size());
+        header.stringBytes = pool.size();
+        header.lastJournalSequence = lastJournalSequence;
+        header.contractSlotCount = static_cast<uint32_t>(generations.size());
+        header.taskSlotCount = static_cast<uint32_t>(taskGenerations.size());
+        header.closedCellCount = static_cast<uint32_t>(closedCells.size());
+
+        // Write next to the old snapshot and swap it in, so a crash mid-write
+        // never leaves a truncated snapshot behind
+        std::string tempPath = filePath + ".tmp";
+        FILE* file = fopen(tempPath.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(vehicles.data(), sizeof(SnapshotVehicle), vehicles.size(), file) == vehicles.size()
+            && fwrite(tasks.data(), sizeof(SnapshotTask), tasks.size(), file) == tasks.size()
+            && fwrite(customers.data(), sizeof(SnapshotCustomer), customers.size(), file) == customers.size()
+            && fwrite(generations.data(), sizeof(uint32_t), generations.size(), file) == generations.size()
+            && fwrite(taskGenerations.data(), sizeof(uint32_t), taskGenerations.size(), file) == taskGenerations.size()
+            && fwrite(closedCells.data(), sizeof(SnapshotCubeCell), closedCells.size(), file) == closedCells.size()
+            && fwrite(pool.data(), 1, pool.size(), file) == pool.size();
+        ok = fclose(file) == 0 && ok;
+        if (!ok) {
+            remove(tempPath.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        remove(filePath.c_str()); // rename does not replace an existing file on Windows
+#endif
+        return rename(tempPath.c_str(), filePath.c_str()) == 0;
+    }
+};
+
+bool saveSnapshot(const FleetRegistry& fleet, const ContractStore& customerList, const std::string& filePath, uint64_t lastJournalSequence = 0);
+
+// Read-only view of a snapshot file, memory-mapped where the platform allows
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+
+public:
+    bool open(const std::string& filePath) {
+#ifdef _WIN32
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+#else
+        int fd = ::open(filePath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                return false;
+            }
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(mapping);
+        }
+        close(fd);
+        return true;
+#endif
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (bytes) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+};
+
+enum class SnapshotStatus { Loaded, Missing, Corrupt };
+
+// Validates the whole snapshot first, then builds the fleet and customer list
+// from it. On Corrupt nothing is modified.
+SnapshotStatus loadSnapshot(const std::string& filePath, FleetRegistry& fleet, ContractStore& customerList, uint64_t& lastJournalSequence);
+
+// Fleet import from the inventory system's CSV export, one vehicle per line:
+//   plate,brand,color,car type,condition[,task description,dd/mm/yyyy]...
+// with any number of open maintenance tasks as trailing pairs. An optional
+// first line starting with "plate," is a header. The file is mapped and cut
+// into chunks on line boundaries; worker threads parse chunks into views of
+// the mapping, without copying, while the calling thread adds the parsed
+// chunks to the fleet in file order, so memory stays bounded by the chunks
+// in flight rather than the file size.
+const size_t FLEET_IMPORT_CHUNK_BYTES = 4 << 20;
+const size_t FLEET_IMPORT_REPORTED_ERRORS = 100; // bad rows listed; the rest are counted
+
+struct ImportedTask {
+    std::string_view description;
+    Date dueDate;
+};
+
+struct ImportedVehicle {
+    std::string_view plate, brand, color, condition;
+    CarTypeId carType;
+    uint32_t firstTask;  // index in the chunk's tasks
+    uint32_t taskCount;
+    uint32_t line;       // within the chunk, from 1
+};
+
+struct ImportError {
+    uint64_t line;      // within the chunk while parsing, in the file once reported
+    const char* reason;
+};
+
+struct FleetImportChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    bool firstInFile = false; // may start with the header
+    uint32_t lines = 0;
+    std::vector<ImportedVehicle> vehicles;
+    std::vector<ImportedTask> tasks;
+    std::vector<ImportError> errors;
+};
+
+// Parses the lines of one chunk; safe to run on several chunks at once
+void parseFleetImportChunk(FleetImportChunk& chunk);
+
+struct FleetImportResult {
+    uint64_t rows = 0;     // data lines, bad ones included
+    uint64_t vehicles = 0; // added to the fleet (or valid, for a check)
+    uint64_t tasks = 0;
+    uint64_t rejected = 0;
+    double seconds = 0;
+};
+
+// Imports the vehicles of a CSV file into the fleet with the given number of
+// parsing threads, reporting rejected rows by line number. Rows that are
+// malformed, or whose plate is already in the fleet, are skipped. With a null
+// fleet the file is only checked (plates are not compared). Returns false if
+// the file cannot be read.
+bool importFleetCsv(const std::string& filePath, FleetRegistry* fleet, size_t threads, ReportWriter& report, FleetImportResult& result);
+
+// Read-only view of one bit-packed history column inside a mapped block
+struct PackedColumnView {
+    int64_t min = 0;
+    int64_t max = 0;
+    uint8_t width = 0;
+    const uint64_t* words = nullptr;
+
+    int64_t at(size_t i) const {
+        if (width == 0) {
+            return min;
+        }
+        size_t bit = i * width, word = bit / 64, offset = bit % 64;
+        uint64_t v = words[word] >> offset;
+        if (offset + width > 64) {
+            v |= words[word + 1] << (64 - offset);
+        }
+        if (width < 64) {
+            v &= (uint64_t(1) << width) - 1;
+        }
+        return static_cast<int64_t>(static_cast<uint64_t>(min) + v);
+    }
+
+    void decode(size_t count, int64_t* out) const {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = at(i);
+        }
+    }
+};
+
+struct DictionaryView {
+    uint32_t count = 0;
+    const char* entries = nullptr; // count x (u32 length, text)
+    const char* entriesEnd = nullptr;
+    PackedColumnView codes;
+
+    template <typename Fn>
+    void forEachEntry(Fn fn) const {
+        const char* cursor = entries;
+        for (uint32_t code = 0; code < count; ++code) {
+            uint32_t length;
+            memcpy(&length, cursor, 4);
+            fn(code, cursor + 4, length);
+            cursor += 4 + length;
+        }
+    }
+
+    // Fills texts with a view of each entry, by code
+    void index(std::vector<std::string_view>& texts) const {
+        texts.resize(count);
+        forEachEntry([&](uint32_t code, const char* entry, uint32_t length) { texts[code] = std::string_view(entry, length); });
+    }
+
+    bool find(const std::string& text, uint32_t& code) const {
+        bool found = false;
+        forEachEntry([&](uint32_t entryCode, const char* entry, uint32_t length) {
+            if (!found && length == text.size() && memcmp(entry, text.data(), length) == 0) {
+                code = entryCode;
+                found = true;
+            }
+        });
+        return found;
+    }
+};
+
+struct HistoryBlockView {
+    uint32_t rows = 0;
+    DictionaryView text[HISTORY_TEXT_COLUMNS];
+    PackedColumnView numbers[HISTORY_COLUMN_COUNT]; // used for the numeric columns
+};
+
+// Lays out a block body for reading in place, checking every section bound
+bool parseHistoryBlock(const char* body, uint64_t length, HistoryBlockView& view);
+
+struct HistoryScanStats {
+    size_t blocks = 0;
+    size_t blocksSkipped = 0;   // ruled out by min/max or dictionary
+    uint64_t rowsScanned = 0;
+    uint64_t bytes = 0;
+};
+
+// Calls onBlock(view) for every complete block of the history file; rows of
+// the unsealed block are returned in tailRows
+template <typename Fn>
+void scanHistory(const std::string& historyPath, const std::string& tailPath, HistoryScanStats& stats, std::vector<HistoryRow>& tailRows, Fn onBlock) {
+    MappedFile file;
+    uint64_t offset = 0;
+    if (file.open(historyPath)) {
+        stats.bytes = file.size();
+        while (file.size() - offset >= HISTORY_BLOCK_HEADER_SIZE) {
+            uint32_t magic;
+            uint64_t length;
+            memcpy(&magic, file.data() + offset, 4);
+            memcpy(&length, file.data() + offset + 8, 8);
+            HistoryBlockView view;
+            if (magic != HISTORY_BLOCK_MAGIC || length > file.size() - offset - HISTORY_BLOCK_HEADER_SIZE
+                || !parseHistoryBlock(file.data() + offset + HISTORY_BLOCK_HEADER_SIZE, length, view)) {
+                break;
+            }
+            stats.blocks++;
+            onBlock(view);
+            offset += HISTORY_BLOCK_HEADER_SIZE + length;
+        }
+    }
+    loadHistoryTail(tailPath, offset, tailRows);
+}
+
+struct RevenueCell {
+    int64_t cents = 0;
+    uint64_t rentals = 0;
+};
+
+// Revenue (base cost - discount + damage fee) and number of rentals in one
+// year, by car type and month of the rental date
+std::map<std::string, std::array<RevenueCell, 12>> revenueByMonthAndType(const std::string& historyPath, const std::string& tailPath, int year, HistoryScanStats& stats);
+
+// Every recorded rental of one plate, in the order the contracts were closed
+std::vector<HistoryRow> rentalsOfPlate(const std::string& historyPath, const std::string& tailPath, const std::string& plate, HistoryScanStats& stats);
+
+std::string formatCents(int64_t cents);
+
+void printRevenueReport(ReportWriter& report, int year, const std::map<std::string, std::array<RevenueCell, 12>>& revenue);
+
+void printPlateRentals(ReportWriter& report, const std::string& plate, const std::vector<HistoryRow>& rows);
+
+// Runs a history query: "revenue <year>" or "plate <license plate>"
+bool runHistoryQuery(const std::string& kind, const std::string& argument);
+
+struct ReplayResult {
+    size_t applied = 0;
+    size_t rejected = 0;         // well-formed records that no longer apply
+    uint64_t lastSequence = 0;
+    uint64_t validBytes = 0;     // journal length up to the last intact record
+    bool tornTail = false;       // a partial or corrupt record was dropped
+};
+
+// Applies one journal record through the same operations the menu uses
+bool applyJournalRecord(uint8_t type, JournalDecoder& in, FleetRegistry& VehicleList, ContractStore& CustomerList);
+
+// Replays journal records newer than the snapshot, stopping at the first torn
+// or corrupt record (the tail of an interrupted write)
+ReplayResult replayJournal(const std::string& filePath, uint64_t afterSequence, FleetRegistry& VehicleList, ContractStore& CustomerList);
+
+// Folds the journal into a fresh snapshot and empties it, keeping replay short
+bool compactJournal(Journal& journal, const FleetRegistry& VehicleList, const ContractStore& CustomerList);
+
+// Loads the last snapshot, replays the journal on top of it and opens the
+// journal for new changes. Returns false if startup must stop.
+bool restoreState(FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal);
+
+// Parses a dd/mm/yyyy date
+bool parseDate(const std::string& text, Date& date);
+
+const size_t PHONE_PREFIX_MATCHES = 20; // listed by case 13 for a partial number
+
+// Looks up an active contract by the customer ID shown by case 4
+Customer* findContract(const std::string& text, const ContractStore& CustomerList, ContractId& id);
+
+const size_t RESERVATION_LOCK_STRIPES = 1024;
+
+// Lets several booking terminals (threads) book, extend and end contracts on
+// one fleet at the same time. A car's calendar, its availability and the
+// contracts on it only change under that car's lock, one of a fixed set of
+// stripes picked by the car's address: two bookings of one car take turns,
+// so they can never overlap, while bookings of different cars run in
+// parallel. Everything a booking, extension or return does (calendar, quote,
+// contract, journal record) happens under that car's lock alone; what the
+// cars share looks after itself: the contract store, phone index, revenue
+// cube and fleet free sets lock only the slot list, shard or set they
+// change, and the journal numbers and writes one record at a time and
+// syncs outside its lock, so concurrent records share a sync. A car's
+// records reach the journal in the order its changes were made, and a
+// contract's end is written before its slot can be reused. Anything else
+// that touches the fleet or the contracts (changes, maintenance, listings,
+// snapshots) runs through exclusive(), which waits for the terminals to step
+// aside.
+class ReservationEngine {
+private:
+    FleetRegistry& fleet;
+    ContractStore& contracts;
+    Journal* journal;       // optional
+    ArchiveWriter* archive; // optional; ended contracts go here
+    std::shared_mutex gate;      // shared by engine operations, exclusive for the rest
+    std::unique_ptr<std::mutex[]> carLocks{new std::mutex[RESERVATION_LOCK_STRIPES]};
+
+    std::mutex& lockFor(const Vehicle* car) {
+        return carLocks[(reinterpret_cast<uintptr_t>(car) / sizeof(Vehicle)) % RESERVATION_LOCK_STRIPES];
+    }
+
+    // Books the request on its car and journals it; called under the car's lock
+    bool bookLocked(const BookingRequest& req, ContractId& id, std::string& error) {
+        Customer* cus = bookCustomer(fleet, contracts, req, id, error);
+        if (!cus) {
+            return false;
+        }
+        if (journal && !journal->logAddCustomer(id, req, cus->getQuotedCents())) {
+            removeCustomer(contracts, id); // not durable, so not made
+            error = JOURNAL_WRITE_FAILED + " (" + journal->error() + ")";
+            return false;
+        }
+        return true;
+    }
+
+    // Books a car of the type and brand that is free for the dates, found
+    // through the fleet's day free sets without taking the lock of every car
+    // looked at. Another terminal may book the car before its lock is taken,
+    // so its calendar is checked again under the lock and, if it was taken,
+    // the search runs again; the sets were brought up to date under that
+    // same lock, so it moves on to another car. The journal gets the chosen
+    // plate, so replay books the same car.
+    bool bookAnyFree(const BookingRequest& req, ContractId& id, std::string& error) {
+        CarTypeId type;
+        if (!carTypes().find(req.carType, type)) {
+            error = "Invalid car type!";
+            return false;
+        }
+        if (req.returnDate <= req.rentalDate) {
+            error = "The return date must be after the rental date!";
+            return false;
+        }
+        BookingRequest onCar = req;
+        for (;;) {
+            Vehicle* car = fleet.findFree(type, req.brand, req.rentalDate, req.returnDate);
+            if (!car) {
+                error = noFreeCarError(fleet, req, type);
+                return false;
+            }
+            std::lock_guard<std::mutex> carLock(lockFor(car));
+            if (car->reservations.isFree(req.rentalDate.days, req.returnDate.days)) {
+                onCar.licensePlate = car->licensePlate();
+                return bookLocked(onCar, id, error);
+            }
+        }
+    }
+
+    // With the car locked: the contract, if it is still live and on that car
+    Customer* lockedContract(const ContractId& id, const Vehicle* car) {
+        Customer* cus = contracts.get(id);
+        return cus && cus->getCar() == car ? cus : nullptr;
+    }
+
+public:
+    ReservationEngine(FleetRegistry& fleet, ContractStore& contracts, Journal* journal = nullptr, ArchiveWriter* archive = nullptr)
+        : fleet(fleet), contracts(contracts), journal(journal), archive(archive) {}
+
+    bool book(const BookingRequest& req, ContractId& id, std::string& error) {
+        OperationTimer timer(STAT_BOOK);
+        std::shared_lock<std::shared_mutex> shared(gate);
+        if (req.licensePlate.empty()) {
+            return bookAnyFree(req, id, error);
+        }
+        Vehicle* car = fleet.find(req.licensePlate);
+        if (!car) {
+            error = "The car is not available or invalid license plate number!";
+            return false;
+        }
+        std::lock_guard<std::mutex> carLock(lockFor(car));
+        return bookLocked(req, id, error);
+    }
+
+    // Ends a contract and archives it; damageFee is the insurance fee charged
+    bool end(const ContractId& id, std::string& error, double damageFee = 0) {
+        OperationTimer timer(STAT_END_RENTAL);
+        std::shared_lock<std::shared_mutex> shared(gate);
+        Vehicle* car = contracts.carOf(id);
+        Customer* cus = nullptr;
+        if (car) {
+            std::lock_guard<std::mutex> carLock(lockFor(car));
+            cus = lockedContract(id, car);
+            if (cus) {
+                // Journaled first: a checkout cannot be taken back once archived
+                if (journal && !journal->logDeleteCustomer(id, damageFee)) {
+                    error = JOURNAL_WRITE_FAILED + " (" + journal->error() + ")";
+                    return false;
+                }
+                if (archive) {
+                    saveDeletedCustomerInfo(cus, *archive, damageFee);
+                }
+                checkOutCustomer(contracts, id, damageFee);
+            }
+        }
+        if (!cus) {
+            error = "Invalid customer ID";
+            return false;
+        }
+        return true;
+    }
+
+    bool extend(const ContractId& id, const Date& newReturnDate, std::string& error) {
+        OperationTimer timer(STAT_EXTEND_RENTAL);
+        std::shared_lock<std::shared_mutex> shared(gate);
+        Vehicle* car = contracts.carOf(id);
+        if (!car) {
+            error = "Invalid customer ID!";
+            return false;
+        }
+        std::lock_guard<std::mutex> carLock(lockFor(car));
+        Customer* cus = lockedContract(id, car);
+        if (!cus) {
+            error = "Invalid customer ID!";
+            return false;
+        }
+        Date oldReturnDate = cus->getReturnDate();
+        int64_t oldQuote = cus->getQuotedCents();
+        if (!cus->setReturnDate(newReturnDate)) {
+            error = "the car is already booked for part of that period, or the date is before the rental date";
+            return false;
+        }
+        if (journal && !journal->logExtendRental(id, newReturnDate, cus->getQuotedCents())) {
+            cus->setReturnDate(oldReturnDate, oldQuote);
+            error = JOURNAL_WRITE_FAILED + " (" + journal->error() + ")";
+            return false;
+        }
+        return true;
+    }
+
+    // Runs fn alone: no booking, extension or return is in progress meanwhile
+    template <typename Fn>
+    auto exclusive(Fn fn) -> decltype(fn()) {
+        std::unique_lock<std::shared_mutex> all(gate);
+        return fn();
+    }
+
+    // Folds the journal into a snapshot once it has grown long enough
+    bool compactIfNeeded() {
+        if (!journal || !journal->needsCompaction()) {
+            return true;
+        }
+        return exclusive([&] { return !journal->needsCompaction() || compactJournal(*journal, fleet, contracts); });
+    }
+};
+
+// Turns a failed journal write into the command's error; the change itself
+// stays made, as these commands cannot be taken back
+bool journaled(const Journal& journal, bool written, std::string& error);
+
+// Batch commands outside the reservation engine: customer details and
+// maintenance
+bool runExclusiveBatchCommand(const std::vector<std::string>& fields, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, std::string& error);
+
+// Splits a command line at '|'
+void splitFields(const std::string& line, std::vector<std::string>& fields);
+
+// Reads an add or addvip command (see runBatch) into a booking request
+bool parseBookingCommand(const std::vector<std::string>& fields, BookingRequest& req, std::string& error);
+
+// Runs one batch command; fields[0] is the command name. Bookings, returns
+// and extensions go through the engine, the rest runs exclusively.
+bool runBatchCommand(const std::vector<std::string>& fields, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, std::string& error);
+
+// Streams a command file through the booking operations without prompts.
+// One command per line, fields separated by '|', dates as dd/mm/yyyy and
+// customers addressed by the ID shown when they were booked:
+//   add|name|address|phone|brand|reason|car type|plate|rental date|return date
+//   addvip|name|address|phone|brand|reason|car type|plate|rental date|return date|discount rate
+//   delete|customer ID
+//   extend|customer ID|new return date
+//   change|customer ID|name/address/phone/reason|new value
+//   maint|add|plate|description|due date
+//   maint|done|task ID
+//   maint|delete|task ID          (or maint|delete|plate|description)
+//   rule|add|<pricing rule>       (see runPricingRuleCommand)
+//   rule|delete|rule number
+// Blank lines and lines starting with '#' are skipped. Returns the number of
+// commands that failed. Several files can run at once, one per thread, like
+// booking terminals sharing the engine; each reports to its own out.
+size_t runBatch(std::istream& input, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal& journal, std::ostream& out);
+
+// Server mode: counter terminals share one fleet through a server process
+// on a Unix domain socket. Every message is a frame
+//   u32 body length | u8 code | body
+// where a request's code is the operation and a response's code its status.
+// Bodies use the journal's field encoding (JournalEncoder/JournalDecoder).
+// A rejected request answers with the error text. Listings answer one page
+// of the report shown on screen plus the cursor of the next page.
+// The server only runs where Unix sockets do, so its default path is a POSIX
+// one rather than the D:\pb data directory; --serve/--client take another.
+const std::string SERVER_SOCKET_PATH = "/tmp/pbl.sock";
+const size_t SERVER_MAX_FRAME = 64 * 1024;
+const int SERVER_POLL_MS = 200; // how often the loop checks for shutdown
+
+enum ServerOp : uint8_t {
+    OP_BOOK = 1,            // booking request as journaled -> u32 slot, u32 generation
+    OP_END = 2,             // u32 slot, u32 generation
+    OP_EXTEND = 3,          // u32 slot, u32 generation, new return date
+    OP_LIST_CARS = 4,       // car search (see parseFleetQuery), u64 cursor -> page text, u8 more, u64 next cursor
+    OP_LIST_CONTRACTS = 5,  // filter, u64 cursor -> page text, u8 more, u64 next cursor
+    OP_MAINT_ADD = 6,       // plate, description, due date -> u32 slot, u32 generation
+    OP_MAINT_DONE = 7,      // u32 slot, u32 generation
+    OP_MAINT_DELETE = 8,    // u32 slot, u32 generation
+    OP_MAINT_DUE = 9,       // from, to, u64 cursor -> page text, u8 more, u64 next cursor
+    OP_STATS = 10,          // -> operation statistics text
+    OP_PRICING_RULE = 11    // rule command line (see runPricingRuleCommand) -> u64 day prices recomputed
+};
+
+enum ServerStatus : uint8_t { STATUS_OK = 0, STATUS_REJECTED = 1, STATUS_BAD_REQUEST = 2 };
+
+void putBookingRequest(JournalEncoder& e, const BookingRequest& req);
+
+bool getBookingRequest(JournalDecoder& in, BookingRequest& req);
+
+// Appends one frame to out
+void appendFrame(std::string& out, uint8_t code, const std::string& body);
+
+// Runs one request and encodes its response body in out; returns the status
+uint8_t handleServerRequest(uint8_t op, JournalDecoder& in, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList,
+    Journal* journal, JournalEncoder& out);
+
+#ifndef _WIN32
+extern std::atomic<bool> serverStopRequested;
+
+void requestServerStop(int);
+
+struct ServerConnection {
+    int fd = -1;
+    std::string in;          // received bytes; frames are consumed from inUsed on
+    size_t inUsed = 0;
+    std::string out;         // responses not yet written; sent up to outSent
+    size_t outSent = 0;
+    size_t roundStart = 0;   // out from here answers this round's requests,
+    size_t roundReplies = 0; // held back until the round's journal sync
+    bool watchingWrites = false;
+    bool peerClosed = false; // no more requests; closed once out is written
+};
+
+// Creates a non-blocking listening socket at path, replacing a stale one
+int listenOnUnixSocket(const std::string& path);
+
+// Serves requests until serverStopRequested is set. One thread runs an epoll
+// loop over every connection; each request is handled as soon as its frame
+// is complete, through the engine, so batch terminals may run alongside.
+// Journal records of one loop round are synced together before any of the
+// round's responses is written (group commit); if that sync fails, each of
+// the round's responses is replaced by a rejection.
+bool runServer(const std::string& socketPath, ReservationEngine& engine, FleetRegistry& VehicleList, ContractStore& CustomerList, Journal* journal);
+
+// Blocking connection to the server for the client and the load test
+class ServerClient {
+private:
+    int fd = -1;
+    std::string received;
+
+public:
+    bool connect(const std::string& socketPath) {
+        sockaddr_un address = {};
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        return fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    // Sends one request and waits for its response
+    bool call(uint8_t op, const JournalEncoder& body, uint8_t& status, std::string& response) {
+        std::string frame;
+        appendFrame(frame, op, body.data());
+        for (size_t sent = 0; sent < frame.size();) {
+            ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        char buffer[64 * 1024];
+        while (true) {
+            if (received.size() >= 5) {
+                uint32_t length;
+                memcpy(&length, received.data(), 4);
+                if (length == 0 || length > SERVER_MAX_FRAME) {
+                    return false;
+                }
+                if (received.size() - 4 >= length) {
+                    status = static_cast<uint8_t>(received[4]);
+                    response.assign(received, 5, length - 1);
+                    received.erase(0, 4 + length);
+                    return true;
+                }
+            }
+            ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+            if (got <= 0) {
+                return false;
+            }
+            received.append(buffer, static_cast<size_t>(got));
+        }
+    }
+
+    ~ServerClient() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+// Small counter client: reads commands from standard input, one per line,
+// in the batch syntax (add, addvip, delete, extend, maint|add, maint|done,
+// maint|delete, rule) plus cars|filter, customers|filter, maint|due|from|to
+// and stats, and prints the server's answers
+int runClient(const std::string& socketPath);
+#endif
+
+// Deterministic synthetic data for benchmarks and load tests: the same
+// configuration always produces the same fleet, contracts and schedules, on
+// any platform. Each size can be set from a few thousand to tens of millions.
+struct SyntheticConfig {
+    size_t cars = 1000;
+    size_t contracts = 1000;    // active contracts, spread round-robin over the cars
+    size_t tasksPerCar = 2;     // maintenance tasks per car
+    unsigned vipPercent = 20;   // share of contracts booked as VIP
+    uint64_t seed = 1;
+    int year = 2025;            // rentals and maintenance start in this year
+};
+
+// Small LCG; cheap, and the same sequence everywhere
+class SyntheticRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit SyntheticRandom(uint64_t seed) : state(seed * 2 + 1) {}
+
+    uint32_t next() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    // Uniform in [0, bound)
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>((static_cast<uint64_t>(next()) * bound) >> 32); }
+};
+
+// Plate of the index-th synthetic car, e.g. "11A-00042"; unique below 2.3e8
+std::string syntheticPlate(size_t index);
+
+// Adds config.cars cars; their plates are appended to plates when given
+void generateFleet(FleetRegistry& fleet, const SyntheticConfig& config, std::vector<std::string>* plates = nullptr);
+
+// Books config.contracts contracts through bookCustomer, so calendars and
+// indexes end up as after real bookings. A car's bookings follow each other
+// without overlapping. Returns the number booked; IDs go to ids when given.
+size_t generateContracts(FleetRegistry& fleet, ContractStore& contracts, const SyntheticConfig& config, std::vector<ContractId>* ids = nullptr);
+
+// Schedules config.tasksPerCar tasks on every car, due over config.year
+size_t generateMaintenance(FleetRegistry& fleet, const SyntheticConfig& config);